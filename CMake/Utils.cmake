@@ -227,6 +227,40 @@ function(source_file_compile_options SOURCE_FILE)
     set_source_files_properties("${SOURCE_FILE}" PROPERTIES COMPILE_OPTIONS "${COMPILE_OPTIONS}")
 endfunction()
 
+################################################################################
+# Compile a render pass into constexpr descriptors at build time
+#     orb_compile_pipeline(<target> <rpass_meta> <output> [ROOT <dir>])
+# Input:
+#     target     - Target that includes the output
+#     rpass_meta - The .rpass.meta file
+#     output     - The .inc to write, its directory is added to the include path
+#     ROOT       - Directory the paths inside the .meta files are relative to,
+#                  the directory of the calling CMakeLists.txt by default
+################################################################################
+function(orb_compile_pipeline TARGET RPASS_META OUTPUT)
+    cmake_parse_arguments(ARG "" "ROOT" "" ${ARGN})
+    if(NOT ARG_ROOT)
+        set(ARG_ROOT "${CMAKE_CURRENT_SOURCE_DIR}")
+    endif()
+    get_filename_component(RPASS_META "${RPASS_META}" ABSOLUTE)
+    get_filename_component(OUTPUT "${OUTPUT}" ABSOLUTE BASE_DIR "${CMAKE_CURRENT_BINARY_DIR}")
+    get_filename_component(OUTPUT_DIR "${OUTPUT}" DIRECTORY)
+    # The depfile lists the stage .meta files and shaders, so editing any of them recompiles
+    if(CMAKE_VERSION VERSION_GREATER_EQUAL "3.20")
+        set(DEPFILE_ARGS DEPFILE "${OUTPUT}.d")
+    endif()
+    add_custom_command(
+        OUTPUT "${OUTPUT}"
+        COMMAND PipelineCompiler -r "${ARG_ROOT}" -d "${OUTPUT}.d" "${RPASS_META}" "${OUTPUT}"
+        DEPENDS PipelineCompiler "${RPASS_META}"
+        ${DEPFILE_ARGS}
+        COMMENT "Compiling render pass ${RPASS_META}"
+        VERBATIM
+    )
+    target_sources(${TARGET} PRIVATE "${OUTPUT}")
+    target_include_directories(${TARGET} PRIVATE "${OUTPUT_DIR}" "${CMAKE_SOURCE_DIR}/OverloadedRenderBackend")
+endfunction()
+
 ################################################################################
 # Default properties of visual studio projects
 ################################################################################
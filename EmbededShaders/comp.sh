@@ -1 +1 @@
-../embeder defaultRender.frag defaultRender.vert defaultStoredRender.frag defaultStoredRender.vert flatten.vert flatten.frag shadows.vert
\ No newline at end of file
+../embeder defaultRender.frag defaultRender.vert defaultStoredRender.frag defaultStoredRender.vert flatten.vert flatten.frag shadows.vert upsample.frag
\ No newline at end of file
@@ -10,15 +10,66 @@ uniform float specular_exponent = 1;
 uniform sampler2D tex;
 uniform vec4 light_position = vec4(0, 0, 0, 1);
 uniform vec3 light_color = vec3(1, 1, 1);
-uniform int textured = 0;
-uniform int enableLighting = 0;
+// Compiled once per combination, ShaderStage defines these for the variant
+#ifdef ORB_TEXTURED
+const bool textured = true;
+#else
+const bool textured = false;
+#endif
+#ifdef ORB_LIGHTING
+const bool enableLighting = true;
+#else
+const bool enableLighting = false;
+#endif
 uniform vec4 globalColor;
+uniform int virtualTextured = 0;
+uniform usampler2D vtIndirection;
+// x, y - size in pixels, z - levels
+uniform vec4 vtInfo;
+// x - tile size, y - border, z - page size, w - cache size
+uniform vec4 vtPage;
+// Pixels that wanted each tile of the virtual texture, read back by VirtualTexture::Update
+layout(std430, binding = 2) buffer vtFeedback {
+  uint coverage[];
+};
 out vec4 diffuseColor;
+
+vec4 sampleVirtual(vec2 uv) {
+  vec2 pixel = clamp(uv, 0, 1) * vtInfo.xy;
+  vec2 dx = dFdx(pixel), dy = dFdy(pixel);
+  int tileSize = int(vtPage.x);
+  int level = clamp(int(floor(0.5 * log2(max(dot(dx, dx), dot(dy, dy))))), 0, int(vtInfo.z) - 1);
+  pixel = min(pixel, vtInfo.xy - 0.5);
+  ivec2 tile = ivec2(pixel) / (tileSize << level);
+  // A quarter of the pixels in each direction is plenty to rank the tiles
+  if ((int(gl_FragCoord.x) & 3) == 0 && (int(gl_FragCoord.y) & 3) == 0) {
+    int first = 0;
+    for (int l = 0; l < level; ++l) {
+      ivec2 tiles = (ivec2(vtInfo.xy) + (tileSize << l) - 1) / (tileSize << l);
+      first += tiles.x * tiles.y;
+    }
+    int tilesX = (int(vtInfo.x) + (tileSize << level) - 1) / (tileSize << level);
+    atomicAdd(coverage[first + tile.y * tilesX + tile.x], 1u);
+  }
+  // The entry points at the page of the closest resident level at or above the one wanted
+  uvec4 entry = texelFetch(vtIndirection, tile, level);
+  vec2 resident = pixel / float(1 << entry.z);
+  vec2 inTile = mod(resident, float(tileSize));
+  vec2 texel = vec2(entry.xy) * vtPage.z + vtPage.y + inTile;
+  return textureLod(tex, texel / vtPage.w, 0);
+}
+
+vec4 sampleTexture(vec2 uv) {
+  if (virtualTextured == 1)
+    return sampleVirtual(uv);
+  return texture(tex, uv);
+}
+
 void main() {
-  if (enableLighting == 0) {
+  if (!enableLighting) {
     diffuseColor = color * globalColor;
-    if (textured == 1)
-      diffuseColor *= texture(tex, texPos);
+    if (textured)
+      diffuseColor *= sampleTexture(texPos);
   } else {
     vec3 ambient = diffuse_coefficient * globalColor.xyz;
     vec4 m = normalize(worldNormal);
@@ -35,7 +86,7 @@ void main() {
       specMult = pow(specMult, specular_exponent);
     specular *= specMult;
     diffuseColor = vec4(specular + diffuse + ambient, globalColor.w);
-    if (textured == 1)
-      diffuseColor *= texture(tex, texPos);
+    if (textured)
+      diffuseColor *= sampleTexture(texPos);
   }
 }
\ No newline at end of file
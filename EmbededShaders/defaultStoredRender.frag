@@ -4,12 +4,23 @@ layout(location = 1) in vec4 color;
 layout(location = 2) in vec4 worldNormal;
 layout(location = 3) in vec4 worldPosition;
 layout(location = 4) in flat int InstanceID;
+layout(location = 5) in flat int layer;
 uniform vec4 eye_position = vec4(0, 0, 0, 1);
 uniform sampler2D tex;
+uniform sampler2DArray residentTextures;
 uniform vec4 light_position = vec4(0, 0, 0, 1);
 uniform vec3 light_color = vec3(1, 1, 1);
-uniform int textured = 0;
-uniform int enableLighting = 0;
+// Compiled once per combination, ShaderStage defines these for the variant
+#ifdef ORB_TEXTURED
+const bool textured = true;
+#else
+const bool textured = false;
+#endif
+#ifdef ORB_LIGHTING
+const bool enableLighting = true;
+#else
+const bool enableLighting = false;
+#endif
 out vec4 diffuseColor;
 
 struct buff {
@@ -17,6 +28,8 @@ struct buff {
   mat4 normalMatrix;
   vec3 color;
   int materialID;
+  vec4 uvRect;
+  int layer;
 };
 
 struct material{
@@ -34,13 +47,19 @@ layout(std430, binding = 1) buffer MaterialBuffer {
   material materials[];
 };
 
+vec4 sampleTexture() {
+  if (layer >= 0)
+    return texture(residentTextures, vec3(texPos, layer));
+  return texture(tex, texPos);
+}
+
 void main() {
   int instance = InstanceID;
   buff b = data[instance];
-  if (enableLighting == 0) {
+  if (!enableLighting) {
     diffuseColor = vec4(b.color, 1);
-    if (textured == 1)
-      diffuseColor *= texture(tex, texPos);
+    if (textured || layer >= 0)
+      diffuseColor *= sampleTexture();
   } else {
     material mi = materials[b.materialID];
     vec3 ambient = mi.diffuse * b.color;
@@ -58,7 +77,7 @@ void main() {
       specMult = pow(specMult, mi.specular_exponent);
     specular *= specMult;
     diffuseColor = vec4(specular + diffuse + ambient, 1);
-    if (textured == 1)
-      diffuseColor *= texture(tex, texPos);
+    if (textured || layer >= 0)
+      diffuseColor *= sampleTexture();
   }
 }
\ No newline at end of file
@@ -8,11 +8,14 @@ layout(location = 1) out vec4 color;
 layout(location = 2) out vec4 worldNormal;
 layout(location = 3) out vec4 worldPosition;
 layout(location = 4) out flat int InstanceID;
+layout(location = 5) out flat int layer;
 struct buff {
   mat4 matrix;
   mat4 normalMatrix;
   vec3 color;
   int materialID;
+  vec4 uvRect;
+  int layer;
 };
 layout(std430, binding = 0) buffer RenderBuffer { buff data[]; };
 uniform mat4 screenMatrix;
@@ -24,6 +27,7 @@ void main() {
   worldPosition = b.matrix * pos * zoom;
   worldNormal = b.normalMatrix * normal;
   gl_Position = screenMatrix * worldPosition;
-  texPos = texcoord;
+  texPos = b.uvRect.xy + texcoord * b.uvRect.zw;
+  layer = b.layer;
   color = vecColor;
 }
\ No newline at end of file
@@ -1,14 +1,31 @@
 #version 450
-uniform sampler2D FBO;
-uniform sampler2DArray FBOArray;
-uniform int array;
+// Must match compositeLayers in RenderPass.cpp
+const int maxLayers = 16;
+uniform sampler2D layers[maxLayers];
+uniform int layerCount;
+// The part of the layers the viewport drew into
+uniform vec2 viewportScale;
 layout(location = 0) in vec2 texCoordinates;
 out vec4 diffuseColor;
 const float gamma = 0.0025;
 void main() {
-  vec4 c = texture(FBO, texCoordinates);
-  if (c.a > gamma)
-    diffuseColor = c;
+  // Back to front, the premultiplied color of the layers and how much shows through them
+  vec3 color = vec3(0);
+  float through = 1;
+  // Drawn at a lower resolution the layers are stretched, keep the filter from reaching past what was drawn
+  vec2 texel = 0.5 / vec2(textureSize(layers[0], 0));
+  vec2 uv = clamp(texCoordinates, texel, viewportScale - texel);
+  for (int i = 0; i < layerCount; ++i) {
+    vec4 c = texture(layers[i], uv);
+    if (c.a <= gamma)
+      continue;
+    color = c.rgb * c.a + color * (1 - c.a);
+    through *= 1 - c.a;
+  }
+  // Blended with GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA this is the same as blending the layers one at a time
+  float alpha = 1 - through;
+  if (alpha > 0)
+    diffuseColor = vec4(color / alpha, alpha);
   else
     diffuseColor = vec4(0, 0, 0, 0);
 }
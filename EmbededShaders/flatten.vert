@@ -1,8 +1,10 @@
 #version 450
-layout(location = 0) in vec2 pos;
-layout(location = 2) in vec2 texPos;
 layout(location = 0) out vec2 texCoordinates;
+// The part of the layers the viewport drew into, they can be bigger than the window
+uniform vec2 viewportScale;
+// One triangle over the whole screen made from the vertex id, so there is no vertex buffer
 void main() {
-  gl_Position = vec4(pos, 0, 1);
-  texCoordinates = texPos;
+  vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+  gl_Position = vec4(corner * 2 - 1, 0, 1);
+  texCoordinates = corner * viewportScale;
 }
\ No newline at end of file
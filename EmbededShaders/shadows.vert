@@ -8,6 +8,8 @@ struct buff {
   mat4 normalMatrix;
   vec3 color;
   int materialID;
+  vec4 uvRect;
+  int layer;
 };
 layout(std430, binding = 0) buffer RenderBuffer { buff data[]; };
 uniform mat4 screenMatrix;
@@ -0,0 +1,12 @@
+#version 450
+// Stretches a lower resolution FBO over the one bound with bilinear filtering
+uniform sampler2D source;
+// The part of the source that was drawn into, must match flatten.vert
+uniform vec2 viewportScale;
+layout(location = 0) in vec2 texCoordinates;
+out vec4 diffuseColor;
+void main() {
+  // Keep the filter inside what was drawn, the textures repeat and are bigger than the drawn part
+  vec2 texel = 0.5 / vec2(textureSize(source, 0));
+  diffuseColor = texture(source, clamp(texCoordinates, texel, viewportScale - texel));
+}
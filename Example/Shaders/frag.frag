@@ -17,11 +17,19 @@ layout(location = 6) in vec4 worldCoords;
 layout(location = 0) out vec4 diffuseColor;
 
 layout(location = 25) uniform sampler2D tex;
-layout(location = 26) uniform int textured;
 layout(location = 27) uniform vec4 globalColor;
 layout(location = 31) uniform mat4 texMulti;
 layout(location = 47) uniform int sourceCount;
-layout(location = 48) uniform int enableLighting;
+#ifdef ORB_TEXTURED
+const bool textured = true;
+#else
+const bool textured = false;
+#endif
+#ifdef ORB_LIGHTING
+const bool enableLighting = true;
+#else
+const bool enableLighting = false;
+#endif
 const float gamma = 0.00025;
 const float hazeScale = .125;
 layout(std430, binding=1) buffer sources
@@ -70,12 +78,12 @@ void main() {
 
 
   vec4 pre = vec4(0);
-	if(textured == 1)
+	if(textured)
 		pre = color * texture(tex, texCoord);
 	else 
 		pre = color * globalColor;
  
- if(enableLighting == 1)
+ if(enableLighting)
  {
     float lighting = checkLights();
     diffuseColor = pre * vec4(lighting,lighting,lighting,1);
@@ -0,0 +1,282 @@
+#include "pch.h"
+#include "Asset Pack.h"
+#include "ShaderLog.hpp"
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+  // Must match the AssetPacker
+  typedef struct PackHeader
+  {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t indexOffset;
+    uint64_t namesOffset;
+  }PackHeader;
+
+  typedef struct PackEntry
+  {
+    uint64_t hash;
+    uint64_t offset;
+    uint64_t packedSize;
+    uint64_t size;
+    uint32_t nameOffset;
+    uint32_t flags;
+  }PackEntry;
+
+  static_assert(sizeof(PackHeader) == 32 && sizeof(PackEntry) == 40, "pack layout changed");
+
+  constexpr uint32_t packVersion = 1;
+  constexpr uint32_t entryLZ4 = 1 << 0;
+
+  unsigned long long HashPath(std::string const& name)
+  {
+    unsigned long long h = 14695981039346656037ull;
+    for (char c : name)
+      h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    return h;
+  }
+
+  // The form the AssetPacker stores paths in
+  std::string Normalize(std::string path)
+  {
+    std::replace(path.begin(), path.end(), '\\', '/');
+    path = std::filesystem::path(path).lexically_normal().generic_string();
+    while (path.starts_with("./"))
+      path.erase(0, 2);
+    std::transform(path.begin(), path.end(), path.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return path;
+  }
+
+  // Decode one LZ4 block, every read and write is checked so a corrupt entry can't run off either buffer
+  bool DecodeLZ4(unsigned char const* src, size_t srcSize, unsigned char* dst, size_t dstSize)
+  {
+    unsigned char const* const srcEnd = src + srcSize;
+    unsigned char* const dstBegin = dst;
+    unsigned char* const dstEnd = dst + dstSize;
+    while (src < srcEnd)
+    {
+      const unsigned token = *src++;
+      size_t literals = token >> 4;
+      if (literals == 15)
+      {
+        unsigned char b = 255;
+        while (b == 255)
+        {
+          if (src == srcEnd)
+            return false;
+          b = *src++;
+          literals += b;
+        }
+      }
+      if (literals > static_cast<size_t>(srcEnd - src) || literals > static_cast<size_t>(dstEnd - dst))
+        return false;
+      std::memcpy(dst, src, literals);
+      src += literals;
+      dst += literals;
+      // The last sequence is only literals
+      if (src == srcEnd)
+        break;
+
+      if (srcEnd - src < 2)
+        return false;
+      const size_t offset = src[0] | (src[1] << 8);
+      src += 2;
+      if (offset == 0 || offset > static_cast<size_t>(dst - dstBegin))
+        return false;
+      size_t match = (token & 15) + 4;
+      if ((token & 15) == 15)
+      {
+        unsigned char b = 255;
+        while (b == 255)
+        {
+          if (src == srcEnd)
+            return false;
+          b = *src++;
+          match += b;
+        }
+      }
+      if (match > static_cast<size_t>(dstEnd - dst))
+        return false;
+      // Byte by byte, the match may overlap what it is writing
+      unsigned char const* from = dst - offset;
+      for (size_t i = 0; i < match; ++i)
+        dst[i] = from[i];
+      dst += match;
+    }
+    return dst == dstEnd;
+  }
+
+  PackEntry const& Entry(char const* base, uint64_t index, long long i)
+  {
+    return reinterpret_cast<PackEntry const*>(base + index)[i];
+  }
+}
+
+AssetPack* AssetPack::Instance()
+{
+  if (_instance == nullptr)
+    _instance = new AssetPack();
+  return _instance;
+}
+
+bool AssetPack::Mount(std::string const& path)
+{
+  Mapping m;
+  m.path = path;
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    Log(Error, "Could not open asset pack:", path);
+    return false;
+  }
+  LARGE_INTEGER size = {};
+  GetFileSizeEx(file, &size);
+  m.size = static_cast<size_t>(size.QuadPart);
+  HANDLE mapping = m.size != 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+  if (mapping != nullptr)
+  {
+    m.base = static_cast<char const*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    // The view keeps the mapping alive
+    CloseHandle(mapping);
+  }
+  CloseHandle(file);
+#else
+  int file = open(path.c_str(), O_RDONLY);
+  if (file == -1)
+  {
+    Log(Error, "Could not open asset pack:", path);
+    return false;
+  }
+  struct stat info = {};
+  fstat(file, &info);
+  m.size = static_cast<size_t>(info.st_size);
+  if (m.size != 0)
+  {
+    void* view = mmap(nullptr, m.size, PROT_READ, MAP_SHARED, file, 0);
+    m.base = view != MAP_FAILED ? static_cast<char const*>(view) : nullptr;
+  }
+  close(file);
+#endif
+  if (m.base == nullptr)
+  {
+    Log(Error, "Could not map asset pack:", path);
+    return false;
+  }
+
+  PackHeader header = {};
+  if (m.size >= sizeof(PackHeader))
+    std::memcpy(&header, m.base, sizeof(PackHeader));
+  const bool sound = m.size >= sizeof(PackHeader) && std::memcmp(header.magic, "ORBA", 4) == 0 && header.version == packVersion &&
+                     header.indexOffset % alignof(PackEntry) == 0 && header.indexOffset <= m.size &&
+                     header.count <= (m.size - header.indexOffset) / sizeof(PackEntry) && header.namesOffset <= m.size;
+  if (sound == false)
+  {
+    Log(Error, "Not an asset pack or made by a different AssetPacker:", path);
+#ifdef _WIN32
+    UnmapViewOfFile(m.base);
+#else
+    munmap(const_cast<char*>(m.base), m.size);
+#endif
+    return false;
+  }
+  m.count = header.count;
+  m.index = header.indexOffset;
+  m.names = header.namesOffset;
+
+  std::unique_lock<std::shared_mutex> lock(_lock);
+  _packs.push_back(m);
+  return true;
+}
+
+long long AssetPack::Find(Mapping const& m, std::string const& name, unsigned long long hash) const
+{
+  long long first = 0;
+  long long count = m.count;
+  // Lower bound of the hash, then walk the run of equal hashes comparing names
+  while (count > 0)
+  {
+    const long long half = count / 2;
+    if (Entry(m.base, m.index, first + half).hash < hash)
+    {
+      first += half + 1;
+      count -= half + 1;
+    }
+    else
+      count = half;
+  }
+  for (; first < m.count && Entry(m.base, m.index, first).hash == hash; ++first)
+  {
+    const uint64_t at = m.names + Entry(m.base, m.index, first).nameOffset;
+    if (at + name.size() < m.size && std::memcmp(m.base + at, name.c_str(), name.size() + 1) == 0)
+      return first;
+  }
+  return -1;
+}
+
+bool AssetPack::Contains(std::string const& path)
+{
+  std::shared_lock<std::shared_mutex> lock(_lock);
+  if (_packs.empty())
+    return false;
+  const std::string name = Normalize(path);
+  const unsigned long long hash = HashPath(name);
+  for (auto m = _packs.rbegin(); m != _packs.rend(); ++m)
+  {
+    if (Find(*m, name, hash) != -1)
+      return true;
+  }
+  return false;
+}
+
+bool AssetPack::Read(std::string const& path, std::string_view& view, std::vector<char>& storage)
+{
+  std::shared_lock<std::shared_mutex> lock(_lock);
+  if (_packs.empty())
+    return false;
+  const std::string name = Normalize(path);
+  const unsigned long long hash = HashPath(name);
+  for (auto m = _packs.rbegin(); m != _packs.rend(); ++m)
+  {
+    const long long i = Find(*m, name, hash);
+    if (i == -1)
+      continue;
+    PackEntry const& e = Entry(m->base, m->index, i);
+    if (e.offset > m->size || e.packedSize > m->size - e.offset)
+    {
+      Log(Error, "Asset pack entry runs past the end of", m->path, ":", path);
+      return false;
+    }
+    char const* data = m->base + e.offset;
+    if ((e.flags & entryLZ4) == 0)
+    {
+      view = std::string_view(data, e.packedSize);
+      return true;
+    }
+    storage.resize(e.size);
+    if (DecodeLZ4(reinterpret_cast<unsigned char const*>(data), e.packedSize, reinterpret_cast<unsigned char*>(storage.data()), storage.size()) == false)
+    {
+      Log(Error, "Corrupt compressed entry in", m->path, ":", path);
+      return false;
+    }
+    view = std::string_view(storage.data(), storage.size());
+    return true;
+  }
+  return false;
+}
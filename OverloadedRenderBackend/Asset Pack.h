@@ -0,0 +1,79 @@
+/*********************************************************************
+ * @file   Asset Pack.h
+ * @brief  Reads assets out of memory mapped .orbpack archives made by
+ * the AssetPacker, so loading a file is a lookup instead of an open
+ *
+ * @details A pack is one file: a header, the entry data, an index of
+ * entries sorted by the hash of their path and the paths themselves.
+ * Entries may be LZ4 compressed. Loaders ask the mounted packs for a path
+ * before going to disk, paths are matched the way Windows would, '/' or
+ * '\\' and any case.
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#pragma once
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class AssetPack
+{
+public:
+  static AssetPack* Instance();
+
+  /**
+   * @brief Map a pack into memory and resolve paths through it.
+   *
+   * @details Packs mounted later win when two have the same path. Packs stay
+   * mapped until the program exits, so views returned by Read never dangle.
+   * @param path the .orbpack file
+   * @return if the pack was mapped and its index is sound
+   */
+  bool Mount(std::string const& path);
+  /**
+   * @brief Check if any mounted pack has a file.
+   *
+   * @param path the file
+   * @return if it is packed
+   */
+  bool Contains(std::string const& path);
+  /**
+   * @brief Get the contents of a packed file.
+   *
+   * @details Stored entries are handed out as a view of the mapping,
+   * compressed ones are decompressed into storage and the view points there.
+   * @param path the file
+   * @param view set to the contents
+   * @param storage holds the contents of compressed entries, must outlive the view
+   * @return false if no mounted pack has the file or it is corrupt
+   */
+  bool Read(std::string const& path, std::string_view& view, std::vector<char>& storage);
+
+private:
+  AssetPack() = default;
+  AssetPack(AssetPack const&) = delete;
+  AssetPack& operator=(AssetPack const&) = delete;
+
+  // One mapped .orbpack
+  typedef struct Mapping
+  {
+    std::string path;
+    char const* base = nullptr;
+    size_t size = 0;
+    uint32_t count = 0;
+    uint64_t index = 0;
+    uint64_t names = 0;
+  }Mapping;
+
+  // Find the entry of a normalized path, its position in the index or -1
+  long long Find(Mapping const& m, std::string const& name, unsigned long long hash) const;
+
+  static inline AssetPack* _instance;
+
+  // Most recently mounted last
+  std::vector<Mapping> _packs;
+  std::shared_mutex _lock;
+};
@@ -0,0 +1,247 @@
+/*********************************************************************
+ * @file   Compiled Pipeline.h
+ * @brief  Render pass and shader stage descriptions compiled from
+ * .rpass.meta and .meta files by the PipelineCompiler
+ *
+ * @details The PipelineCompiler writes a .inc of constexpr tables using
+ * these types, shader sources included, so loading the pass reads no files
+ * and parses nothing. Every name carries its FNV-1a hash, which lets code
+ * check the names it uses against the pass when it compiles:
+ *
+ *   #include "primary.rpass.meta.inc"
+ *   static_assert(ORB_FindStage(primary_rpass_meta, ORB_HashName("primary")) != nullptr);
+ *   orb::LoadCompiledRenderPass(&primary_rpass_meta);
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#pragma once
+#include <span>
+#include <string_view>
+#include <utility>
+
+/**
+ * @brief FNV-1a hash of a name, the same one the PipelineCompiler writes.
+ *
+ * @param name the name
+ * @return the hash
+ */
+constexpr unsigned long long ORB_HashName(std::string_view name)
+{
+  unsigned long long hash = 0xcbf29ce484222325ull;
+  for (char c : name)
+  {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+/**@typedef
+ * @brief One shader of a stage.
+ *
+ * @details type   - GL_VERTEX_SHADER, GL_FRAGMENT_SHADER or GL_COMPUTE_SHADER
+ *          source - the GLSL source
+ */
+typedef struct ORB_CompiledSource
+{
+  unsigned int type;
+  const char* source;
+}ORB_CompiledSource;
+
+/**@typedef
+ * @brief An <in> or <uniform> entry of a stage.
+ *
+ * @details location - attribute location, 0 for uniforms
+ *          size     - components of an input, the size code of a uniform, ULLONG_MAX for [unique]
+ */
+typedef struct ORB_CompiledAttribute
+{
+  const char* name;
+  unsigned long long hash;
+  unsigned int location;
+  unsigned long long size;
+}ORB_CompiledAttribute;
+
+/**@typedef
+ * @brief A <buffers> entry of a stage or pass.
+ *
+ * @details type - the bufferTypes number, 9 for a shader storage buffer
+ */
+typedef struct ORB_CompiledBuffer
+{
+  const char* name;
+  unsigned long long hash;
+  int type;
+}ORB_CompiledBuffer;
+
+/**@typedef
+ * @brief A stage of a pass and everything its .meta file says.
+ *
+ * @details stage         - RENDER_STAGE the stage runs in
+ *          id            - order of the stage within its RENDER_STAGE
+ *          activeShaders - shaderStages bit mask
+ *          variants      - shaderVariant flags
+ */
+typedef struct ORB_CompiledStage
+{
+  const char* name;
+  unsigned long long hash;
+  int stage;
+  unsigned int id;
+  long activeShaders;
+  unsigned int variants;
+  std::span<ORB_CompiledSource const> sources;
+  std::span<ORB_CompiledAttribute const> inputs;
+  std::span<ORB_CompiledAttribute const> uniforms;
+  std::span<ORB_CompiledBuffer const> buffers;
+}ORB_CompiledStage;
+
+/**@typedef
+ * @brief An <fbos> entry of a pass.
+ *
+ * @details stage       - RENDER_STAGE the FBO belongs to
+ *          transient   - only alive between the stages using it, may share textures with other transient FBOs
+ *          format      - internal format of the color texture, GL_RGBA32F unless the options say
+ *          depth       - internal format of the depth texture, GL_DEPTH32F_STENCIL8 or 0 for no depth
+ *          scale       - size relative to the window
+ *          overwritten - every pixel is drawn each frame, so its color is invalidated instead of cleared
+ */
+typedef struct ORB_CompiledFBO
+{
+  const char* name = nullptr;
+  unsigned long long hash = 0;
+  int stage = 0;
+  bool transient = false;
+  unsigned int format = 0x8814;
+  unsigned int depth = 0x8CAD;
+  float scale = 1;
+  bool overwritten = false;
+}ORB_CompiledFBO;
+
+/**@typedef
+ * @brief A <resources> entry of a pass, what a stage does with an FBO or buffer.
+ *
+ * @details access - resourceAccess bits, 1 read and 2 write
+ */
+typedef struct ORB_CompiledResource
+{
+  const char* stage;
+  const char* resource;
+  unsigned int access;
+}ORB_CompiledResource;
+
+/**@typedef
+ * @brief A whole .rpass.meta file.
+ *
+ * @details path - the file it was compiled from, for log messages
+ */
+typedef struct ORB_CompiledPass
+{
+  const char* path;
+  std::span<ORB_CompiledStage const> stages;
+  std::span<ORB_CompiledFBO const> fbos;
+  std::span<ORB_CompiledBuffer const> buffers;
+  std::span<ORB_CompiledResource const> resources;
+}ORB_CompiledPass;
+
+/**
+ * @brief Apply one of the options in the brackets of an <fbos> entry.
+ *
+ * @details The options are a color format (rgba8, rgba16f, rgba32f, r11g11b10f,
+ * rg16f or r32f), depth, depth24 or nodepth, a scale like 0.5, transient and overwritten:
+ *   bloom=3[rgba16f,nodepth,0.5,transient]
+ * @param fbo the FBO to apply it to
+ * @param option the option, in lower case
+ * @return false if it isn't an option, the FBO is left as it was
+ */
+constexpr bool ORB_ApplyFBOOption(ORB_CompiledFBO& fbo, std::string_view option)
+{
+  // GL_RGBA8, GL_RGBA16F, GL_RGBA32F, GL_R11F_G11F_B10F, GL_RG16F, GL_R32F
+  constexpr std::pair<std::string_view, unsigned int> formats[] = {
+      {"rgba8", 0x8058}, {"rgba16f", 0x881A}, {"rgba32f", 0x8814}, {"r11g11b10f", 0x8C3A}, {"rg16f", 0x822F}, {"r32f", 0x822E}};
+  // GL_DEPTH32F_STENCIL8, GL_DEPTH24_STENCIL8
+  constexpr std::pair<std::string_view, unsigned int> depths[] = {{"depth", 0x8CAD}, {"depth24", 0x88F0}, {"nodepth", 0}};
+  if (option == "transient")
+    return fbo.transient = true;
+  if (option == "overwritten")
+    return fbo.overwritten = true;
+  for (auto const& [name, format] : formats)
+  {
+    if (option == name)
+      return fbo.format = format, true;
+  }
+  for (auto const& [name, depth] : depths)
+  {
+    if (option == name)
+      return fbo.depth = depth, true;
+  }
+  // A scale, digits with at most one point
+  double scale = 0, place = 0;
+  for (char c : option)
+  {
+    if (c == '.' && place == 0)
+      place = 1;
+    else if (c >= '0' && c <= '9' && place == 0)
+      scale = scale * 10 + (c - '0');
+    else if (c >= '0' && c <= '9')
+      scale += (c - '0') * (place /= 10);
+    else
+      return false;
+  }
+  if (option.empty() || option == "." || scale <= 0 || scale > 4)
+    return false;
+  fbo.scale = static_cast<float>(scale);
+  return true;
+}
+
+/**
+ * @brief Find a stage of a pass by the hash of its name.
+ *
+ * @param pass the pass
+ * @param hash ORB_HashName of the stage name
+ * @return the stage, nullptr if the pass has none by that name
+ */
+constexpr ORB_CompiledStage const* ORB_FindStage(ORB_CompiledPass const& pass, unsigned long long hash)
+{
+  for (ORB_CompiledStage const& s : pass.stages)
+  {
+    if (s.hash == hash)
+      return &s;
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Find an FBO of a pass by the hash of its name.
+ *
+ * @param pass the pass
+ * @param hash ORB_HashName of the FBO name
+ * @return the FBO, nullptr if the pass has none by that name
+ */
+constexpr ORB_CompiledFBO const* ORB_FindFBO(ORB_CompiledPass const& pass, unsigned long long hash)
+{
+  for (ORB_CompiledFBO const& f : pass.fbos)
+  {
+    if (f.hash == hash)
+      return &f;
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Find a uniform of a stage by the hash of its name.
+ *
+ * @param stage the stage
+ * @param hash ORB_HashName of the uniform name
+ * @return the uniform, nullptr if the stage declares none by that name
+ */
+constexpr ORB_CompiledAttribute const* ORB_FindUniform(ORB_CompiledStage const& stage, unsigned long long hash)
+{
+  for (ORB_CompiledAttribute const& u : stage.uniforms)
+  {
+    if (u.hash == hash)
+      return &u;
+  }
+  return nullptr;
+}
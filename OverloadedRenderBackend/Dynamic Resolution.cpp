@@ -0,0 +1,94 @@
+#include "pch.h"
+#include "Dynamic Resolution.h"
+#include <algorithm>
+#include <cmath>
+
+void DynamicResolution::Configure(float targetMs, float minScale, float maxScale)
+{
+  _targetMs = std::max(targetMs, 0.f);
+  _minScale = std::clamp(minScale, 0.05f, 1.f);
+  _maxScale = std::clamp(maxScale, _minScale, 1.f);
+  _scale = _targetMs == 0 ? 1 : std::clamp(_scale, _minScale, _maxScale);
+  _smoothedMs = 0;
+  _cooldown = 0;
+}
+
+void DynamicResolution::BeginFrame()
+{
+  if (_targetMs == 0)
+    return;
+  if (_queries[0] == 0)
+    glGenQueries(static_cast<GLsizei>(_queries.size()), _queries.data());
+  const unsigned slot = _frame % _latency;
+  // The frame that used this slot last has had _latency frames to finish
+  if (_pending[slot])
+  {
+    // Timestamps land in order, once the last is back the rest are too
+    GLint available = 0;
+    glGetQueryObjectiv(Query(slot, _spans[slot] - 1, true), GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available == 0)
+      return;
+    GLuint64 busy = 0;
+    for (int span = 0; span < _spans[slot]; ++span)
+    {
+      GLuint64 begin = 0, end = 0;
+      glGetQueryObjectui64v(Query(slot, span, false), GL_QUERY_RESULT, &begin);
+      glGetQueryObjectui64v(Query(slot, span, true), GL_QUERY_RESULT, &end);
+      busy += end - begin;
+    }
+    _pending[slot] = false;
+    Adjust(static_cast<float>(busy) / 1e6f);
+  }
+  _spans[slot] = 0;
+  _began = true;
+}
+
+void DynamicResolution::BeginWork()
+{
+  const unsigned slot = _frame % _latency;
+  if (_began == false || _inSpan || _spans[slot] == _maxSpans)
+    return;
+  glQueryCounter(Query(slot, _spans[slot], false), GL_TIMESTAMP);
+  _inSpan = true;
+}
+
+void DynamicResolution::EndWork()
+{
+  if (_inSpan == false)
+    return;
+  const unsigned slot = _frame % _latency;
+  glQueryCounter(Query(slot, _spans[slot], true), GL_TIMESTAMP);
+  ++_spans[slot];
+  _inSpan = false;
+}
+
+void DynamicResolution::EndFrame()
+{
+  if (_began == false)
+    return;
+  EndWork();
+  const unsigned slot = _frame % _latency;
+  _pending[slot] = _spans[slot] != 0;
+  _began = false;
+  ++_frame;
+}
+
+void DynamicResolution::Adjust(float ms)
+{
+  _gpuMs = ms;
+  _smoothedMs = _smoothedMs == 0 ? ms : _smoothedMs + (ms - _smoothedMs) * _smoothing;
+  if (_cooldown > 0)
+  {
+    --_cooldown;
+    return;
+  }
+  if (_smoothedMs <= _targetMs && _smoothedMs >= _targetMs * _headroom)
+    return;
+  // GPU time goes with the pixels drawn, the square of the scale
+  const float wanted = _scale * std::sqrt(_targetMs / _smoothedMs);
+  const float next = std::clamp(std::clamp(wanted, _scale - _maxStep, _scale + _maxStep), _minScale, _maxScale);
+  if (next == _scale)
+    return;
+  _scale = next;
+  _cooldown = _latency;
+}
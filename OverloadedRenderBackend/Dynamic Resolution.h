@@ -0,0 +1,104 @@
+/*********************************************************************
+ * @file   Dynamic Resolution.h
+ * @brief  Picks the scale the primary and secondary FBOs render at from
+ * how long the GPU took on the last frames
+ *
+ * @details Timestamps are written at each end of the spans the renderer
+ * submits a frame's work in, the render stages and the composite, and the
+ * spans are summed. The gaps between them, where the GPU waits on the CPU
+ * or on the swap, aren't counted, so a CPU bound or vsync limited frame
+ * doesn't lower the scale. The queries go in a ring read a few frames later
+ * so reading them never waits on the GPU. When frames run over the target the scale drops,
+ * when they have room to spare it climbs back. Only the viewport changes,
+ * the FBOs keep their textures, and FlattenFBOs stretches what was drawn
+ * over the window.
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#pragma once
+#include <glad.h>
+#include <array>
+
+class DynamicResolution
+{
+public:
+  // The queries are left to go with the context, it is gone by the time the renderer is deleted
+  DynamicResolution() = default;
+  DynamicResolution(DynamicResolution const&) = delete;
+  DynamicResolution& operator=(DynamicResolution const&) = delete;
+
+  /**
+   * @brief Set what the scale aims for and how far it can go.
+   *
+   * @param targetMs time the GPU should be busy each frame, 0 turns scaling off and renders at full size
+   * @param minScale the smallest scale, clamped to (0, 1]
+   * @param maxScale the largest scale, clamped to [minScale, 1]
+   */
+  void Configure(float targetMs, float minScale, float maxScale);
+  /**
+   * @brief Start a frame, reading back an old frame's times and moving the scale towards the target.
+   *
+   */
+  void BeginFrame();
+  /**
+   * @brief Mark the start of a span of the frame's GPU work, call with the default window's context current.
+   *
+   */
+  void BeginWork();
+  /**
+   * @brief Mark the end of the span BeginWork started.
+   *
+   */
+  void EndWork();
+  /**
+   * @brief Finish the frame, its spans are read back _latency frames later.
+   *
+   */
+  void EndFrame();
+  /**
+   * @brief The scale the next frame renders at.
+   *
+   * @return the scale of the window's size, 1 when scaling is off
+   */
+  float Scale() const { return _scale; }
+  /**
+   * @brief How long the GPU was busy on the newest frame whose timestamps are back.
+   *
+   * @return the time in milliseconds, 0 before any are back
+   */
+  float GPUTime() const { return _gpuMs; }
+
+private:
+  // Frames between writing a query and reading it, enough to not stall on any driver
+  static constexpr int _latency = 4;
+  // Spans timed in one frame, any past this are left out
+  static constexpr int _maxSpans = 4;
+  // Weight of a new frame in the smoothed frame time
+  static constexpr float _smoothing = 0.1f;
+  // Frames run under this part of the target before the scale goes back up
+  static constexpr float _headroom = 0.85f;
+  // Most the scale changes in one step, so a single spike doesn't halve it
+  static constexpr float _maxStep = 0.05f;
+
+  void Adjust(float ms);
+
+  GLuint Query(unsigned slot, int span, bool end) const { return _queries[(slot * _maxSpans + span) * 2 + end]; }
+
+  // A begin and end timestamp for each span of each frame in flight
+  std::array<GLuint, _latency * _maxSpans * 2> _queries = {};
+  std::array<int, _latency> _spans = {};
+  std::array<bool, _latency> _pending = {};
+  unsigned _frame = 0;
+  bool _began = false;
+  bool _inSpan = false;
+
+  float _targetMs = 0;
+  float _minScale = 0.5f;
+  float _maxScale = 1;
+  float _scale = 1;
+  float _smoothedMs = 0;
+  float _gpuMs = 0;
+  // Frames to wait after a change, its effect isn't in the queries read until then
+  int _cooldown = 0;
+};
@@ -0,0 +1,63 @@
+#include "pch.h"
+#include "Dynamic Texture.h"
+#include "Render Stats.h"
+#include <cstring>
+
+DynamicTexture::DynamicTexture(int w, int h) : _w(w), _h(h), _size(static_cast<size_t>(w) * h * 4)
+{
+  const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glCreateBuffers(buffers, _buffers);
+  for (int i = 0; i < buffers; ++i)
+  {
+    glNamedBufferStorage(_buffers[i], _size, nullptr, flags);
+    _mapped[i] = static_cast<unsigned char*>(glMapNamedBufferRange(_buffers[i], 0, _size, flags));
+  }
+}
+
+bool DynamicTexture::Update(GLuint texture, int x, int y, int w, int h, int depth, void const* data)
+{
+  if (x < 0 || y < 0 || w <= 0 || h <= 0 || x + w > _w || y + h > _h || (depth != 3 && depth != 4))
+    return false;
+
+  // Take the first buffer the GPU is done with, starting from the oldest
+  int slot = -1;
+  for (int i = 0; i < buffers && slot == -1; ++i)
+  {
+    const int candidate = (_next + i) % buffers;
+    GLsync& fence = _fences[candidate];
+    if (fence != nullptr && glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+      continue;
+    if (fence != nullptr)
+      glDeleteSync(fence);
+    fence = nullptr;
+    slot = candidate;
+  }
+  if (slot == -1)
+  {
+    RenderStats::Instance()->DroppedTextureUpdate();
+    return ++_dropped, false;
+  }
+
+  const size_t bytes = static_cast<size_t>(w) * h * depth;
+  std::memcpy(_mapped[slot], data, bytes);
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffers[slot]);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTextureSubImage2D(texture, 0, x, y, w, h, depth == 4 ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  _fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  _next = (slot + 1) % buffers;
+  return true;
+}
+
+DynamicTexture::~DynamicTexture()
+{
+  for (int i = 0; i < buffers; ++i)
+  {
+    if (_fences[i] != nullptr)
+      glDeleteSync(_fences[i]);
+    glUnmapNamedBuffer(_buffers[i]);
+  }
+  glDeleteBuffers(buffers, _buffers);
+}
@@ -0,0 +1,60 @@
+/*********************************************************************
+ * @file   Dynamic Texture.h
+ * @brief  Persistently mapped pixel buffers for textures that change
+ * every frame
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#pragma once
+#include <glad.h>
+
+/**
+ * @brief The unpack buffers behind a texture from TextureManager::CreateDynamicTexture.
+ *
+ * @details Each update is copied into the next of a ring of persistently mapped pixel
+ * unpack buffers and uploaded from there, so glTextureSubImage2D returns without waiting
+ * for the copy. A fence guards each buffer until the GPU has read it. If every buffer is
+ * still in flight the update is dropped rather than stalling the CPU.
+ */
+class DynamicTexture
+{
+public:
+  /**
+   * @brief Make the unpack buffers.
+   *
+   * @param w the width of the texture
+   * @param h the height of the texture
+   */
+  DynamicTexture(int w, int h);
+  ~DynamicTexture();
+  /**
+   * @brief Upload new pixels for part of the texture.
+   *
+   * @param texture the texture to write to
+   * @param x the left of the rect
+   * @param y the top of the rect
+   * @param w the width of the rect
+   * @param h the height of the rect
+   * @param depth 3 for RGB or 4 for RGBA data
+   * @param data w * h tightly packed pixels
+   * @return if the update was queued, false if it was dropped
+   */
+  bool Update(GLuint texture, int x, int y, int w, int h, int depth, void const* data);
+  // Updates dropped because every buffer was still being read
+  unsigned long long Dropped() const { return _dropped; }
+
+  static constexpr int buffers = 3;
+
+private:
+  DynamicTexture(DynamicTexture const&) = delete;
+  DynamicTexture& operator=(DynamicTexture const&) = delete;
+
+  int _w, _h;
+  size_t _size;
+  GLuint _buffers[buffers] = {};
+  unsigned char* _mapped[buffers] = {};
+  GLsync _fences[buffers] = {};
+  int _next = 0;
+  unsigned long long _dropped = 0;
+};
@@ -9,6 +9,7 @@
 #include "pch.h"
 
 #include "Fonts.h"
+#include "Asset Pack.h"
 
 inline Fonts::~Fonts()
 {
@@ -27,7 +28,11 @@ ORB_FontInfo* Fonts::LoadFont(const char* c, int size)
     if (_instance == nullptr)
         _instance = new Fonts();
     ORB_FontInfo* f = new ORB_FontInfo();
-    f->font = TTF_OpenFont(c, size);
+    std::string_view packed;
+    if (AssetPack::Instance()->Read(c, packed, f->packed))
+        f->font = TTF_OpenFontRW(SDL_RWFromConstMem(packed.data(), static_cast<int>(packed.size())), 1, size);
+    else
+        f->font = TTF_OpenFont(c, size);
     if (f->font == nullptr)
         throw std::runtime_error("Failed to create font");
     f->name = c;
@@ -17,6 +17,8 @@ typedef struct ORB_FontInfo
 {
     TTF_Font* font;
     std::string name;
+    // A decompressed packed font, SDL_ttf reads from it for as long as the font is open
+    std::vector<char> packed;
 } FontInfo;
 
 class Fonts
@@ -0,0 +1,222 @@
+#include "pch.h"
+#include "Frame Profiler.h"
+#include <SDL.h>
+#include <algorithm>
+
+FrameProfiler* FrameProfiler::Instance()
+{
+  if (_instance == nullptr)
+    _instance = new FrameProfiler();
+  return _instance;
+}
+
+void FrameProfiler::Enable(bool on)
+{
+  if (on == _enabled)
+    return;
+  if (on)
+  {
+    _enabled = true;
+    _context = SDL_GL_GetCurrentContext();
+    Begin("Frame");
+    return;
+  }
+  while (_open.empty() == false)
+    End();
+  _enabled = false;
+  // Frames in flight are dropped, the queries are kept for when it is turned on again
+  for (Frame& f : _frames)
+  {
+    f.records.clear();
+    f.usedQueries = 0;
+    f.pending = false;
+  }
+}
+
+void FrameProfiler::Begin(std::string_view name, bool gpu)
+{
+  if (_enabled == false)
+    return;
+  Frame& f = _frames[_frame % _latency];
+  Record r;
+  r.name = Name(name);
+  r.depth = static_cast<int>(_open.size());
+  r.cpuBegin = clock::now();
+  if (gpu && _context != nullptr && SDL_GL_GetCurrentContext() == _context)
+    r.queryBegin = Timestamp(f);
+  f.records.push_back(r);
+  _open.push_back(f.records.size() - 1);
+}
+
+void FrameProfiler::End()
+{
+  if (_enabled == false || _open.empty())
+    return;
+  Frame& f = _frames[_frame % _latency];
+  Record& r = f.records[_open.back()];
+  _open.pop_back();
+  // A scope that ended in another window's context only has its CPU time
+  if (r.queryBegin >= 0 && SDL_GL_GetCurrentContext() == _context)
+    r.queryEnd = Timestamp(f);
+  r.cpuEnd = clock::now();
+}
+
+void FrameProfiler::EndFrame()
+{
+  if (_enabled == false)
+    return;
+  _context = SDL_GL_GetCurrentContext();
+  // The frame's scope, and any a callback left open
+  while (_open.empty() == false)
+    End();
+  _frames[_frame % _latency].pending = true;
+  ++_frame;
+
+  // The slot the next frame uses was last written _latency frames ago
+  Frame& next = _frames[_frame % _latency];
+  if (next.pending)
+    Resolve(next);
+  next.records.clear();
+  next.usedQueries = 0;
+  next.pending = false;
+  Begin("Frame");
+}
+
+std::vector<ProfileScopeStats> const& FrameProfiler::Stats()
+{
+  _stats.clear();
+  if (_resolved == 0)
+    return _stats;
+  const size_t size = std::tuple_size_v<decltype(History::cpu)>;
+  const size_t count = static_cast<size_t>(std::min<unsigned long long>(_resolved, size));
+  const size_t last = static_cast<size_t>((_resolved - 1) % size);
+  for (size_t i = 0; i < _history.size(); ++i)
+  {
+    History const& h = _history[i];
+    ProfileScopeStats s = {_names[i].c_str(), h.depth, h.cpu[last], h.gpu[last], 0, 0, 0, 0, h.calls};
+    for (size_t f = 0; f < count; ++f)
+    {
+      s.cpuAverageMs += h.cpu[f] / count;
+      s.gpuAverageMs += h.gpu[f] / count;
+      s.cpuMaxMs = std::max(s.cpuMaxMs, h.cpu[f]);
+      s.gpuMaxMs = std::max(s.gpuMaxMs, h.gpu[f]);
+    }
+    _stats.push_back(s);
+  }
+  return _stats;
+}
+
+bool FrameProfiler::StartTrace(const char* path)
+{
+  StopTrace();
+  _trace.open(path, std::ios::trunc);
+  if (_trace.is_open() == false)
+    return false;
+  _trace << "{\"traceEvents\":[\n"
+         << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n"
+         << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+  _traceStart = clock::now();
+  return true;
+}
+
+void FrameProfiler::StopTrace()
+{
+  if (_trace.is_open() == false)
+    return;
+  _trace << "\n]}\n";
+  _trace.close();
+}
+
+unsigned FrameProfiler::Name(std::string_view name)
+{
+  auto [it, added] = _nameIds.try_emplace(std::string(name), static_cast<unsigned>(_names.size()));
+  if (added)
+  {
+    _names.push_back(it->first);
+    _history.emplace_back();
+  }
+  return it->second;
+}
+
+int FrameProfiler::Timestamp(Frame& frame)
+{
+  if (frame.usedQueries == frame.queries.size())
+  {
+    const size_t grow = 16;
+    frame.queries.resize(frame.queries.size() + grow);
+    glGenQueries(static_cast<GLsizei>(grow), frame.queries.data() + frame.usedQueries);
+  }
+  glQueryCounter(frame.queries[frame.usedQueries], GL_TIMESTAMP);
+  return static_cast<int>(frame.usedQueries++);
+}
+
+void FrameProfiler::Resolve(Frame& frame)
+{
+  // The last timestamp written is the last one done, if it isn't back none of the GPU times are used
+  bool gpu = false;
+  if (frame.usedQueries != 0)
+  {
+    GLint available = 0;
+    glGetQueryObjectiv(frame.queries[frame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    gpu = available != 0;
+  }
+  _times.resize(frame.usedQueries);
+  for (size_t i = 0; gpu && i < frame.usedQueries; ++i)
+    glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &_times[i]);
+
+  const size_t at = static_cast<size_t>(_resolved % std::tuple_size_v<decltype(History::cpu)>);
+  for (History& h : _history)
+  {
+    h.cpu[at] = h.gpu[at] = 0;
+    h.calls = 0;
+  }
+  for (Record const& r : frame.records)
+  {
+    History& h = _history[r.name];
+    h.cpu[at] += std::chrono::duration<float, std::milli>(r.cpuEnd - r.cpuBegin).count();
+    if (gpu && r.queryBegin >= 0 && r.queryEnd >= 0)
+      h.gpu[at] += static_cast<float>(_times[r.queryEnd] - _times[r.queryBegin]) / 1e6f;
+    ++h.calls;
+    h.depth = r.depth;
+  }
+  ++_resolved;
+  if (_trace.is_open())
+    Trace(frame, gpu);
+}
+
+void FrameProfiler::Trace(Frame const& frame, bool gpu)
+{
+  auto escaped = [](std::string const& s)
+  {
+    std::string out;
+    for (char c : s)
+    {
+      if (c == '"' || c == '\\')
+        out += '\\';
+      if (static_cast<unsigned char>(c) >= ' ')
+        out += c;
+    }
+    return out;
+  };
+  auto event = [this](std::string const& name, int thread, double ts, double dur)
+  {
+    _trace << ",\n{\"name\":\"" << name << "\",\"cat\":\"" << (thread == 1 ? "cpu" : "gpu")
+           << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread << ",\"ts\":" << ts << ",\"dur\":" << dur << "}";
+  };
+  auto micro = [](clock::duration d) { return std::chrono::duration<double, std::micro>(d).count(); };
+  if (frame.records.empty() || frame.records.front().cpuBegin < _traceStart)
+    return;
+  // GPU time has its own clock, line it up with the CPU at the start of the frame
+  Record const& root = frame.records.front();
+  const bool aligned = gpu && root.queryBegin >= 0;
+  for (Record const& r : frame.records)
+  {
+    const std::string name = escaped(_names[r.name]);
+    event(name, 1, micro(r.cpuBegin - _traceStart), micro(r.cpuEnd - r.cpuBegin));
+    if (aligned && r.queryBegin >= 0 && r.queryEnd >= 0)
+    {
+      const double ts = micro(root.cpuBegin - _traceStart) + static_cast<double>(_times[r.queryBegin] - _times[root.queryBegin]) / 1e3;
+      event(name, 2, ts, static_cast<double>(_times[r.queryEnd] - _times[r.queryBegin]) / 1e3);
+    }
+  }
+}
@@ -0,0 +1,190 @@
+/*********************************************************************
+ * @file   Frame Profiler.h
+ * @brief  Times every stage, callback, the composite and the swap on the
+ * CPU and the GPU, and keeps rolling statistics of each
+ *
+ * @details Scopes nest, so GPU times come from a GL_TIMESTAMP at each end
+ * of a scope rather than GL_TIME_ELAPSED, which can't nest. The timestamps
+ * of a frame are read back a few frames later so reading never waits on
+ * the GPU, a frame whose timestamps aren't back by then keeps only its CPU
+ * times. Scopes run while another window's context is current are CPU
+ * only, queries belong to the context that made them.
+ *
+ * Resolved frames can also be written as Chrome trace events, open the
+ * file in chrome://tracing or Perfetto.
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#pragma once
+#include <glad.h>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**@typedef
+ * @brief Statistics of one named scope over the last frames.
+ *
+ * @details times are in milliseconds, summed over every time the scope ran
+ * in a frame, gpu times are 0 for CPU only scopes
+ *          depth - how deep in other scopes it last ran, the frame is 0
+ *          calls - how many times it ran in the newest frame
+ */
+typedef struct ProfileScopeStats
+{
+  const char* name;
+  int depth;
+  float cpuMs;
+  float gpuMs;
+  float cpuAverageMs;
+  float gpuAverageMs;
+  float cpuMaxMs;
+  float gpuMaxMs;
+  unsigned calls;
+}ProfileScopeStats;
+
+class FrameProfiler
+{
+public:
+  static FrameProfiler* Instance();
+
+  /**
+   * @brief Turn the profiler on or off, it is off by default and costs nothing then.
+   *
+   * @param on true to profile
+   */
+  void Enable(bool on);
+  bool Enabled() const { return _enabled; }
+  /**
+   * @brief Start a scope, scopes end in the reverse order they started.
+   *
+   * @param name what to call it, scopes of the same name add up
+   * @param gpu false to only time it on the CPU, for work the GPU doesn't see like the swap
+   */
+  void Begin(std::string_view name, bool gpu = true);
+  /**
+   * @brief End the scope started last.
+   *
+   */
+  void End();
+  /**
+   * @brief End the frame's scope, read back the oldest frame in flight and start the next.
+   *
+   * @details Call once a frame with the default window's context current.
+   */
+  void EndFrame();
+  /**
+   * @brief The statistics of every scope seen, in the order they were first seen.
+   *
+   * @return the statistics, the names stay valid until the profiler is deleted
+   */
+  std::vector<ProfileScopeStats> const& Stats();
+  /**
+   * @brief How many frames the statistics have been gathered from.
+   *
+   */
+  unsigned long long ResolvedFrames() const { return _resolved; }
+  /**
+   * @brief Write every frame resolved from now on to a Chrome trace-event JSON file.
+   *
+   * @param path the file, replaced if it exists
+   * @return false if it couldn't be opened
+   */
+  bool StartTrace(const char* path);
+  /**
+   * @brief Finish the trace file.
+   *
+   */
+  void StopTrace();
+
+private:
+  FrameProfiler() = default;
+  FrameProfiler(FrameProfiler const&) = delete;
+  FrameProfiler& operator=(FrameProfiler const&) = delete;
+
+  typedef std::chrono::steady_clock clock;
+
+  typedef struct Record
+  {
+    unsigned name;
+    int depth;
+    clock::time_point cpuBegin;
+    clock::time_point cpuEnd;
+    // Indices into the frame's queries, -1 for CPU only
+    int queryBegin = -1;
+    int queryEnd = -1;
+  }Record;
+
+  typedef struct Frame
+  {
+    std::vector<Record> records;
+    std::vector<GLuint> queries;
+    size_t usedQueries = 0;
+    bool pending = false;
+  }Frame;
+
+  // One frame's time of a name, and the time of the last frames
+  typedef struct History
+  {
+    std::array<float, 128> cpu = {};
+    std::array<float, 128> gpu = {};
+    unsigned calls = 0;
+    int depth = 0;
+  }History;
+
+  // Frames between writing a frame's queries and reading them
+  static constexpr size_t _latency = 4;
+
+  static inline FrameProfiler* _instance;
+
+  unsigned Name(std::string_view name);
+  int Timestamp(Frame& frame);
+  void Resolve(Frame& frame);
+  void Trace(Frame const& frame, bool gpu);
+
+  bool _enabled = false;
+  std::array<Frame, _latency> _frames;
+  // Records of the current frame that haven't ended
+  std::vector<size_t> _open;
+  unsigned long long _frame = 0;
+  unsigned long long _resolved = 0;
+  // The context queries are made in, the default window's
+  void* _context = nullptr;
+
+  // A deque so the names don't move when more are added
+  std::deque<std::string> _names;
+  std::unordered_map<std::string, unsigned> _nameIds;
+  std::vector<History> _history;
+  std::vector<ProfileScopeStats> _stats;
+  // The timestamps of the frame being resolved
+  std::vector<GLuint64> _times;
+
+  std::ofstream _trace;
+  clock::time_point _traceStart;
+};
+
+// Times the code until the end of the block it is in
+class ProfileScope
+{
+public:
+  ProfileScope(std::string_view name, bool gpu = true) : _on(FrameProfiler::Instance()->Enabled())
+  {
+    if (_on)
+      FrameProfiler::Instance()->Begin(name, gpu);
+  }
+  ~ProfileScope()
+  {
+    if (_on)
+      FrameProfiler::Instance()->End();
+  }
+  ProfileScope(ProfileScope const&) = delete;
+  ProfileScope& operator=(ProfileScope const&) = delete;
+
+private:
+  bool _on;
+};
@@ -0,0 +1,127 @@
+#include "pch.h"
+#include "Material Library.h"
+#include "Textures.h"
+
+// Smallest number of materials the MaterialBuffer is allocated for
+constexpr size_t minimumCapacity = 64;
+
+MaterialLibrary *MaterialLibrary::Instance()
+{
+  if (_instance == nullptr)
+    _instance = new MaterialLibrary();
+  return _instance;
+}
+
+size_t MaterialLibrary::MaterialKeyHash::operator()(MaterialKey const &k) const
+{
+  std::hash<float> hf;
+  size_t seed = std::hash<ORB_Texture *>()(k.texture);
+  auto combine = [&seed](size_t h)
+  { seed ^= h + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2); };
+  for (int i = 0; i < 3; ++i)
+  {
+    combine(hf(k.diffuse[i]));
+    combine(hf(k.specular[i]));
+  }
+  combine(hf(k.specularExponent));
+  return seed;
+}
+
+int MaterialLibrary::CreateMaterial(glm::vec3 const &diffuse, glm::vec3 const &specular, float specularExponent, ORB_Texture *texture)
+{
+  MaterialKey key = {diffuse, specular, specularExponent, texture};
+  auto exists = _lookup.find(key);
+  if (exists != _lookup.end())
+    return exists->second;
+
+  int id = static_cast<int>(_materials.size());
+  _materials.push_back({.diffuse = diffuse, .specular = specular, .specularExponent = specularExponent});
+  _textures.push_back(texture);
+  _lookup[key] = id;
+  MarkDirty(id);
+  return id;
+}
+
+void MaterialLibrary::UpdateMaterial(int id, glm::vec3 const &diffuse, glm::vec3 const &specular, float specularExponent, ORB_Texture *texture)
+{
+  if (Valid(id) == false)
+  {
+    Log(Warning, "Attempted to update non existant material", id);
+    return;
+  }
+  MaterialInfo &m = _materials[id];
+  MaterialKey old = {m.diffuse, m.specular, m.specularExponent, _textures[id]};
+  auto l = _lookup.find(old);
+  if (l != _lookup.end() && l->second == id)
+    _lookup.erase(l);
+
+  m = {.diffuse = diffuse, .specular = specular, .specularExponent = specularExponent};
+  _textures[id] = texture;
+  // If an identical material already exists keep handing out that one
+  _lookup.try_emplace({diffuse, specular, specularExponent, texture}, id);
+  MarkDirty(id);
+}
+
+bool MaterialLibrary::Valid(int id) const
+{
+  return id >= 0 && id < static_cast<int>(_materials.size());
+}
+
+MaterialInfo const &MaterialLibrary::Get(int id) const
+{
+  return _materials.at(id);
+}
+
+ORB_Texture *MaterialLibrary::GetTexture(int id) const
+{
+  return _textures.at(id);
+}
+
+void MaterialLibrary::MarkDirty(int id)
+{
+  size_t i = static_cast<size_t>(id);
+  if (_dirtyBegin == _dirtyEnd)
+  {
+    _dirtyBegin = i;
+    _dirtyEnd = i + 1;
+    return;
+  }
+  _dirtyBegin = std::min(_dirtyBegin, i);
+  _dirtyEnd = std::max(_dirtyEnd, i + 1);
+}
+
+void MaterialLibrary::Upload()
+{
+  if (_buffer == 0)
+    glCreateBuffers(1, &_buffer);
+
+  if (_capacity < _materials.size() || _capacity == 0)
+  {
+    // Grow geometrically so adding materials does not reallocate every frame
+    _capacity = std::max(minimumCapacity, std::bit_ceil(_materials.size()));
+    glNamedBufferData(_buffer, _capacity * sizeof(MaterialInfo), nullptr, GL_DYNAMIC_DRAW);
+    if (_materials.empty() == false)
+      glNamedBufferSubData(_buffer, 0, _materials.size() * sizeof(MaterialInfo), _materials.data());
+    _dirtyBegin = _dirtyEnd = 0;
+    return;
+  }
+
+  if (_dirtyBegin == _dirtyEnd)
+    return;
+  glNamedBufferSubData(_buffer, _dirtyBegin * sizeof(MaterialInfo), (_dirtyEnd - _dirtyBegin) * sizeof(MaterialInfo), _materials.data() + _dirtyBegin);
+  _dirtyBegin = _dirtyEnd = 0;
+}
+
+void MaterialLibrary::Bind(int base)
+{
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, base, _buffer);
+}
+
+MaterialLibrary::~MaterialLibrary()
+{
+  if (_buffer != 0)
+    glDeleteBuffers(1, &_buffer);
+  _materials.clear();
+  _textures.clear();
+  _lookup.clear();
+}
@@ -0,0 +1,117 @@
+/*********************************************************************
+ * @file   Material Library.h
+ * @brief  Registry of materials used by the stored renderer
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#pragma once
+#include <glad.h>
+#include <glm.hpp>
+#include <vector>
+#include <unordered_map>
+typedef struct ORB_Texture ORB_Texture;
+
+/**@typedef
+ * @brief A single entry of the MaterialBuffer.
+ *
+ * @details Laid out to match std430 so the vector of these can be handed to the
+ * GPU as is, the material struct in defaultStoredRender.frag must match this.
+ * A material's texture isn't in the buffer, SetMaterial puts it in the
+ * resident texture array and on the instance like any other texture.
+ *          diffuse          - diffuse coefficient
+ *          specular         - specular coefficient
+ *          specularExponent - specular exponent
+ */
+typedef struct MaterialInfo
+{
+  glm::vec3 diffuse = {1, 1, 1};
+  float padding = 0;
+  glm::vec3 specular = {0, 0, 0};
+  float specularExponent = 0;
+}MaterialInfo;
+static_assert(sizeof(MaterialInfo) == 32, "MaterialInfo must match std430 layout");
+
+class MaterialLibrary
+{
+public:
+
+  ~MaterialLibrary();
+  static MaterialLibrary* Instance();
+
+  /**
+   * @brief Find or create a material.
+   *
+   * @details Materials are hashed on their properties, creating the same material
+   * twice will return the same id.
+   * @param diffuse the diffuse coefficient
+   * @param specular the specular coefficient
+   * @param specularExponent the specular exponent
+   * @param texture the texture to use with the material, can be nullptr
+   * @return the id of the material
+   */
+  int CreateMaterial(glm::vec3 const& diffuse, glm::vec3 const& specular, float specularExponent, ORB_Texture* texture = nullptr);
+  /**
+   * @brief Change the properties of an existing material.
+   *
+   * @param id the material to change
+   * @param diffuse the diffuse coefficient
+   * @param specular the specular coefficient
+   * @param specularExponent the specular exponent
+   * @param texture the texture to use with the material, can be nullptr
+   */
+  void UpdateMaterial(int id, glm::vec3 const& diffuse, glm::vec3 const& specular, float specularExponent, ORB_Texture* texture = nullptr);
+
+  bool Valid(int id) const;
+  MaterialInfo const& Get(int id) const;
+  ORB_Texture* GetTexture(int id) const;
+  size_t Count() const { return _materials.size(); }
+
+  /**
+   * @brief Upload any changed materials to the MaterialBuffer.
+   *
+   * @details Only the range of materials changed since the last upload is written,
+   * the buffer is only reallocated when it runs out of space.
+   */
+  void Upload();
+  /**
+   * @brief Bind the MaterialBuffer to a shader storage binding.
+   *
+   * @param base the binding to bind to
+   */
+  void Bind(int base);
+
+private:
+  MaterialLibrary() = default;
+
+  MaterialLibrary(MaterialLibrary const&) = delete;
+  MaterialLibrary& operator=(MaterialLibrary const&) = delete;
+  MaterialLibrary(MaterialLibrary&&) = delete;
+
+  typedef struct MaterialKey
+  {
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+    float specularExponent;
+    ORB_Texture* texture;
+    bool operator==(MaterialKey const&) const = default;
+  }MaterialKey;
+
+  struct MaterialKeyHash
+  {
+    size_t operator()(MaterialKey const& k) const;
+  };
+
+  void MarkDirty(int id);
+
+  static inline MaterialLibrary* _instance = nullptr;
+
+  std::vector<MaterialInfo> _materials;
+  std::vector<ORB_Texture*> _textures;
+  std::unordered_map<MaterialKey, int, MaterialKeyHash> _lookup;
+
+  GLuint _buffer = 0;
+  size_t _capacity = 0;
+  size_t _dirtyBegin = 0;
+  size_t _dirtyEnd = 0;
+};
@@ -3,10 +3,21 @@
 #include "Wermal Reader.h"
 #include "Stream.h"
 #include "RenderBackend.h"
+#include "Upload Service.h"
+#include "Render Stats.h"
 #include <exception>
 Renderer *ORB_Mesh::_backend = nullptr;
 ORB_Mesh::~ORB_Mesh()
 {
+  // The upload thread may still be writing the buffer, and a new buffer could be given its name.
+  // Jobs run in order, so an empty job queued behind the upload finishes after it
+  if (Ready() == false)
+  {
+    UploadService::Instance()->Submit([] {}, [buffer = _buffer]
+                                      { glDeleteBuffers(1, &buffer); });
+    glDeleteVertexArrays(1, &_vao);
+    return;
+  }
   glDeleteBuffers(1, &_buffer);
   glDeleteVertexArrays(1, &_vao);
 }
@@ -109,6 +120,11 @@ GLuint ORB_Mesh::Size() const
   return static_cast<GLuint>(_verticies.size());
 }
 
+bool ORB_Mesh::Ready() const
+{
+  return UploadService::Instance()->Done(_uploadTicket);
+}
+
 std::ostream &operator<<(std::ostream &os, glm::vec4 const &p)
 {
   os << p.x << " " << p.y << " " << p.z << " " << p.w;
@@ -135,24 +151,41 @@ void ORB_Mesh::EndMesh()
     CreateBuffer();
   }
 }
+void ORB_Mesh::UploadVertices()
+{
+  const size_t size = _verticies.size() * sizeof(Vertex);
+  RenderStats::Instance()->BufferWrite(size);
+  // Small meshes upload faster than the frame it takes the upload thread to hand them back
+  if (size < asyncUploadSize || UploadService::Instance()->Available() == false)
+  {
+    glBufferData(GL_ARRAY_BUFFER, size, _verticies.data(), GL_STATIC_DRAW);
+    return;
+  }
+  _uploadTicket = UploadService::Instance()->Submit([buffer = _buffer, verts = _verticies]
+                                                    { glNamedBufferSubData(buffer, 0, verts.size() * sizeof(Vertex), verts.data()); });
+}
 void ORB_Mesh::Render()
 {
+  // Still on its way to the GPU
+  if (Ready() == false)
+    return;
   _backend->WriteBuffer("RenderBuffer", sizeof(RenderInformation) * _renderCalls.size(), _renderCalls.data());
   if (isUI) {
     const bool no = false;
     //glDisable(GL_DEPTH_TEST);
     //glDepthMask(GL_TRUE);
     _backend->WriteUniform("screenMatrix", const_cast<float*>(&_backend->_uiProjection[0][0]));
-    _backend->WriteUniform("enableLighting", const_cast<bool*>(&no));
+    _backend->SelectLighting(no);
   }
   else {
     const bool col = _backend->GetLightingEnabled();
     _backend->WriteUniform("screenMatrix", &_backend->projecton()[0][0]);
-    _backend->WriteUniform("enableLighting", const_cast<bool*>(&col));
+    _backend->SelectLighting(col);
   }
   glBindVertexArray(_vao);
   glBindBuffer(GL_ARRAY_BUFFER, _buffer);
   glDrawArraysInstanced(_drawMode, 0, _verticies.size(), _renderCalls.size());
+  RenderStats::Instance()->Draw(_verticies.size(), static_cast<unsigned>(_renderCalls.size()));
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindVertexArray(0);
   if (isUI) {
@@ -201,7 +234,7 @@ void ORB_Mesh::CreateBuffer()
     else if constexpr (std::endian::native == std::endian::little)
     {
 #endif
-      glBufferData(GL_ARRAY_BUFFER, _verticies.size() * sizeof(Vertex), _verticies.data(), GL_STATIC_DRAW);
+      UploadVertices();
 <<<<<<< Updated upstream
 #ifndef __CLANG
 =======
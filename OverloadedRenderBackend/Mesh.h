@@ -12,8 +12,13 @@ typedef struct RenderInformation {
   glm::vec3 color;
   // float buffer;
   int materialID  = 0;
+  // Offset and scale into the resident texture array page, see Texture Residency.h
+  glm::vec4 uvRect = {0, 0, 1, 1};
+  int layer = -1;
+  int padding[3] = {};
 
 }RenderInformation;
+static_assert(sizeof(RenderInformation) == 176, "RenderInformation must match the std430 layout of RenderBuffer");
 struct ORB_Mesh 
 {
 public:
@@ -37,6 +42,8 @@ public:
   GLuint Buffer() const;
   GLuint VAO() const;
   GLuint Size() const;
+  // False until the upload thread has finished writing the vertex data
+  bool Ready() const;
   void Dump() const;
   void EndMesh();
   void Render();
@@ -51,11 +58,16 @@ public:
   bool isUI = false;
 private:
   void CreateBuffer();
+  void UploadVertices();
   void CalculateNormals();
+
+  // Vertex data at least this big is uploaded by the upload thread
+  static constexpr size_t asyncUploadSize = 256 * 1024;
   
   GLuint _drawMode = 6;
   GLuint _buffer = 0b11111111111111111111111111111111; // 32 1s, the same as 0xffffffff
   GLuint _vao = 0b11111111111111111111111111111111; // 32 1s, the same as 0xffffffff
+  unsigned long long _uploadTicket = 0;
 
   
   std::vector<RenderInformation> _renderCalls;
@@ -7,7 +7,13 @@
 #include "Mesh.h"
 #include "TexturedMesh.h"
 #include "Mesh Library.h"
+#include "Material Library.h"
+#include "Upload Service.h"
+#include "Program Cache.h"
 #include "Fonts.h"
+#include "Asset Pack.h"
+#include "Frame Profiler.h"
+#include "Render Stats.h"
 
 enum class Errors : int
 {
@@ -118,7 +124,10 @@ namespace orb
   ORB_SPEC void ORB_API Update()
   {
     CheckError(__LINE__);
+    UploadService::Instance()->Poll();
+    TextureManager::Instance()->StreamUploads();
     active->Update();
+    TextureManager::Instance()->Update();
     SDL_Event ev = {};
     while (SDL_PollEvent(&ev))
     {
@@ -241,6 +250,16 @@ namespace orb
     active->SetMaterial(id);
   }
 
+  ORB_SPEC int CreateMaterial(Vector3D diffuse, Vector3D specular, float specular_exponent, ORB_texture texture)
+  {
+    return MaterialLibrary::Instance()->CreateMaterial(Convert(diffuse), Convert(specular), specular_exponent, texture);
+  }
+
+  ORB_SPEC void UpdateMaterial(int id, Vector3D diffuse, Vector3D specular, float specular_exponent, ORB_texture texture)
+  {
+    MaterialLibrary::Instance()->UpdateMaterial(id, Convert(diffuse), Convert(specular), specular_exponent, texture);
+  }
+
   ORB_SPEC void SetLight(Vector4D pos, Vector3D color)
   {
     active->SetLight(pos, color);
@@ -424,6 +443,49 @@ namespace orb
   {
     active->SetFillMode(i);
   }
+  ORB_SPEC void ORB_API SetLayerMode(LAYER_MODE mode, int layers)
+  {
+    active->SetLayerMode(static_cast<int>(mode), layers);
+  }
+  ORB_SPEC void ORB_API SetDynamicResolution(float targetMs, float minScale, float maxScale)
+  {
+    active->SetDynamicResolution(targetMs, minScale, maxScale);
+  }
+  ORB_SPEC float ORB_API GetRenderScale()
+  {
+    return active->RenderScale();
+  }
+  ORB_SPEC void ORB_API EnableProfiler(bool on)
+  {
+    FrameProfiler::Instance()->Enable(on);
+  }
+  ORB_SPEC ORB_FrameProfile ORB_API GetFrameProfile()
+  {
+    static std::vector<ORB_ProfileScope> scopes;
+    scopes.clear();
+    for (ProfileScopeStats const &s : FrameProfiler::Instance()->Stats())
+      scopes.push_back({s.name, s.depth, s.cpuMs, s.gpuMs, s.cpuAverageMs, s.gpuAverageMs, s.cpuMaxMs, s.gpuMaxMs, s.calls});
+    return {scopes.data(), static_cast<uint>(scopes.size()), FrameProfiler::Instance()->ResolvedFrames()};
+  }
+  ORB_SPEC bool ORB_API StartProfileTrace(const char *path)
+  {
+    return FrameProfiler::Instance()->StartTrace(path);
+  }
+  ORB_SPEC void ORB_API StopProfileTrace()
+  {
+    FrameProfiler::Instance()->StopTrace();
+  }
+  ORB_SPEC ORB_RenderStats ORB_API GetRenderStats()
+  {
+    static_assert(std::tuple_size_v<decltype(FrameTimes::histogram)> == ORB_FRAME_TIME_BUCKETS);
+    FrameCounters const &c = RenderStats::Instance()->LastFrame();
+    const FrameTimes t = RenderStats::Instance()->Times();
+    ORB_RenderStats stats = {c.drawCalls, c.instances, c.vertices, c.uniformWrites, c.bufferBytes, c.textureBinds,
+                             c.fboBinds, c.programSwitches, c.clears, c.performanceMessages, c.droppedTextureUpdates,
+                             t.last, t.p50, t.p90, t.p99, t.max, {}, RenderStats::Instance()->Frames()};
+    std::copy(t.histogram.begin(), t.histogram.end(), stats.histogram);
+    return stats;
+  }
   ORB_SPEC std::vector<ORB_texture> const &ORB_API GetAllLoadedTextures()
   {
     return TextureManager::Instance()->GetTextures();
@@ -463,6 +525,10 @@ namespace orb
   {
     return active->GetCamera().GetZoom();
   }
+  ORB_SPEC bool ORB_API MountAssetPack(const char *path)
+  {
+    return path != nullptr && AssetPack::Instance()->Mount(path);
+  }
   ORB_SPEC ORB_texture ORB_API LoadTexture(std::string &path)
   {
     return TextureManager::Instance()->LoadTexture(path);
@@ -471,6 +537,51 @@ namespace orb
   {
     return TextureManager::Instance()->LoadTexture(path);
   }
+  ORB_SPEC bool ORB_API LoadAtlas(const char *path)
+  {
+    return TextureManager::Instance()->LoadAtlas(path);
+  }
+  ORB_SPEC ORB_texture ORB_API LoadTextureAsync(const char *path)
+  {
+    return TextureManager::Instance()->LoadTextureAsync(path);
+  }
+  ORB_SPEC bool ORB_API IsTextureReady(ORB_texture t)
+  {
+    return t != nullptr && t->Ready();
+  }
+  ORB_SPEC ORB_texture ORB_API LoadVirtualTexture(const char *path)
+  {
+    return TextureManager::Instance()->LoadVirtualTexture(path);
+  }
+  ORB_SPEC ORB_texture ORB_API CreateDynamicTexture(const char *name, int w, int h)
+  {
+    return TextureManager::Instance()->CreateDynamicTexture(name, w, h);
+  }
+  ORB_SPEC bool ORB_API UpdateTexture(ORB_texture t, void const *data)
+  {
+    return t != nullptr && TextureManager::Instance()->UpdateTexture(t, 0, 0, t->Width(), t->Height(), 4, data);
+  }
+  ORB_SPEC bool ORB_API UpdateTextureRect(ORB_texture t, int x, int y, int w, int h, int depth, void const *data)
+  {
+    return TextureManager::Instance()->UpdateTexture(t, x, y, w, h, depth, data);
+  }
+  ORB_SPEC void ORB_API SetTextureUploadBudget(unsigned bytes)
+  {
+    TextureManager::Instance()->SetUploadBudget(bytes);
+  }
+  ORB_SPEC void ORB_API SetTextureBudget(unsigned long long bytes)
+  {
+    TextureManager::Instance()->SetBudget(bytes);
+  }
+  ORB_SPEC void ORB_API PinTexture(ORB_texture t, bool pinned)
+  {
+    TextureManager::Instance()->Pin(t, pinned);
+  }
+  ORB_SPEC ORB_TextureStats ORB_API GetTextureStats()
+  {
+    TextureStats const &s = TextureManager::Instance()->Stats();
+    return {s.budget, s.residentBytes, s.residentTextures, s.pinnedTextures, s.evictions, s.evictedBytes, s.reloads};
+  }
   ORB_SPEC void ORB_API SetActiveTexture(ORB_texture t)
   {
     active->SetActiveTexture(t);
@@ -485,8 +596,7 @@ namespace orb
   }
   ORB_SPEC void ORB_API SetUV(glm::mat4 const &uv)
   {
-
-    active->WriteUniform("texMulti", (void *)&uv);
+    active->SetUV(uv);
   }
   ORB_SPEC void ORB_API SetTextureSampleMode(ORB_texture t, SAMPLE_SCALE_MODE ssm)
   {
@@ -687,6 +797,24 @@ namespace orb
     LoadCustomRenderPass(std::string(path));
   }
 
+  ORB_SPEC void ORB_API LoadCompiledRenderPass(ORB_CompiledPass const *pass)
+  {
+    if (pass == nullptr)
+      return;
+    active->LoadRenderPass(*pass);
+  }
+
+  ORB_SPEC void ORB_API SetShaderCacheDirectory(const char *path)
+  {
+    ProgramCache::Instance()->SetDirectory(path != nullptr ? path : "");
+  }
+
+  ORB_SPEC ORB_ShaderCacheStats ORB_API GetShaderCacheStats()
+  {
+    ProgramCacheStats const &s = ProgramCache::Instance()->Stats();
+    return {s.hits, s.misses, s.rejected, s.buildSeconds};
+  }
+
   ORB_SPEC void ORB_API SetBufferBase(std::string &buffer, int base)
   {
     active->SetBufferBase(buffer, base);
@@ -708,6 +836,14 @@ namespace orb
     std::string s = std::string(buffer);
     active->WriteBuffer(s, dataSize, data);
   }
+  ORB_SPEC unsigned long long ORB_API WriteBufferAsync(const char *buffer, size_t dataSize, void *data)
+  {
+    return active->WriteBufferAsync(buffer, dataSize, data);
+  }
+  ORB_SPEC bool ORB_API IsUploadComplete(unsigned long long ticket)
+  {
+    return UploadService::Instance()->Done(ticket);
+  }
   ORB_SPEC void ORB_API WriteUniform(std::string &buffer, void *data)
   {
     active->WriteUniform(buffer, data);
@@ -721,6 +857,12 @@ namespace orb
   {
     active->DispatchCompute(x, y, z);
   }
+  ORB_SPEC void ORB_API DispatchCompute(ORB_FBO const &fbo, int groupWidth, int groupHeight, int z)
+  {
+    if (groupWidth <= 0 || groupHeight <= 0)
+      return;
+    active->DispatchCompute((fbo.width + groupWidth - 1) / groupWidth, (fbo.height + groupHeight - 1) / groupHeight, z);
+  }
 
   ORB_SPEC void ORB_API WriteSubBufferData(std::string &buffer, int index, size_t structSize, void *data)
   {
@@ -747,20 +889,25 @@ namespace orb
   {
     std::string s = std::string(name);
     auto r = active->GetFBOByName(s);
-    return {r.fbo, r.texture};
+    return {r.fbo, r.texture, r.width, r.height, r.u, r.v};
   }
   ORB_SPEC ORB_FBO ORB_API GetFBOByName(std::string &name)
   {
     auto r = active->GetFBOByName(name);
-    return {r.fbo, r.texture};
+    return {r.fbo, r.texture, r.width, r.height, r.u, r.v};
   }
   ORB_SPEC void ORB_API BindActiveFBO(ORB_FBO of)
   {
-    active->BindActiveFBO({of.fbo, of.texture});
+    active->BindActiveFBO({of.fbo, of.texture, of.width, of.height, of.u, of.v});
   }
   ORB_SPEC void ORB_API ClearFBO(ORB_FBO of)
   {
-    active->ClearFBO({of.fbo, of.texture});
+    active->ClearFBO({of.fbo, of.texture, of.width, of.height, of.u, of.v});
+  }
+  ORB_SPEC void ORB_API UpsampleFBO(ORB_FBO source, ORB_FBO target)
+  {
+    active->UpsampleFBO({source.fbo, source.texture, source.width, source.height, source.u, source.v},
+                        {target.fbo, target.texture, target.width, target.height, target.u, target.v});
   }
   ORB_SPEC void ORB_API SetFBOTextureActive(ORB_FBO f, int binding)
   {
@@ -839,6 +986,16 @@ extern "C"
     orb::SetMaterial(id);
   }
 
+  ORB_SPEC int CreateMaterial(Vector3D diffuse, Vector3D specular, float specular_exponent, ORB_texture texture)
+  {
+    return orb::CreateMaterial(diffuse, specular, specular_exponent, texture);
+  }
+
+  ORB_SPEC void UpdateMaterial(int id, Vector3D diffuse, Vector3D specular, float specular_exponent, ORB_texture texture)
+  {
+    orb::UpdateMaterial(id, diffuse, specular, specular_exponent, texture);
+  }
+
   ORB_SPEC void SetLight(Vector4D pos, Vector3D color)
   {
     orb::SetLight(pos, color);
@@ -1000,6 +1157,46 @@ extern "C"
     orb::SetFillMode(f);
   }
 
+  ORB_SPEC void ORB_API SetLayerMode(enum LAYER_MODE mode, int layers)
+  {
+    orb::SetLayerMode(mode, layers);
+  }
+
+  ORB_SPEC void ORB_API SetDynamicResolution(float targetMs, float minScale, float maxScale)
+  {
+    orb::SetDynamicResolution(targetMs, minScale, maxScale);
+  }
+
+  ORB_SPEC float ORB_API GetRenderScale()
+  {
+    return orb::GetRenderScale();
+  }
+
+  ORB_SPEC void ORB_API EnableProfiler(bool on)
+  {
+    orb::EnableProfiler(on);
+  }
+
+  ORB_SPEC ORB_FrameProfile ORB_API GetFrameProfile()
+  {
+    return orb::GetFrameProfile();
+  }
+
+  ORB_SPEC bool ORB_API StartProfileTrace(const char *path)
+  {
+    return orb::StartProfileTrace(path);
+  }
+
+  ORB_SPEC void ORB_API StopProfileTrace()
+  {
+    orb::StopProfileTrace();
+  }
+
+  ORB_SPEC ORB_RenderStats ORB_API GetRenderStats()
+  {
+    return orb::GetRenderStats();
+  }
+
   ORB_SPEC void ORB_API SetZoom(float z)
   {
     orb::SetZoom(z);
@@ -1048,11 +1245,81 @@ extern "C"
     orb::SetCameraRotation(rot);
   }
 
+  ORB_SPEC bool ORB_API MountAssetPack(const char *path)
+  {
+    return orb::MountAssetPack(path);
+  }
+
   ORB_SPEC ORB_texture ORB_API LoadTexture(const char *path)
   {
     return orb::LoadTexture(path);
   }
 
+  ORB_SPEC bool ORB_API LoadAtlas(const char *path)
+  {
+    return orb::LoadAtlas(path);
+  }
+
+  ORB_SPEC ORB_texture ORB_API LoadTextureAsync(const char *path)
+  {
+    return orb::LoadTextureAsync(path);
+  }
+
+  ORB_SPEC bool ORB_API IsTextureReady(ORB_texture t)
+  {
+    return orb::IsTextureReady(t);
+  }
+
+  ORB_SPEC ORB_texture ORB_API LoadVirtualTexture(const char *path)
+  {
+    return orb::LoadVirtualTexture(path);
+  }
+
+  ORB_SPEC ORB_texture ORB_API CreateDynamicTexture(const char *name, int w, int h)
+  {
+    return orb::CreateDynamicTexture(name, w, h);
+  }
+
+  ORB_SPEC bool ORB_API UpdateTexture(ORB_texture t, void const *data)
+  {
+    return orb::UpdateTexture(t, data);
+  }
+
+  ORB_SPEC bool ORB_API UpdateTextureRect(ORB_texture t, int x, int y, int w, int h, int depth, void const *data)
+  {
+    return orb::UpdateTextureRect(t, x, y, w, h, depth, data);
+  }
+
+  ORB_SPEC void ORB_API SetTextureUploadBudget(unsigned bytes)
+  {
+    orb::SetTextureUploadBudget(bytes);
+  }
+
+  ORB_SPEC void ORB_API SetTextureBudget(unsigned long long bytes)
+  {
+    orb::SetTextureBudget(bytes);
+  }
+
+  ORB_SPEC void ORB_API PinTexture(ORB_texture t, bool pinned)
+  {
+    orb::PinTexture(t, pinned);
+  }
+
+  ORB_SPEC ORB_TextureStats ORB_API GetTextureStats()
+  {
+    return orb::GetTextureStats();
+  }
+
+  ORB_SPEC void ORB_API SetShaderCacheDirectory(const char *path)
+  {
+    orb::SetShaderCacheDirectory(path);
+  }
+
+  ORB_SPEC ORB_ShaderCacheStats ORB_API GetShaderCacheStats()
+  {
+    return orb::GetShaderCacheStats();
+  }
+
   ORB_SPEC void ORB_API SetActiveTexture(ORB_texture t)
   {
     orb::SetActiveTexture(t);
@@ -93,6 +93,12 @@ typedef ORB_ENUM BLEND_MODE ORB_ETYPE(int)
   MAX,
 }BLEND_MODE;
 
+typedef ORB_ENUM LAYER_MODE ORB_ETYPE(int)
+{
+  LAYER_FBOS,
+  LAYER_DEPTH,
+}LAYER_MODE;
+
 typedef ORB_ENUM NONPRINTINGKEYS ORB_ETYPE(int)
 {
   KEY_UP = 72,
@@ -138,6 +144,9 @@ typedef ORB_Mesh const* ORB_mesh;
 typedef struct ORB_FontInfo ORB_FontInfo;
 typedef ORB_FontInfo const* ORB_font;
 
+// Written by the PipelineCompiler, see Compiled Pipeline.h
+typedef struct ORB_CompiledPass ORB_CompiledPass;
+
 // SDL Forward declarations
 typedef union SDL_Event SDL_Event;
 typedef SDL_Event* ORB_Event;
@@ -147,8 +156,74 @@ typedef void* SDL_GLContext;
 typedef struct ORB_FBO {
   uint fbo;
   uint texture;
+  // The part of the texture drawn into, in pixels and as a fraction of it to scale UVs by
+  int width;
+  int height;
+  float u;
+  float v;
 }ORB_FBO;
 
+typedef struct ORB_TextureStats {
+  unsigned long long budget;
+  unsigned long long residentBytes;
+  uint residentTextures;
+  uint pinnedTextures;
+  unsigned long long evictions;
+  unsigned long long evictedBytes;
+  unsigned long long reloads;
+}ORB_TextureStats;
+
+typedef struct ORB_ShaderCacheStats {
+  uint hits;
+  uint misses;
+  uint rejected;
+  double buildSeconds;
+}ORB_ShaderCacheStats;
+
+// Times in milliseconds, summed over every time the scope ran in a frame, averages and maximums over the last 128 frames
+typedef struct ORB_ProfileScope {
+  const char* name;
+  int depth;
+  float cpuMs;
+  float gpuMs;
+  float cpuAverageMs;
+  float gpuAverageMs;
+  float cpuMaxMs;
+  float gpuMaxMs;
+  uint calls;
+}ORB_ProfileScope;
+
+typedef struct ORB_FrameProfile {
+  ORB_ProfileScope const* scopes;
+  uint count;
+  unsigned long long frames;
+}ORB_FrameProfile;
+
+#define ORB_FRAME_TIME_BUCKETS 16
+
+// Counts are of the last finished frame, times are in milliseconds over the last 1024 frames
+// histogram counts frames under 2, 4, 6, 8, 10, 12, 14, 16.7, 20, 25, 33.3, 50, 66.7, 100 and 250ms, and the rest
+typedef struct ORB_RenderStats {
+  uint drawCalls;
+  uint instances;
+  unsigned long long vertices;
+  uint uniformWrites;
+  unsigned long long bufferBytes;
+  uint textureBinds;
+  uint fboBinds;
+  uint programSwitches;
+  uint clears;
+  uint performanceMessages;
+  uint droppedTextureUpdates;
+  float frameMs;
+  float p50Ms;
+  float p90Ms;
+  float p99Ms;
+  float maxMs;
+  uint histogram[ORB_FRAME_TIME_BUCKETS];
+  unsigned long long frames;
+}ORB_RenderStats;
+
 typedef void(*KeyCallback)(uchar key, KEY_STATE state);
 typedef void(*MouseButtonCallback)(MOUSEBUTTON button, KEY_STATE state);
 typedef void(*MouseMovmentCallback)(int x, int y, int deltaX, int deltaY);
@@ -248,6 +323,19 @@ namespace orb
   extern ORB_SPEC void EnableShadows(bool b);
   extern ORB_SPEC void SetMaterialProperties(Vector3D diffuse, Vector3D specular, float specular_exponent);
   extern ORB_SPEC void SetMaterial(int id);
+  /**
+   * @brief Create a material that can be selected with SetMaterial.
+   *
+   * @details Materials are hashed on their properties, so creating an identical material
+   * returns the existing id. Only new or changed materials are uploaded to the GPU.
+   * @param texture - texture to use with the material, can be nullptr
+   * @return the id of the material
+   */
+  extern ORB_SPEC int CreateMaterial(Vector3D diffuse, Vector3D specular, float specular_exponent, ORB_texture texture = nullptr);
+  /**
+   * @brief Change the properties of a material made with CreateMaterial.
+   */
+  extern ORB_SPEC void UpdateMaterial(int id, Vector3D diffuse, Vector3D specular, float specular_exponent, ORB_texture texture = nullptr);
   extern ORB_SPEC void SetLight(Vector4D pos, Vector3D color);
   /**
    * @brief Set the stored render mode. 
@@ -445,6 +533,87 @@ namespace orb
    * 2 = Fill
    */
   extern ORB_SPEC void ORB_API SetFillMode(int f);
+  /**
+   * @brief Set how draw layers are kept apart.
+   *
+   * @details LAYER_FBOS draws each layer into its own frame buffer and composites
+   * them at the end of the frame. LAYER_DEPTH draws every layer into Primary 0,
+   * each in its own slice of the depth range, higher layers in front, so no other
+   * layer frame buffer is ever allocated. Layers past the last slice share it.
+   * Translucent draws write depth, so within a layer draw them back to front.
+   *
+   * @param mode - the layer mode, LAYER_FBOS by default
+   * @param layers - how many depth slices LAYER_DEPTH splits the range into
+   */
+  extern ORB_SPEC void ORB_API SetLayerMode(LAYER_MODE mode, int layers = 3);
+  /**
+   * @brief Render the layers at a lower resolution when the GPU falls behind.
+   *
+   * @details The time the GPU is busy each frame, running the render stages
+   * and compositing the FBOs, is measured with timer queries. Time it spends
+   * waiting on the CPU or the swap isn't counted, so a CPU bound or vsync
+   * limited frame keeps its scale. When the busy time runs over the target
+   * the primary and secondary FBOs are drawn at a
+   * smaller scale of the window and stretched over it, when there is time to
+   * spare the scale climbs back up. Nothing is reallocated when it changes.
+   *
+   * @param targetMs - time the GPU should be busy each frame in milliseconds, 0 to always render at full size
+   * @param minScale - the smallest scale of the window to draw at
+   * @param maxScale - the largest scale, at most 1
+   */
+  extern ORB_SPEC void ORB_API SetDynamicResolution(float targetMs, float minScale = 0.5f, float maxScale = 1.f);
+  /**
+   * @brief Get the scale of the window the layers are drawn at.
+   *
+   * @return the scale, 1 unless dynamic resolution has lowered it
+   */
+  extern ORB_SPEC float ORB_API GetRenderScale();
+  /**
+   * @brief Turn the frame profiler on or off, it is off by default.
+   *
+   * @details Each shader stage, each stage callback, FlattenFBOs and the swap
+   * are timed on the CPU and, with timestamp queries read back a few frames
+   * later, on the GPU.
+   *
+   * @param on - true to profile
+   */
+  extern ORB_SPEC void ORB_API EnableProfiler(bool on);
+  /**
+   * @brief Get the profiler's statistics of every scope it has timed.
+   *
+   * @details The first scope is the whole frame, the others are in the order
+   * they were first seen with their depth in the frame. The array is valid
+   * until the next call.
+   *
+   * @return the profile, empty until the profiler has read back a frame
+   */
+  extern ORB_SPEC ORB_FrameProfile ORB_API GetFrameProfile();
+  /**
+   * @brief Write the profiled frames to a Chrome trace-event JSON file, for chrome://tracing or Perfetto.
+   *
+   * @param path - the file, replaced if it exists
+   * @return false if the file couldn't be opened
+   */
+  extern ORB_SPEC bool ORB_API StartProfileTrace(const char* path);
+  /**
+   * @brief Finish the file StartProfileTrace is writing.
+   *
+   */
+  extern ORB_SPEC void ORB_API StopProfileTrace();
+  /**
+   * @brief Get what the last frame submitted and the spread of the last frames' times.
+   *
+   * @details Draw calls count every glDraw the renderer makes, vertices
+   * count each instance, program switches only count changes of program,
+   * performanceMessages counts the GL debug output's performance warnings,
+   * which need a debug context, and droppedTextureUpdates counts
+   * UpdateTexture calls dropped because the GPU was still reading every
+   * buffer of the texture. Frame times are on the CPU from
+   * one Update to the next.
+   *
+   * @return the statistics
+   */
+  extern ORB_SPEC ORB_RenderStats ORB_API GetRenderStats();
   /**
    * @brief Set the zoom level.
    *
@@ -477,6 +646,22 @@ namespace orb
   extern ORB_SPEC void ORB_API SetCameraRotation(Vector3D rot);
   extern ORB_SPEC void ORB_API SetCameraRotation(Vector4D rot);
 
+  // --------------------------------------------------------------------
+  //
+  // Asset Functions
+  //
+  // --------------------------------------------------------------------
+
+  /**
+   * @brief Mount an asset pack (.orbpack) made by the AssetPacker.
+   *
+   * Meshes, textures, fonts, shader sources and .meta files are looked up in the mounted packs
+   * before the disk, by the same path they would be loaded from. Packs mounted later win.
+   * @param path - path to the .orbpack file
+   * @return true if the pack was mounted
+   */
+  extern ORB_SPEC bool ORB_API MountAssetPack(const char* path);
+
   // --------------------------------------------------------------------
   //
   // Texture Functions
@@ -497,6 +682,94 @@ namespace orb
  * @return Returns a pointer to the Texture data structure used in ORB to manage texture
  */
   extern ORB_SPEC ORB_texture ORB_API LoadTexture(const char* path);
+  /**
+   * @brief Load a texture atlas manifest made by the AtlasPacker.
+   *
+   * After loading an atlas, LoadTexture on any of the packed file names returns a sub texture
+   * of the atlas page, which SetActiveTexture, SetUV and DrawRect treat like any other texture.
+   * @param path - path to the .atlas.meta file
+   * @return true if the atlas was loaded
+   */
+  extern ORB_SPEC bool ORB_API LoadAtlas(const char* path);
+  /**
+   * @brief Load a texture from a file without stalling the frame.
+   *
+   * The file is decoded on a worker thread and uploaded a slice at a time during Update.
+   * The returned texture can be used right away, it draws as plain white and reports a
+   * size of 1x1 until IsTextureReady returns true.
+   * @param path - path to the file
+   * @return Returns a pointer to the Texture data structure used in ORB to manage texture
+   */
+  extern ORB_SPEC ORB_texture ORB_API LoadTextureAsync(const char* path);
+  /**
+   * @brief Check if a texture from LoadTextureAsync has finished loading.
+   */
+  extern ORB_SPEC bool ORB_API IsTextureReady(ORB_texture t);
+  /**
+   * @brief Load a .vtex file made by the VirtualTextureBuilder.
+   *
+   * Only the tiles the default shader samples are kept in a fixed size page cache, so
+   * the texture can be far larger than GPU memory. Until a tile is streamed in, the
+   * closest coarser level is drawn. Other shaders and stored rendering draw the coarsest level.
+   * @param path - path to the .vtex file
+   * @return Returns a pointer to the Texture data structure used in ORB to manage texture
+   */
+  extern ORB_SPEC ORB_texture ORB_API LoadVirtualTexture(const char* path);
+  /**
+   * @brief Create an RGBA texture for content that changes every frame, like video.
+   *
+   * Fill it with UpdateTexture. Calling this again with the same name returns the same texture.
+   * @param name - the name of the texture
+   * @param w - the width of the texture
+   * @param h - the height of the texture
+   * @return Returns a pointer to the Texture data structure used in ORB to manage texture
+   */
+  extern ORB_SPEC ORB_texture ORB_API CreateDynamicTexture(const char* name, int w, int h);
+  /**
+   * @brief Replace all the pixels of a dynamic texture.
+   *
+   * The data is copied into a mapped buffer and uploaded asynchronously, the call never waits
+   * on the GPU. If the GPU is still reading every buffer the update is dropped, dropped updates
+   * are counted in GetRenderStats.
+   * @param t - a texture from CreateDynamicTexture
+   * @param data - width * height RGBA pixels
+   * @return true if the update was queued
+   */
+  extern ORB_SPEC bool ORB_API UpdateTexture(ORB_texture t, void const* data);
+  /**
+   * @brief Replace part of a dynamic texture.
+   *
+   * @param t - a texture from CreateDynamicTexture
+   * @param x, y - the top left of the rect
+   * @param w, h - the size of the rect
+   * @param depth - 3 for RGB or 4 for RGBA data
+   * @param data - w * h tightly packed pixels
+   * @return true if the update was queued
+   */
+  extern ORB_SPEC bool ORB_API UpdateTextureRect(ORB_texture t, int x, int y, int w, int h, int depth, void const* data);
+  /**
+   * @brief Set how many bytes of async texture data may be uploaded each Update, 4MB by default.
+   */
+  extern ORB_SPEC void ORB_API SetTextureUploadBudget(unsigned bytes);
+  /**
+   * @brief Set how many bytes of texture data may stay on the GPU, 512MB by default.
+   *
+   * Once over budget the least recently drawn textures are evicted at the end of Update. Textures
+   * drawn in the last frame, pinned textures and textures made in memory are never evicted. An evicted
+   * texture keeps its handle and is reloaded from its file in the background the next time it is drawn.
+   */
+  extern ORB_SPEC void ORB_API SetTextureBudget(unsigned long long bytes);
+  /**
+   * @brief Keep a texture on the GPU whatever the budget, or let it be evicted again.
+   *
+   * @param t - the texture
+   * @param pinned - true to never evict it
+   */
+  extern ORB_SPEC void ORB_API PinTexture(ORB_texture t, bool pinned);
+  /**
+   * @brief Get the current texture memory use and eviction counts.
+   */
+  extern ORB_SPEC ORB_TextureStats ORB_API GetTextureStats();
   /**
    * @brief Get a constant vector holding pointers to all the currently loaded textures.
    */
@@ -719,6 +992,13 @@ namespace orb
   //
   // A `Render Pass` has is denoted by a `.rpass.meta` file. This file contains information about all the
   // shader stages and frame buffers within it
+  //
+  // A `.rpass.meta` can also have a `<Resources>` block saying which frame buffers and buffers each
+  // `Shader Stage` reads and writes (`stage[rw]=name`). The pass is compiled into a graph when it loads,
+  // and these let it place memory barriers and let `[transient]` frame buffers share memory.
+  //
+  // Frame buffers only get memory the first time they are bound. Their brackets can also set the color
+  // format, the depth and a size relative to the window, `bloom=3[rgba16f,nodepth,0.5]`.
   */
   // --------------------------------------------------------------------
 
@@ -730,6 +1010,28 @@ namespace orb
    */
   extern ORB_SPEC void ORB_API LoadCustomRenderPass(std::string const& path);
   extern ORB_SPEC void ORB_API LoadCustomRenderPass(const char* path);
+  /**
+   * @brief Load a Render Pass compiled ahead of time by the PipelineCompiler.
+   *        Note: This will replace the currently active Render Pass, custom or default.
+   *
+   * The pass and its shader sources are already in the program, so nothing is read or parsed.
+   *
+   * @param pass - The pass from the generated .rpass.meta.inc
+   */
+  extern ORB_SPEC void ORB_API LoadCompiledRenderPass(ORB_CompiledPass const* pass);
+  /**
+   * @brief Set where linked shader programs are cached, ./ShaderCache by default.
+   *
+   * Programs are keyed by a hash of their sources, attribute bindings and the driver, so
+   * after the first run shaders are loaded as binaries instead of compiled. Call before
+   * Initialize to cover the default shaders. An empty path turns the cache off.
+   * @param path - the cache directory
+   */
+  extern ORB_SPEC void ORB_API SetShaderCacheDirectory(const char* path);
+  /**
+   * @brief Get how many programs came from the shader cache and how long building programs took.
+   */
+  extern ORB_SPEC ORB_ShaderCacheStats ORB_API GetShaderCacheStats();
 
 
   extern ORB_SPEC void ORB_API SetBufferBase( std::string& buffer, int base);
@@ -745,6 +1047,20 @@ namespace orb
    */
   extern ORB_SPEC void ORB_API WriteBuffer( std::string& buffer, size_t dataSize, void* data);
   extern ORB_SPEC void ORB_API WriteBuffer(const char* buffer, size_t dataSize, void* data);
+  /**
+   * @brief Write data to a buffer on the background upload thread.
+   *        The data is copied, it can be freed as soon as this returns. The buffer must not be
+   *        used until IsUploadComplete returns true for the returned ticket.
+   * @param buffer the buffer name to write to
+   * @param dataSize the size of the data
+   * @param data the data to write
+   * @return a ticket for IsUploadComplete
+   */
+  extern ORB_SPEC unsigned long long ORB_API WriteBufferAsync(const char* buffer, size_t dataSize, void* data);
+  /**
+   * @brief Check if an upload from WriteBufferAsync has finished and is safe to use.
+   */
+  extern ORB_SPEC bool ORB_API IsUploadComplete(unsigned long long ticket);
 
   /**
    * @brief Write an uniform.
@@ -765,6 +1081,20 @@ namespace orb
    * @param z - Workgroup count in z
    */
   extern ORB_SPEC void ORB_API DispatchCompute(int x, int y, int z);
+  /**
+   * @brief Dispatch a compute shader over the drawn part of an FBO.
+   *        Note: If the currently active Shader stage is not a compute shader
+   *              then this does nothing
+   *
+   * @details Enough workgroups are dispatched to cover the FBO's width and
+   * height, which for an FBO declared with a scale are already scaled.
+   *
+   * @param fbo - the FBO from GetFBOByName
+   * @param groupWidth - pixels one workgroup covers in x
+   * @param groupHeight - pixels one workgroup covers in y
+   * @param z - Workgroup count in z
+   */
+  extern ORB_SPEC void ORB_API DispatchCompute(ORB_FBO const& fbo, int groupWidth, int groupHeight, int z = 1);
 
   /**
    * @brief Write to a specific index in a buffer.
@@ -802,6 +1132,10 @@ namespace orb
    *
    * This function retrieves an FBO object by its name.
    *
+   * FBO textures are allocated bigger than the window so resizing doesn't
+   * reallocate them, only the bottom left width by height of the texture is
+   * drawn into. Scale texture coordinates by u and v to sample it.
+   *
    * @param name The name of the FBO.
    * @return ORB_FBO The FBO object.
    */
@@ -817,6 +1151,16 @@ namespace orb
   extern ORB_SPEC void ORB_API BindActiveFBO(ORB_FBO);
   
   extern ORB_SPEC void ORB_API ClearFBO(ORB_FBO);
+  /**
+   * @brief Stretch an FBO over another with bilinear filtering, blended on top.
+   *
+   * This composites an effect rendered into a scaled down FBO, declared
+   * like GLOW=4[0.5] in the .rpass.meta, back at full resolution.
+   *
+   * @param source The FBO to stretch.
+   * @param target The FBO to draw into, an ORB_FBO with fbo 0 for the window.
+   */
+  extern ORB_SPEC void ORB_API UpsampleFBO(ORB_FBO source, ORB_FBO target);
   /**
    * @brief Set an FBO texture as active.
    *
@@ -862,6 +1206,8 @@ extern ORB_SPEC void EnableLighting(bool b);
 extern ORB_SPEC void EnableShadows(bool b);
 extern ORB_SPEC void SetMaterialProperties(Vector3D diffuse, Vector3D specular, float specular_exponent);
 extern ORB_SPEC void SetMaterial(int id);
+extern ORB_SPEC int CreateMaterial(Vector3D diffuse, Vector3D specular, float specular_exponent, ORB_texture texture);
+extern ORB_SPEC void UpdateMaterial(int id, Vector3D diffuse, Vector3D specular, float specular_exponent, ORB_texture texture);
 
 extern ORB_SPEC void SetLight(Vector4D pos, Vector3D color);
 
@@ -1030,6 +1376,61 @@ extern ORB_SPEC void ORB_API SetDefaultRenderMode(int i);
  * 2 = Fill
  */
 extern ORB_SPEC void ORB_API SetFillMode(int f);
+/**
+ * @brief Set how draw layers are kept apart.
+ *
+ * @details LAYER_FBOS draws each layer into its own frame buffer and composites
+ * them at the end of the frame. LAYER_DEPTH draws every layer into Primary 0,
+ * each in its own slice of the depth range, higher layers in front.
+ *
+ * @param mode - the layer mode
+ * @param layers - how many depth slices LAYER_DEPTH splits the range into
+ */
+extern ORB_SPEC void ORB_API SetLayerMode(enum LAYER_MODE mode, int layers);
+/**
+ * @brief Render the layers at a lower resolution when the GPU falls behind.
+ *
+ * @param targetMs - time the GPU should be busy each frame in milliseconds, 0 to always render at full size
+ * @param minScale - the smallest scale of the window to draw at
+ * @param maxScale - the largest scale, at most 1
+ */
+extern ORB_SPEC void ORB_API SetDynamicResolution(float targetMs, float minScale, float maxScale);
+/**
+ * @brief Get the scale of the window the layers are drawn at.
+ *
+ * @return the scale, 1 unless dynamic resolution has lowered it
+ */
+extern ORB_SPEC float ORB_API GetRenderScale();
+/**
+ * @brief Turn the frame profiler on or off, it is off by default.
+ *
+ * @param on - true to profile
+ */
+extern ORB_SPEC void ORB_API EnableProfiler(bool on);
+/**
+ * @brief Get the profiler's statistics of every scope it has timed, the array is valid until the next call.
+ *
+ * @return the profile, empty until the profiler has read back a frame
+ */
+extern ORB_SPEC ORB_FrameProfile ORB_API GetFrameProfile();
+/**
+ * @brief Write the profiled frames to a Chrome trace-event JSON file.
+ *
+ * @param path - the file, replaced if it exists
+ * @return false if the file couldn't be opened
+ */
+extern ORB_SPEC bool ORB_API StartProfileTrace(const char* path);
+/**
+ * @brief Finish the file StartProfileTrace is writing.
+ *
+ */
+extern ORB_SPEC void ORB_API StopProfileTrace();
+/**
+ * @brief Get what the last frame submitted and the spread of the last frames' times.
+ *
+ * @return the statistics
+ */
+extern ORB_SPEC ORB_RenderStats ORB_API GetRenderStats();
 /**
  * @brief Set the zoom level.
  *
@@ -1064,6 +1465,19 @@ extern ORB_SPEC void ORB_API SetCameraRotationAngles(Vector3D rot);
 extern ORB_SPEC void ORB_API SetCameraRotation(Vector4D rot);
 // --------------------------------------------------------------------
 //
+// Asset Functions
+//
+// --------------------------------------------------------------------
+
+/**
+* @brief Mount an asset pack (.orbpack) made by the AssetPacker.
+*
+* @param path - path to the .orbpack file
+* @return true if the pack was mounted
+*/
+extern ORB_SPEC bool ORB_API MountAssetPack(const char* path);
+// --------------------------------------------------------------------
+//
 // Texture Functions
 //
 // --------------------------------------------------------------------
@@ -1075,6 +1489,69 @@ extern ORB_SPEC void ORB_API SetCameraRotation(Vector4D rot);
 * @return Returns a pointer to the Texture data structure used in ORB to manage texture
 */
 extern ORB_SPEC ORB_texture ORB_API LoadTexture(const char* path);
+/**
+* @brief Load a texture atlas manifest made by the AtlasPacker.
+*
+* @param path - path to the .atlas.meta file
+* @return true if the atlas was loaded
+*/
+extern ORB_SPEC bool ORB_API LoadAtlas(const char* path);
+/**
+* @brief Load a texture from a file without stalling the frame.
+*
+* @param path - path to the file
+* @return Returns a placeholder texture that is filled in over the next few Updates
+*/
+extern ORB_SPEC ORB_texture ORB_API LoadTextureAsync(const char* path);
+/**
+ * @brief Check if a texture from LoadTextureAsync has finished loading.
+ */
+extern ORB_SPEC bool ORB_API IsTextureReady(ORB_texture t);
+/**
+* @brief Load a .vtex file made by the VirtualTextureBuilder, streamed in tiles as it is drawn.
+*
+* @param path - path to the .vtex file
+* @return Returns a pointer to the Texture data structure used in ORB to manage texture
+*/
+extern ORB_SPEC ORB_texture ORB_API LoadVirtualTexture(const char* path);
+/**
+* @brief Create an RGBA texture for content that changes every frame, like video.
+*/
+extern ORB_SPEC ORB_texture ORB_API CreateDynamicTexture(const char* name, int w, int h);
+/**
+* @brief Replace all the pixels of a dynamic texture without waiting on the GPU.
+*
+* @return true if the update was queued, false if it was dropped
+*/
+extern ORB_SPEC bool ORB_API UpdateTexture(ORB_texture t, void const* data);
+/**
+* @brief Replace part of a dynamic texture with w * h tightly packed RGB (depth 3) or RGBA (depth 4) pixels.
+*/
+extern ORB_SPEC bool ORB_API UpdateTextureRect(ORB_texture t, int x, int y, int w, int h, int depth, void const* data);
+/**
+ * @brief Set how many bytes of async texture data may be uploaded each Update.
+ */
+extern ORB_SPEC void ORB_API SetTextureUploadBudget(unsigned bytes);
+/**
+ * @brief Set how many bytes of texture data may stay on the GPU.
+ */
+extern ORB_SPEC void ORB_API SetTextureBudget(unsigned long long bytes);
+/**
+ * @brief Keep a texture on the GPU whatever the budget, or let it be evicted again.
+ */
+extern ORB_SPEC void ORB_API PinTexture(ORB_texture t, bool pinned);
+/**
+ * @brief Get the current texture memory use and eviction counts.
+ */
+extern ORB_SPEC ORB_TextureStats ORB_API GetTextureStats();
+/**
+ * @brief Set where linked shader programs are cached, an empty path turns the cache off.
+ */
+extern ORB_SPEC void ORB_API SetShaderCacheDirectory(const char* path);
+/**
+ * @brief Get how many programs came from the shader cache and how long building programs took.
+ */
+extern ORB_SPEC ORB_ShaderCacheStats ORB_API GetShaderCacheStats();
 /**
  * @brief Set the active Texture being renderer, passing a null pointer will remove the current texture.
  */
@@ -0,0 +1,171 @@
+#include "pch.h"
+#include "Program Cache.h"
+#include "ShaderLog.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+  // Written before the binary so a stale or foreign file is never handed to the driver
+  typedef struct CacheHeader
+  {
+    char magic[4];
+    GLenum format;
+    unsigned long long key;
+  }CacheHeader;
+
+  constexpr unsigned long long fnvOffset = 14695981039346656037ull;
+  constexpr unsigned long long fnvPrime = 1099511628211ull;
+
+  void Hash(unsigned long long& h, void const* data, size_t size)
+  {
+    unsigned char const* bytes = static_cast<unsigned char const*>(data);
+    for (size_t i = 0; i < size; ++i)
+      h = (h ^ bytes[i]) * fnvPrime;
+  }
+
+  void Hash(unsigned long long& h, std::string const& s)
+  {
+    // Include the terminator so "ab" + "c" and "a" + "bc" differ
+    Hash(h, s.c_str(), s.size() + 1);
+  }
+}
+
+ProgramCache* ProgramCache::Instance()
+{
+  if (_instance == nullptr)
+    _instance = new ProgramCache();
+  return _instance;
+}
+
+bool ProgramCache::Enabled()
+{
+  if (_supported == -1)
+  {
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    _supported = formats > 0;
+    for (GLenum e : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+    {
+      char const* s = reinterpret_cast<char const*>(glGetString(e));
+      _driver += s != nullptr ? s : "";
+      _driver += '\n';
+    }
+    if (_supported == 0)
+      Log(Warning, "Driver has no program binary formats, shaders will always be compiled");
+  }
+  return _supported == 1 && _directory.empty() == false;
+}
+
+void ProgramCache::SetDirectory(std::string const& directory)
+{
+  _directory = directory;
+}
+
+unsigned long long ProgramCache::Key(std::vector<ShaderSource> const& sources,
+                                     std::unordered_map<std::string, std::pair<GLuint, size_t>> const& attributes)
+{
+  Enabled();
+  unsigned long long h = fnvOffset;
+  Hash(h, _driver);
+  for (ShaderSource const& s : sources)
+  {
+    Hash(h, &s.first, sizeof(s.first));
+    Hash(h, s.second);
+  }
+  // Map order is not stable, hash the bindings in name order
+  std::vector<std::pair<std::string, GLuint>> bindings;
+  for (auto const& a : attributes)
+    bindings.push_back({a.first, a.second.first});
+  std::sort(bindings.begin(), bindings.end());
+  for (auto const& b : bindings)
+  {
+    Hash(h, b.first);
+    Hash(h, &b.second, sizeof(b.second));
+  }
+  return h;
+}
+
+std::string ProgramCache::Path(unsigned long long key) const
+{
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin", key);
+  return (std::filesystem::path(_directory) / name).string();
+}
+
+bool ProgramCache::Load(GLuint program, unsigned long long key)
+{
+  if (Enabled() == false)
+    return false;
+  std::ifstream file(Path(key), std::ios::binary | std::ios::ate);
+  if (file.is_open() == false)
+  {
+    ++_stats.misses;
+    return false;
+  }
+  const size_t size = static_cast<size_t>(file.tellg());
+  CacheHeader header = {};
+  std::vector<char> binary(size > sizeof(header) ? size - sizeof(header) : 0);
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  file.read(binary.data(), binary.size());
+  if (file.good() == false || std::memcmp(header.magic, "ORBP", 4) != 0 || header.key != key || binary.empty())
+  {
+    ++_stats.misses;
+    return false;
+  }
+
+  glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+  GLint linked = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  if (linked == 0)
+  {
+    // Usually a driver update that kept the same version string, the caller recompiles and overwrites it
+    ++_stats.rejected;
+    Log(Warning, "Driver rejected cached program", Path(key));
+    return false;
+  }
+  ++_stats.hits;
+  return true;
+}
+
+void ProgramCache::Store(GLuint program, unsigned long long key)
+{
+  if (Enabled() == false)
+    return;
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+  CacheHeader header = {{'O', 'R', 'B', 'P'}, 0, key};
+  std::vector<char> binary(length);
+  glGetProgramBinary(program, length, &length, &header.format, binary.data());
+
+  std::error_code error;
+  std::filesystem::create_directories(_directory, error);
+  // Write next to the final name and swap it in, another instance may be reading the same file
+  const std::string path = Path(key), temp = path + ".tmp";
+  {
+    std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    file.write(binary.data(), length);
+    if (file.good() == false)
+    {
+      Log(Warning, "Could not write program cache file", temp);
+      return;
+    }
+  }
+  std::filesystem::rename(temp, path, error);
+}
+
+void ProgramCache::AddBuildTime(double seconds)
+{
+  _stats.buildSeconds += seconds;
+}
+
+ProgramCacheStats const& ProgramCache::Stats() const
+{
+  return _stats;
+}
@@ -0,0 +1,90 @@
+/*********************************************************************
+ * @file   Program Cache.h
+ * @brief  Keeps linked program binaries on disk so shaders are only
+ * compiled the first time a program is seen
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#pragma once
+#include <glad.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// The type and source of one stage of a program
+typedef std::pair<GLenum, std::string> ShaderSource;
+
+/**@typedef
+ * @brief What the program cache did since startup.
+ *
+ * @details hits          - programs loaded from a cached binary
+ *          misses        - programs compiled because nothing was cached
+ *          rejected      - cached binaries the driver refused, compiled instead
+ *          buildSeconds  - time spent making programs, cached or not
+ */
+typedef struct ProgramCacheStats
+{
+  unsigned hits = 0;
+  unsigned misses = 0;
+  unsigned rejected = 0;
+  double buildSeconds = 0;
+}ProgramCacheStats;
+
+class ProgramCache
+{
+public:
+  static ProgramCache* Instance();
+
+  /**
+   * @brief Hash everything that decides what a linked program binary looks like.
+   *
+   * @param sources the stages of the program
+   * @param attributes the attribute locations bound before linking
+   * @return the key of the program
+   */
+  unsigned long long Key(std::vector<ShaderSource> const& sources,
+                         std::unordered_map<std::string, std::pair<GLuint, size_t>> const& attributes);
+  /**
+   * @brief Try to give a program its cached binary.
+   *
+   * @param program an unlinked program
+   * @param key the program's key
+   * @return if the program is linked, if not it is still unlinked and has to be compiled
+   */
+  bool Load(GLuint program, unsigned long long key);
+  /**
+   * @brief Save a linked program's binary.
+   *
+   * @param program a program linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+   * @param key the program's key
+   */
+  void Store(GLuint program, unsigned long long key);
+  /**
+   * @brief Add to the time spent building programs.
+   *
+   * @param seconds the time one program took
+   */
+  void AddBuildTime(double seconds);
+
+  // Cache files go in ./ShaderCache by default, an empty directory turns caching off
+  void SetDirectory(std::string const& directory);
+  bool Enabled();
+  ProgramCacheStats const& Stats() const;
+
+private:
+  ProgramCache() = default;
+  ProgramCache(ProgramCache const&) = delete;
+  ProgramCache& operator=(ProgramCache const&) = delete;
+
+  std::string Path(unsigned long long key) const;
+
+  static inline ProgramCache* _instance;
+
+  std::string _directory = "./ShaderCache";
+  // Vendor, renderer and version, a driver update changes the key of every program
+  std::string _driver;
+  int _supported = -1;
+  ProgramCacheStats _stats;
+};
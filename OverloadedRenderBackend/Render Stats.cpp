@@ -0,0 +1,48 @@
+#include "pch.h"
+#include "Render Stats.h"
+#include <algorithm>
+
+RenderStats* RenderStats::Instance()
+{
+  if (_instance == nullptr)
+    _instance = new RenderStats();
+  return _instance;
+}
+
+void RenderStats::EndFrame()
+{
+  const auto now = std::chrono::steady_clock::now();
+  const float ms = std::chrono::duration<float, std::milli>(now - _frameStart).count();
+  _frameStart = now;
+  if (_times.size() < _window)
+    _times.push_back(ms);
+  else
+    _times[_frames % _window] = ms;
+  ++_frames;
+
+  _current.performanceMessages = _performanceMessages.exchange(0, std::memory_order_relaxed);
+  _last = _current;
+  _current = FrameCounters();
+}
+
+FrameTimes RenderStats::Times() const
+{
+  FrameTimes t;
+  if (_times.empty())
+    return t;
+  t.last = _times[(_frames - 1) % _window];
+  std::vector<float> sorted = _times;
+  std::sort(sorted.begin(), sorted.end());
+  auto percentile = [&sorted](float p)
+  { return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))]; };
+  t.p50 = percentile(0.5f);
+  t.p90 = percentile(0.9f);
+  t.p99 = percentile(0.99f);
+  t.max = sorted.back();
+  for (float ms : _times)
+  {
+    const size_t bucket = std::upper_bound(frameTimeBuckets.begin(), frameTimeBuckets.end(), ms) - frameTimeBuckets.begin();
+    ++t.histogram[bucket];
+  }
+  return t;
+}
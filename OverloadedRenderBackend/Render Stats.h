@@ -0,0 +1,128 @@
+/*********************************************************************
+ * @file   Render Stats.h
+ * @brief  Counts the GL work each frame submits and keeps the times of
+ * the last frames for percentiles and a histogram
+ *
+ * @details The draw, bind, upload and clear paths of the renderer count
+ * themselves here. Update ends the frame, which keeps the frame's counts
+ * until the next one ends and starts counting again from 0.
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#pragma once
+#include <glad.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+/**@typedef
+ * @brief What one frame submitted.
+ *
+ * @details vertices    - vertices drawn, every instance counted
+ *          bufferBytes - bytes written into buffers, vertex data included
+ *          performanceMessages - GL debug messages of GL_DEBUG_TYPE_PERFORMANCE
+ *          droppedTextureUpdates - dynamic texture updates dropped because every buffer was in flight
+ */
+typedef struct FrameCounters
+{
+  unsigned drawCalls = 0;
+  unsigned instances = 0;
+  unsigned long long vertices = 0;
+  unsigned uniformWrites = 0;
+  unsigned long long bufferBytes = 0;
+  unsigned textureBinds = 0;
+  unsigned fboBinds = 0;
+  unsigned programSwitches = 0;
+  unsigned clears = 0;
+  unsigned performanceMessages = 0;
+  unsigned droppedTextureUpdates = 0;
+}FrameCounters;
+
+// Upper edges in milliseconds of the frame time histogram's buckets, the last bucket has no upper edge
+constexpr std::array<float, 15> frameTimeBuckets = {2, 4, 6, 8, 10, 12, 14, 16.7f, 20, 25, 33.3f, 50, 66.7f, 100, 250};
+
+/**@typedef
+ * @brief Frame times of the last frames, in milliseconds.
+ *
+ * @details histogram - how many of them fell in each bucket of frameTimeBuckets, and over the last edge
+ */
+typedef struct FrameTimes
+{
+  float last = 0;
+  float p50 = 0;
+  float p90 = 0;
+  float p99 = 0;
+  float max = 0;
+  std::array<unsigned, frameTimeBuckets.size() + 1> histogram = {};
+}FrameTimes;
+
+class RenderStats
+{
+public:
+  static RenderStats* Instance();
+
+  void Draw(unsigned long long vertices, unsigned instances = 1)
+  {
+    ++_current.drawCalls;
+    _current.instances += instances;
+    _current.vertices += vertices * instances;
+  }
+  void UniformWrite() { ++_current.uniformWrites; }
+  void BufferWrite(size_t bytes) { _current.bufferBytes += bytes; }
+  void TextureBind(unsigned count = 1) { _current.textureBinds += count; }
+  void FBOBind() { ++_current.fboBinds; }
+  // Counted only when it changes the program in use
+  void UseProgram(GLuint program)
+  {
+    if (program == _program)
+      return;
+    _program = program;
+    ++_current.programSwitches;
+  }
+  void Clear() { ++_current.clears; }
+  void DroppedTextureUpdate() { ++_current.droppedTextureUpdates; }
+  // The debug callback can be called from the driver's thread
+  void PerformanceMessage() { _performanceMessages.fetch_add(1, std::memory_order_relaxed); }
+
+  /**
+   * @brief Finish the frame's counts and time, call once a frame.
+   *
+   */
+  void EndFrame();
+  /**
+   * @brief What the last finished frame submitted.
+   *
+   */
+  FrameCounters const& LastFrame() const { return _last; }
+  /**
+   * @brief Percentiles and a histogram of the times of the last frames.
+   *
+   */
+  FrameTimes Times() const;
+  /**
+   * @brief How many frames have finished.
+   *
+   */
+  unsigned long long Frames() const { return _frames; }
+
+private:
+  RenderStats() = default;
+  RenderStats(RenderStats const&) = delete;
+  RenderStats& operator=(RenderStats const&) = delete;
+
+  // Frames the percentiles and histogram are taken over
+  static constexpr size_t _window = 1024;
+
+  static inline RenderStats* _instance;
+
+  FrameCounters _current;
+  FrameCounters _last;
+  std::atomic<unsigned> _performanceMessages = 0;
+  GLuint _program = 0;
+
+  std::vector<float> _times;
+  unsigned long long _frames = 0;
+  std::chrono::steady_clock::time_point _frameStart = std::chrono::steady_clock::now();
+};
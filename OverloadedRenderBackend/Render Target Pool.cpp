@@ -0,0 +1,56 @@
+#include "pch.h"
+#include "Render Target Pool.h"
+#include "ShaderLog.hpp"
+#include <algorithm>
+
+RenderTargetPool* RenderTargetPool::Instance()
+{
+  if (_instance == nullptr)
+    _instance = new RenderTargetPool();
+  return _instance;
+}
+
+GLuint RenderTargetPool::Acquire(GLenum format, int width, int height)
+{
+  const textureKey key = {format, width, height};
+  // Most recently idle first, it is the one most likely still in video memory
+  auto idle = std::find_if(_idle.rbegin(), _idle.rend(), [&key](IdleTexture const& t) { return t.key == key; });
+  if (idle != _idle.rend())
+  {
+    const GLuint texture = idle->texture;
+    _idle.erase(std::next(idle).base());
+    _inUse[texture] = key;
+    return texture;
+  }
+
+  GLuint texture = 0;
+  glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+  glTextureStorage2D(texture, 1, format, width, height);
+  // Targets have no mipmaps, the default filter would leave them incomplete to sample
+  glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  _inUse[texture] = key;
+  return texture;
+}
+
+void RenderTargetPool::Release(GLuint texture)
+{
+  if (texture == 0)
+    return;
+  auto it = _inUse.find(texture);
+  if (it == _inUse.end())
+  {
+    Log(Warning, "Render target texture", texture, "was given back to the pool but didn't come from it");
+    return;
+  }
+  _idle.push_back({it->second, texture, _frame});
+  _inUse.erase(it);
+}
+
+void RenderTargetPool::EndFrame()
+{
+  ++_frame;
+  auto stale = std::stable_partition(_idle.begin(), _idle.end(), [this](IdleTexture const& t) { return _frame - t.since <= _idleFrames; });
+  for (auto it = stale; it != _idle.end(); ++it)
+    glDeleteTextures(1, &it->texture);
+  _idle.erase(stale, _idle.end());
+}
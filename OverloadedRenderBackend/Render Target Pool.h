@@ -0,0 +1,91 @@
+/*********************************************************************
+ * @file   Render Target Pool.h
+ * @brief  Hands out the textures frame buffers render into, and takes
+ * them back so the next frame buffer of the same format and size reuses
+ * them instead of allocating
+ *
+ * @details Render passes only ask for textures the first time a frame
+ * buffer is bound, so targets a pass declares but never draws to cost no
+ * memory. Textures given back stay in the pool for a few frames, long
+ * enough for a resize or a new pass to pick them up, then are deleted.
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#pragma once
+#include <glad.h>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+/**@typedef
+ * @brief What the textures of a frame buffer look like.
+ *
+ * @details format - internal format of the color texture, 0 for none
+ *          depth  - internal format of the depth texture, 0 for none
+ *          scale  - size relative to the window
+ *          width  - fixed width, 0 to follow the window
+ *          height - fixed height, 0 to follow the window
+ */
+typedef struct RenderTargetDesc
+{
+  GLenum format = GL_RGBA8;
+  GLenum depth = GL_DEPTH32F_STENCIL8;
+  float scale = 1.f;
+  int width = 0;
+  int height = 0;
+
+  bool operator==(RenderTargetDesc const&) const = default;
+}RenderTargetDesc;
+
+class RenderTargetPool
+{
+public:
+  static RenderTargetPool* Instance();
+
+  /**
+   * @brief Get a texture to render into.
+   *
+   * @details An idle texture of the same format and size is reused, otherwise
+   * a new one is made. Its contents are whatever was last rendered into it.
+   * @param format the internal format
+   * @param width the width
+   * @param height the height
+   * @return the texture
+   */
+  GLuint Acquire(GLenum format, int width, int height);
+  /**
+   * @brief Give a texture back to the pool.
+   *
+   * @param texture a texture from Acquire, 0 is ignored
+   */
+  void Release(GLuint texture);
+  /**
+   * @brief Delete textures that have been idle for a few frames, call once a frame.
+   *
+   */
+  void EndFrame();
+
+private:
+  RenderTargetPool() = default;
+  RenderTargetPool(RenderTargetPool const&) = delete;
+  RenderTargetPool& operator=(RenderTargetPool const&) = delete;
+
+  // format, width, height
+  typedef std::tuple<GLenum, int, int> textureKey;
+  typedef struct IdleTexture
+  {
+    textureKey key;
+    GLuint texture;
+    unsigned long long since;
+  }IdleTexture;
+
+  static inline RenderTargetPool* _instance;
+  // Frames a texture is kept idle before it is deleted
+  static constexpr unsigned long long _idleFrames = 3;
+
+  // Every texture handed out and not given back
+  std::unordered_map<GLuint, textureKey> _inUse;
+  std::vector<IdleTexture> _idle;
+  unsigned long long _frame = 0;
+};
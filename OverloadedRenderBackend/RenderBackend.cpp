@@ -8,12 +8,18 @@
 #include "pch.h"
 #include "RenderBackend.h"
 #include "RenderPass.h"
+#include "ShaderStage.h"
 #include "Textures.h"
 #include "Vertex.h"
 #define GLM_ENABLE_EXPERIMENTAL
 #include <gtx/string_cast.hpp>
 #define LOG_WINDOW_SWAPS 0
 #include "Mesh Library.h"
+#include "Material Library.h"
+#include "Texture Residency.h"
+#include "Upload Service.h"
+#include "Frame Profiler.h"
+#include "Render Stats.h"
 // Used for sending ponter to value containing true or false
 const int zero = 0;
 const int one = 1;
@@ -46,6 +52,7 @@ MessageCallback(GLenum source,
     std::cout << "PORTABILITY";
     break;
   case GL_DEBUG_TYPE_PERFORMANCE:
+    RenderStats::Instance()->PerformanceMessage();
     std::cout << "PERFORMANCE";
     break;
   case GL_DEBUG_TYPE_OTHER:
@@ -332,14 +339,23 @@ void Renderer::LoadRenderPass(std::string path)
 
 void Renderer::LoadRenderPass(const char *path)
 {
-  local = this;
-  custom = true;
   // TODO: Make this check for API version
+  UseRenderPass(new RenderPass(path));
+}
+
+void Renderer::LoadRenderPass(ORB_CompiledPass const &pass)
+{
+  UseRenderPass(new RenderPass(pass));
+}
 
+void Renderer::UseRenderPass(RenderPass *pass)
+{
+  local = this;
+  custom = true;
   if (_activePass != nullptr)
     delete _activePass;
 
-  _activePass = new RenderPass(path);
+  _activePass = pass;
   for (auto &w : activeWindows)
   {
     w->VAO = "";
@@ -353,6 +369,23 @@ void Renderer::WriteBuffer(std::string buffer, size_t dataSize, void *data)
   _activePass->UnBindBuffer(buffer);
 }
 
+unsigned long long Renderer::WriteBufferAsync(std::string buffer, size_t dataSize, void *data)
+{
+  shaderBuffer b = _activePass->GetBuffer(buffer);
+  // Vertex arrays are not shared with the upload context, those are written here
+  if (b.second == GL_ARRAY_BUFFER_BINDING)
+  {
+    WriteBuffer(buffer, dataSize, data);
+    return 0;
+  }
+  std::vector<unsigned char> copy;
+  if (data != nullptr)
+    copy.assign(static_cast<unsigned char *>(data), static_cast<unsigned char *>(data) + dataSize);
+  RenderStats::Instance()->BufferWrite(dataSize);
+  return UploadService::Instance()->Submit([name = b.first, dataSize, copy = std::move(copy)]
+                                           { glNamedBufferData(name, dataSize, copy.empty() ? nullptr : copy.data(), GL_STATIC_DRAW); });
+}
+
 void Renderer::WriteUniform(std::string uniform, void *data)
 {
   _activePass->WriteAttribute(uniform, data);
@@ -426,11 +459,7 @@ void Renderer::WriteRenderConstantsHere()
   }
   _activePass->WriteAttribute("screenMatrix", &_storedProjection[0][0]);
   _activePass->WriteAttribute("zoom", &_zoom);
-  if (_activePass->QuerryAttribute("texMulti"))
-  {
-    const glm::mat4 iden = glm::identity<glm::mat4>();
-    _activePass->WriteAttribute("texMulti", (void *)&iden[0][0]);
-  }
+  SetUV(glm::identity<glm::mat4>());
   if (enableLighting) {
     glm::vec3 pos = mainCamera.Position();
     _activePass->WriteAttribute("eye_position", &pos);
@@ -463,7 +492,7 @@ void Renderer::DrawRect(glm::vec2 pos, glm::vec2 scale, float rot, uint depth)
   {
     if (_window->primary == true)
     {
-      _activePass->BindActiveFBO(depth);
+      BindLayer(depth);
       if (depth == 2)
       {
         _activePass->WriteAttribute("screenMatrix", &_projectionMatrix[0][0]);
@@ -496,6 +525,7 @@ void Renderer::DrawRect(glm::vec2 pos, glm::vec2 scale, float rot, uint depth)
   glBindVertexArray(m.VAO());
   glBindBuffer(GL_ARRAY_BUFFER, m.Buffer());
   glDrawArrays(m.DrawMode(), 0, static_cast<int>(m.Size()));
+  RenderStats::Instance()->Draw(m.Size());
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindVertexArray(0);
   if (depth == 2)
@@ -509,11 +539,14 @@ void Renderer::DrawMesh(ORB_Mesh const &v, uint depth)
     const_cast<ORB_Mesh &>(v).AddCall(_currentObject);
     return;
   }
+  // Big meshes are drawn once the upload thread has filled their buffer
+  if (v.Ready() == false)
+    return;
   if (depth != UINT_MAX)
   {
     if (_window->primary == true)
     {
-      _activePass->BindActiveFBO(depth);
+      BindLayer(depth);
       if (depth == 2)
       {
         _activePass->WriteAttribute("screenMatrix", &_projectionMatrix[0][0]);
@@ -539,6 +572,7 @@ void Renderer::DrawMesh(ORB_Mesh const &v, uint depth)
   glBindVertexArray(v.VAO());
   glBindBuffer(GL_ARRAY_BUFFER, v.Buffer());
   glDrawArrays(v.DrawMode(), 0, static_cast<int>(v.Size()));
+  RenderStats::Instance()->Draw(v.Size());
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindVertexArray(0);
   if (depth == 2)
@@ -579,10 +613,12 @@ void Renderer::DrawIndexed(ORB_Mesh const &v, int count)
     const_cast<ORB_Mesh &>(v).AddCall(_currentObject);
     return;
   }
+  if (v.Ready() == false)
+    return;
 
   if (_window->primary == true)
   {
-    _activePass->BindActiveFBO(1);
+    BindLayer(1);
   }
   else
   {
@@ -602,6 +638,7 @@ void Renderer::DrawIndexed(ORB_Mesh const &v, int count)
   glBindVertexArray(v.VAO());
   glBindBuffer(GL_ARRAY_BUFFER, v.Buffer());
   glDrawArraysInstanced(v.DrawMode(), 0, static_cast<int>(v.Size()), count);
+  RenderStats::Instance()->Draw(v.Size(), count);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindVertexArray(0);
 }
@@ -650,11 +687,14 @@ void Renderer::EnableLighting(bool value)
 int StoredUpdate()
 {
   std::vector<ORB_Mesh *> const &meshes = MeshLibrary::Instance()->GetMeshes();
-  std::string fbo = "Primary 1";
+  std::string fbo = "Primary " + std::to_string(local->LayerTarget(1));
   local->BindActiveFBO(local->GetFBOByName(fbo));
+  local->SetLayerDepth(1);
   local->SetBufferBase("RenderBuffer", 0);
-  local->SetBufferBase("MaterialBuffer",1);
-  local->WriteBuffer("MaterialBuffer", sizeof(Renderer::MaterialInfo) * local->_materials.size(), local->_materials.data());
+  MaterialLibrary::Instance()->Upload();
+  MaterialLibrary::Instance()->Bind(1);
+  TextureResidency::Instance()->Bind(1);
+  local->WriteUniform("residentTextures", (void *)&one);
   local->WriteRenderConstantsHere();
   for (auto &mesh : meshes)
   {
@@ -718,17 +758,7 @@ void Renderer::SetMaterial(glm::vec3 diff, glm::vec3 spec, float specExp)
 {
   if (storedRender)
   {
-    auto l = std::find_if(_materials.begin(), _materials.end(), [&diff, &spec, specExp](MaterialInfo const &material) -> bool
-                          { return material.diff == diff && material.spec == spec && material.specExp == specExp; });
-    if (l == _materials.end())
-    {
-      _currentObject.materialID = _materials.size();
-      _materials.push_back({.diff = diff, .spec = spec, .specExp = specExp});
-    }
-    else
-    {
-      _currentObject.materialID = l - _materials.begin();
-    }
+    _currentObject.materialID = MaterialLibrary::Instance()->CreateMaterial(diff, spec, specExp);
     return;
   }
 
@@ -754,9 +784,21 @@ void Renderer::SetMaterial(glm::vec3 diff, glm::vec3 spec, float specExp)
 
 void Renderer::SetMaterial(int id)
 {
-  if (id < 0 || id >= _materials.size())
+  MaterialLibrary *library = MaterialLibrary::Instance();
+  if (library->Valid(id) == false)
+    return;
+  if (storedRender)
+  {
+    _currentObject.materialID = id;
+    if (library->GetTexture(id) != nullptr)
+      SetActiveTexture(library->GetTexture(id));
     return;
-  _currentObject.materialID = id;
+  }
+  // Immediate mode has no MaterialBuffer, so write the material as uniforms
+  MaterialInfo const &m = library->Get(id);
+  SetMaterial(m.diffuse, m.specular, m.specularExponent);
+  if (library->GetTexture(id) != nullptr)
+    SetActiveTexture(library->GetTexture(id));
 }
 
 glm::vec2 Renderer::GetWindowSize(Window *w)
@@ -791,28 +833,43 @@ void Renderer::Update()
 {
   //Log(Message, "Updated");
 
-  while (_activePass->CurrentStage() != renderStage::PostFrameSwap)
-  {
-    _activePass->Update();
-    _activePass->RunStage();
-  }
+  // Only the spans the GPU has work in are timed, not the gaps where it waits on the CPU
+  _dynamicResolution.BeginWork();
+  _activePass->Run(renderStage::PreRender, renderStage::PreFrameSwap);
+  _dynamicResolution.EndWork();
+  // Passes after the layers see the whole depth range again
+  if (_depthLayers != 0)
+    glDepthRange(0, 1);
 
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  RenderStats::Instance()->FBOBind();
   CheckError(__LINE__);
-  _activePass->Update();
-  _activePass->RunStage();
+  _dynamicResolution.BeginWork();
+  _activePass->Run(renderStage::PostFrameSwap, renderStage::PostFrameSwap);
+  _dynamicResolution.EndWork();
 
   SetActiveWindow(defaultWindow);
-  _activePass->FlattenFBOs();
+  {
+    ProfileScope flattenScope("FlattenFBOs");
+    _dynamicResolution.BeginWork();
+    _activePass->FlattenFBOs();
+    _dynamicResolution.EndWork();
+  }
+  _dynamicResolution.EndFrame();
 
-  if (activeWindows.size() > 1)
-    glFlush();
-  for (auto win : activeWindows)
   {
-    SetActiveWindow(win);
-    SDL_GL_SwapWindow(win->window);
-    glClearColor(win->r, win->g, win->b, win->a);
-    glClear(GL_COLOR_BUFFER_BIT);
+    // The swap waits on the CPU, the GPU sees nothing of it
+    ProfileScope swapScope("Swap", false);
+    if (activeWindows.size() > 1)
+      glFlush();
+    for (auto win : activeWindows)
+    {
+      SetActiveWindow(win);
+      SDL_GL_SwapWindow(win->window);
+      glClearColor(win->r, win->g, win->b, win->a);
+      glClear(GL_COLOR_BUFFER_BIT);
+      RenderStats::Instance()->Clear();
+    }
   }
   SetActiveWindow(defaultWindow);
   glClearColor(defaultWindow->r, defaultWindow->g, defaultWindow->b, defaultWindow->a);
@@ -820,6 +877,13 @@ void Renderer::Update()
   UpdateRenderConstants();
   CheckError(__LINE__);
   _activePass->ResetRender();
+  // Frame buffer textures nothing has taken back since a resize or a pass change are deleted after a few frames
+  RenderTargetPool::Instance()->EndFrame();
+  // The next frame's draws start now, at the scale the last frames' GPU times call for
+  FrameProfiler::Instance()->EndFrame();
+  RenderStats::Instance()->EndFrame();
+  _dynamicResolution.BeginFrame();
+  _activePass->SetRenderScale(_dynamicResolution.Scale());
 
   // SDL_UpdateWindowSurface(_window);
   CheckError(__LINE__);
@@ -836,7 +900,19 @@ void Renderer::SetProjectionMode(int i)
 
 void Renderer::SetActiveTexture(ORB_Texture *t)
 {
-  if (_activePass->QuerryAttribute("textured") == false)
+  if (t != nullptr)
+    TextureManager::Instance()->Touch(t);
+  if (storedRender)
+  {
+    // Instances carry their own texture so a mesh can be drawn with many textures in one draw
+    ResidentTexture const &r = TextureResidency::Instance()->MakeResident(t);
+    _currentObject.layer = r.layer;
+    _currentObject.uvRect = r.uvRect;
+    if (r.layer != -1)
+      return;
+  }
+  if (_activePass->HasVariant(static_cast<unsigned>(shaderVariant::textured)) == false &&
+      _activePass->QuerryAttribute("textured") == false)
   {
     std::cerr << "ORB ERROR: To use textures,  render stage must contain int bound to name: textured" << std::endl;
     throw std::invalid_argument(
@@ -850,16 +926,75 @@ void Renderer::SetActiveTexture(ORB_Texture *t)
   }
   if (t == nullptr)
   {
-    _activePass->WriteAttribute("textured", (void *)&zero);
+    SelectTextured(false);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, 0);
+    _activeUVRect = {0, 0, 1, 1};
     return;
   }
   _activePass->WriteAttribute("tex", (void *)&zero);
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, t->texture());
+  RenderStats::Instance()->TextureBind();
+  if (_activePass->QuerryAttribute("virtualTextured"))
+  {
+    // Stages that can't page fall back to the coarsest level bound above
+    VirtualTexture const *vt = t->Virtual();
+    _activePass->WriteAttribute("virtualTextured", (void *)(vt != nullptr ? &one : &zero));
+    if (vt != nullptr)
+    {
+      const int indirectionUnit = 2;
+      const glm::vec4 info = vt->Info(), page = vt->PageInfo();
+      vt->Bind(0, indirectionUnit, 2);
+      _activePass->WriteAttribute("vtIndirection", (void *)&indirectionUnit);
+      _activePass->WriteAttribute("vtInfo", (void *)&info);
+      _activePass->WriteAttribute("vtPage", (void *)&page);
+    }
+  }
 
-  _activePass->WriteAttribute("textured", (void *)&one);
+  SelectTextured(true);
+  if (_activeUVRect != t->UVRect())
+  {
+    _activeUVRect = t->UVRect();
+    SetUV(_uv);
+  }
+}
+
+void Renderer::SelectTextured(bool on)
+{
+  if (_activePass->HasVariant(static_cast<unsigned>(shaderVariant::textured)))
+    SelectVariant(static_cast<unsigned>(shaderVariant::textured), on);
+  else
+    _activePass->WriteAttribute("textured", (void *)(on ? &one : &zero));
+}
+
+void Renderer::SelectLighting(bool on)
+{
+  if (_activePass->HasVariant(static_cast<unsigned>(shaderVariant::lighting)))
+    SelectVariant(static_cast<unsigned>(shaderVariant::lighting), on);
+  else
+    _activePass->WriteAttribute("enableLighting", (void *)(on ? &one : &zero));
+}
+
+void Renderer::SelectVariant(unsigned flag, bool on)
+{
+  if (on)
+    _variant |= flag;
+  else
+    _variant &= ~flag;
+  _activePass->SelectVariant(_variant);
+}
+
+void Renderer::SetUV(glm::mat4 const &uv)
+{
+  _uv = uv;
+  if (_activePass->QuerryAttribute("texMulti") == false)
+    return;
+  // Atlas sub textures map the 0-1 UV space onto their rect of the page
+  glm::mat4 rect = glm::translate(glm::identity<glm::mat4>(), glm::vec3(_activeUVRect.x, _activeUVRect.y, 0));
+  rect = glm::scale(rect, glm::vec3(_activeUVRect.z, _activeUVRect.w, 1));
+  const glm::mat4 final = rect * uv;
+  _activePass->WriteAttribute("texMulti", (void *)&final[0][0]);
 }
 
 void Renderer::BindBuffer(std::string buffer)
@@ -877,6 +1012,8 @@ bool Renderer::QueryAndSet(std::string name)
   if (_activePass->QuerryStage(name))
   {
     _activePass->SetSpecificStage(name);
+    // The render state carries over to whichever stage draws next
+    _activePass->SelectVariant(_variant);
     return true;
   }
   return false;
@@ -913,7 +1050,11 @@ void Renderer::UpdateRenderConstants()
     std::cerr << "ORB ERROR: Main rendering stage must have float named 'zooom'. This float will be used for proper zooming of camera" << std::endl;
     throw std::invalid_argument("ORB ERROR: Main rendering stage must have float named 'zooom'. This float will be used for proper zooming of camera");
   }
-  if (enableLighting)
+  if (_activePass->HasVariant(static_cast<unsigned>(shaderVariant::lighting)))
+  {
+    SelectVariant(static_cast<unsigned>(shaderVariant::lighting), enableLighting);
+  }
+  else if (enableLighting)
   {
     if (_activePass->QuerryAttribute("enableLighting") == false)
     {
@@ -953,11 +1094,7 @@ void Renderer::UpdateRenderConstants()
   }
   _activePass->WriteAttribute("screenMatrix", &_storedProjection[0][0]);
   _activePass->WriteAttribute("zoom", &_zoom);
-  if (_activePass->QuerryAttribute("texMulti"))
-  {
-    const glm::mat4 iden = glm::identity<glm::mat4>();
-    _activePass->WriteAttribute("texMulti", (void *)&iden[0][0]);
-  }
+  SetUV(glm::identity<glm::mat4>());
   if (enableLighting) {
     glm::vec3 pos = mainCamera.Position();
     _activePass->WriteAttribute("eye_position", &pos);
@@ -999,6 +1136,39 @@ void Renderer::SetFillMode(int i)
   glPolygonMode(GL_FRONT_AND_BACK, _activePolyMode);
 }
 
+void Renderer::SetLayerMode(int mode, int layers)
+{
+  _depthLayers = mode == 0 ? 0 : static_cast<uint>(std::max(layers, 1));
+  if (_depthLayers == 0)
+    glDepthRange(0, 1);
+}
+
+void Renderer::SetDynamicResolution(float targetMs, float minScale, float maxScale)
+{
+  _dynamicResolution.Configure(targetMs, minScale, maxScale);
+  _activePass->SetRenderScale(_dynamicResolution.Scale());
+}
+
+uint Renderer::LayerTarget(uint layer) const
+{
+  return _depthLayers == 0 ? layer : 0;
+}
+
+void Renderer::SetLayerDepth(uint layer)
+{
+  if (_depthLayers == 0)
+    return;
+  // Higher layers get the nearer slice, so with GL_LESS they always land on top of lower ones
+  const double slice = std::min(layer, _depthLayers - 1);
+  glDepthRange(1 - (slice + 1) / _depthLayers, 1 - slice / _depthLayers);
+}
+
+void Renderer::BindLayer(uint layer)
+{
+  _activePass->BindActiveFBO(LayerTarget(layer));
+  SetLayerDepth(layer);
+}
+
 void Renderer::SetBlendMode(int z)
 {
   glEnable(GL_BLEND);
@@ -1029,8 +1199,10 @@ void Renderer::BindTextureToUnit(ORB_Texture *tex, int texture)
 {
   if (texture < 0 or texture > 31)
     throw std::runtime_error("Attempted to bind to non-existant texture Unit");
+  TextureManager::Instance()->Touch(tex);
   glActiveTexture(GL_TEXTURE0 + texture);
   glBindTexture(GL_TEXTURE_2D, tex->texture());
+  RenderStats::Instance()->TextureBind();
 }
 
 void Renderer::BindTextureToUnit(uint tex, int unit)
@@ -1039,6 +1211,7 @@ void Renderer::BindTextureToUnit(uint tex, int unit)
     throw std::runtime_error("Attempted to bind to non-existant texture Unit");
   glActiveTexture(GL_TEXTURE0 + unit);
   glBindTexture(GL_TEXTURE_2D, tex);
+  RenderStats::Instance()->TextureBind();
 }
 
 fboinfo Renderer::GetFBOByName(std::string &s)
@@ -1061,21 +1234,33 @@ fboinfo Renderer::GetFBOByName(std::string &s)
   {
     res = _activePass->GetFrameBuffer(s);
   }
-  return {res.first, res.second};
+  if (res.first == 0)
+    return {0, 0, 0, 0, 0, 0};
+  // The textures can be bigger than the window, only the viewport is drawn into
+  const glm::ivec2 size = _activePass->ViewportSize(res.first);
+  const glm::vec2 uv = _activePass->ViewportScale(res.first);
+  return {res.first, res.second, size.x, size.y, uv.x, uv.y};
 }
 
 void Renderer::BindActiveFBO(fboinfo f)
 {
-  glBindFramebuffer(GL_FRAMEBUFFER, f.fbo);
+  _activePass->BindFrameBuffer(f.fbo);
+}
+
+void Renderer::UpsampleFBO(fboinfo source, fboinfo target)
+{
+  _activePass->Upsample(source.texture, {source.u, source.v}, target.fbo);
 }
 
 void Renderer::ClearFBO(fboinfo f)
 {
   glClearColor(0, 0, 0, 0);
   glBindFramebuffer(GL_FRAMEBUFFER, f.fbo);
+  RenderStats::Instance()->FBOBind();
   if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
     return;
   glClear(GL_COLOR_BUFFER_BIT);
+  RenderStats::Instance()->Clear();
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
@@ -11,10 +11,12 @@
 #include <SDL.h>
 #include <array>
 #include "Camera.h"
+#include "Dynamic Resolution.h"
 #include "Fonts.h"
 #include "Mesh.h"
 
 class RenderPass;
+typedef struct ORB_CompiledPass ORB_CompiledPass;
 typedef int (*renderCallBack)();
 typedef unsigned int uint;
 typedef struct ORB_Texture Texture;
@@ -47,6 +49,10 @@ typedef struct Window
 typedef struct fboinfo {
   uint fbo;
   uint texture;
+  int width;
+  int height;
+  float u;
+  float v;
 }fboinfo;
 
 class Renderer
@@ -75,6 +81,7 @@ public:
   void DestroyWindow(Window* w);
 
   void LoadRenderPass(std::string path);
+  void LoadRenderPass(ORB_CompiledPass const& pass);
   void LoadRenderPass(const char* path);
 
   void RegisterCallBack(int stage, int id, renderCallBack fn);
@@ -102,10 +109,15 @@ public:
   void SetProjectionMode(int);
 
   void SetActiveTexture(ORB_Texture* t);
+  // Through the shader variant when the stage has one, otherwise through the textured/enableLighting uniforms
+  void SelectTextured(bool on);
+  void SelectLighting(bool on);
+  void SetUV(glm::mat4 const& uv);
   
   void BindBuffer(std::string buffer);
   void UnbindBuffer(std::string buffer);
   void WriteBuffer(std::string buffer, size_t dataSize, void* data);
+  unsigned long long WriteBufferAsync(std::string buffer, size_t dataSize, void* data);
   void WriteSubBufferData(std::string, int index, size_t structSize, void* data);
   void SetBufferBase(std::string buffer, int base);
   void WriteUniform(std::string buffer, void* data);
@@ -126,6 +138,7 @@ public:
   fboinfo GetFBOByName(std::string&);
   void BindActiveFBO(fboinfo f);
   void ClearFBO(fboinfo f);
+  void UpsampleFBO(fboinfo source, fboinfo target);
 
   ORB_Texture* RenderText(const char*, glm::vec4 const&, int);
   FontInfo const* ActiveFont();
@@ -138,6 +151,13 @@ public:
 
   void SetFillMode(int i);
 
+  void SetLayerMode(int mode, int layers);
+  uint LayerTarget(uint layer) const;
+
+  void SetDynamicResolution(float targetMs, float minScale, float maxScale);
+  float RenderScale() const { return _dynamicResolution.Scale(); }
+  void SetLayerDepth(uint layer);
+
   bool QueryAndSet(std::string name);
 
   void ResizeFBOs();
@@ -146,13 +166,6 @@ public:
   float  _zoom = 1;
 
   bool Stored() const {return storedRender;}
-  struct MaterialInfo {
-    glm::vec3 diff;
-    float buffer;
-    glm::vec3 spec;
-    float specExp;
-  };
-  std::vector<MaterialInfo> _materials;
 
   glm::mat4& projecton() {
     return _storedProjection;
@@ -166,6 +179,9 @@ public:
 private:
 
   void UpdateRenderConstants();
+  void UseRenderPass(RenderPass* pass);
+  void SelectVariant(unsigned flag, bool on);
+  void BindLayer(uint layer);
 
   // Projection mode
   int _projection = 0;
@@ -200,8 +216,18 @@ private:
   bool storedRender = false;
   bool _enableShadows = false;
   bool custom = false;
+  // shaderVariant flags of the render state
+  unsigned _variant = 0;
+  // Layers sharing Primary 0 as slices of the depth range, 0 for a frame buffer per layer
+  uint _depthLayers = 0;
+  // Scales the layers down when the GPU runs over its frame time
+  DynamicResolution _dynamicResolution;
 
   RenderInformation _currentObject;
 
+  // Sub rect of the active texture on its atlas page, and the UV transform set by the user
+  glm::vec4 _activeUVRect = {0, 0, 1, 1};
+  glm::mat4 _uv = glm::identity<glm::mat4>();
+
 
 };
@@ -12,8 +12,12 @@
 #include "RenderBackend.h"
 #include "ShaderStage.h"
 #include "Stream.h"
+#include "Compiled Pipeline.h"
+#include "Frame Profiler.h"
+#include "Render Stats.h"
 #include <algorithm>
 #include <tuple>
+#include <utility>
 
 #ifndef _countof
 #define _countof(array) (sizeof(array) / sizeof(array[0]))
@@ -25,6 +29,40 @@ void CheckError(int);
 extern std::vector<Window *> activeWindows;
 extern Window *defaultWindow;
 extern unsigned int _activePolyMode;
+
+// Layers FlattenFBOs composites in one draw, must match maxLayers in flatten.frag
+constexpr int compositeLayers = 16;
+
+// The glMemoryBarrier bit that makes shader writes to a buffer visible to how the buffer is used
+static GLbitfield BufferBarrier(GLenum target)
+{
+  switch (target)
+  {
+  case GL_ARRAY_BUFFER:
+    return GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT;
+  case GL_ELEMENT_ARRAY_BUFFER:
+    return GL_ELEMENT_ARRAY_BARRIER_BIT;
+  case GL_UNIFORM_BUFFER:
+    return GL_UNIFORM_BARRIER_BIT;
+  case GL_ATOMIC_COUNTER_BUFFER:
+    return GL_ATOMIC_COUNTER_BARRIER_BIT;
+  case GL_DISPATCH_INDIRECT_BUFFER:
+    return GL_COMMAND_BARRIER_BIT;
+  case GL_PIXEL_PACK_BUFFER:
+  case GL_PIXEL_UNPACK_BUFFER:
+    return GL_PIXEL_BUFFER_BARRIER_BIT;
+  case GL_TEXTURE_BUFFER:
+    return GL_TEXTURE_FETCH_BARRIER_BIT;
+  case GL_TRANSFORM_FEEDBACK_BUFFER:
+    return GL_TRANSFORM_FEEDBACK_BARRIER_BIT;
+  case GL_QUERY_BUFFER:
+    return GL_QUERY_BUFFER_BARRIER_BIT;
+  case GL_SHADER_STORAGE_BUFFER:
+    return GL_SHADER_STORAGE_BARRIER_BIT;
+  default:
+    return GL_BUFFER_UPDATE_BARRIER_BIT;
+  }
+}
 void RenderPass::WriteAttribute(std::string s, void *data)
 {
   std::get<2>(_activeShaderStage)->WriteAttribute(s, data);
@@ -45,6 +83,7 @@ void RenderPass::WriteSubBufferData(std::string s, int index, size_t structSize,
     auto &bufferObject = _buffers[s];
     glBufferSubData(bufferObject.second, index * structSize, structSize, data);
   }
+  RenderStats::Instance()->BufferWrite(structSize);
 }
 
 void RenderPass::SetBufferBase(std::string buffer, int base)
@@ -60,98 +99,126 @@ void RenderPass::SetBufferBase(std::string buffer, int base)
   }
 }
 
+shaderBuffer RenderPass::GetBuffer(std::string buffer)
+{
+  if (CheckBufferExists(buffer))
+    return std::get<2>(_activeShaderStage)->GetBuffer(buffer);
+  return _buffers[buffer];
+}
+
 void RenderPass::FlattenFBOs()
 {
-  glDisable(GL_DEPTH_TEST);
-  glDisable(GL_CULL_FACE);
-  glCullFace(GL_BACK);
   const SDL_Window *const pr = SDL_GL_GetCurrentWindow();
   if (pr != defaultWindow->window)
     return;
 
-  auto &s = _flattenStage;
-  s->SetActive();
-  // std::cout << "Flattening" << std::endl;
-
-  auto &fbos = GetPrimaryFBOs();
-  constexpr int bindings[1] = {1};
-  s->WriteAttribute("FBO", (void *)&bindings[0]);
-  struct Vertex
+  // Back to front, layers nothing drew into this frame are clear and left out
+  std::vector<GLuint> layers;
+  for (frameBufferObject const &fbo : GetPrimaryFBOs())
   {
-    glm::vec2 pos;
-    glm::vec2 tex;
-  };
+    if (std::get<2>(fbo) != 0 && _targetStates[std::get<1>(fbo)].written)
+      layers.push_back(std::get<2>(fbo));
+  }
+  if (layers.empty())
+    return;
 
-  // This essentially an a mesh in NDC
-  const Vertex mesh[4] = {{{-1.f, -1.f}, {0, 0}},
-                          {{-1.f, 1.f}, {0, 1}},
-                          {{1.f, 1.f}, {1, 1}},
-                          {{1.f, -1.f}, {1, 0}}};
   BindActiveFBO(-1);
+  // A triangle over the whole screen, it faces forward so culling can stay on
+  glDisable(GL_DEPTH_TEST);
   glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-  s->BindBuffer("VAO");
-  s->BindBuffer("VBO");
-#ifndef __CLANG
-<<<<<<< Updated upstream
-  if constexpr (std::endian::native == std::endian::little)
-=======
-  if constexpr (std::endian::native == std::endian::big)
->>>>>>> Stashed changes
-  {
-    s->WriteBuffer("VBO", _countof(mesh) * sizeof(Vertex), nullptr);
-    for (int i = 0; i < _countof(mesh); ++i)
-    {
-      Vertex const &v = mesh[i];
-      glBufferSubData(GL_ARRAY_BUFFER, (i * sizeof(Vertex)) + 0,
-                      sizeof(Vertex::tex), &(v.tex));
-      glBufferSubData(GL_ARRAY_BUFFER,
-                      (i * sizeof(Vertex)) + 0 + sizeof(Vertex::tex),
-                      sizeof(Vertex::pos), &(v.pos));
-    }
-  }
-  else if constexpr (std::endian::native == std::endian::little)
+  auto &s = _flattenStage;
+  s->SetActive();
+  if (_compositeVAO == 0)
+    glCreateVertexArrays(1, &_compositeVAO);
+  glBindVertexArray(_compositeVAO);
+
+  // Layer i samples unit i + 1, unit 0 is left to whatever the stages bound
+  int units[compositeLayers];
+  for (int i = 0; i < compositeLayers; ++i)
+    units[i] = i + 1;
+  s->WriteUniform(s->UniformIndex("layers"), units, compositeLayers);
+  // The layers are bigger than the window, only the part the viewport drew is shown
+  const glm::vec2 viewportScale = ViewportScale(std::get<1>(_primaryFBOs[0]));
+  s->WriteUniform(s->UniformIndex("viewportScale"), &viewportScale);
+  const int layerCount = s->UniformIndex("layerCount");
+  // Every layer in one draw, more layers than the shader takes are done in batches blended on top
+  for (size_t first = 0; first < layers.size(); first += compositeLayers)
   {
-#endif
-    s->WriteBuffer("VBO", _countof(mesh) * sizeof(Vertex), (void *)mesh);
-#ifndef __CLANG
+    const int count = static_cast<int>(std::min<size_t>(compositeLayers, layers.size() - first));
+    glBindTextures(1, count, &layers[first]);
+    s->WriteUniform(layerCount, &count);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    RenderStats::Instance()->TextureBind(count);
+    RenderStats::Instance()->Draw(3);
+  }
+  glBindVertexArray(0);
+  glPolygonMode(GL_FRONT_AND_BACK, _activePolyMode);
+  CheckError(__LINE__);
+  glEnable(GL_DEPTH_TEST);
 }
-#endif
 
-  // glBlendEquation(GL_MAX);
-  glActiveTexture(GL_TEXTURE1);
-  auto f = std::get<2>(fbos[0]);
-  glBindTexture(GL_TEXTURE_2D, f);
-  glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-  f = std::get<2>(fbos[1]);
-  glBindTexture(GL_TEXTURE_2D, f);
-  glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-  f = std::get<2>(fbos[2]);
-  glBindTexture(GL_TEXTURE_2D, f);
-  glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-  s->UnBindBuffer("VBO");
-  s->UnBindBuffer("VAO");
+void RenderPass::Upsample(GLuint texture, glm::vec2 scale, GLuint target)
+{
+  if (texture == 0)
+    return;
+  BindFrameBuffer(target);
+  glDisable(GL_DEPTH_TEST);
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  if (_upsampleStage == nullptr)
+  {
+    _upsampleStage = new ShaderStage(4);
+    _upsampleStage->parent = this;
+  }
+  if (_compositeVAO == 0)
+    glCreateVertexArrays(1, &_compositeVAO);
+  ShaderStage *const s = _upsampleStage;
+  s->SetActive();
+  const int unit = 1;
+  s->WriteUniform(s->UniformIndex("source"), &unit);
+  s->WriteUniform(s->UniformIndex("viewportScale"), &scale);
+  glBindTextureUnit(unit, texture);
+  glBindVertexArray(_compositeVAO);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  RenderStats::Instance()->TextureBind();
+  RenderStats::Instance()->Draw(3);
+  glBindVertexArray(0);
   glPolygonMode(GL_FRONT_AND_BACK, _activePolyMode);
-  CheckError(__LINE__);
   glEnable(GL_DEPTH_TEST);
-  glEnable(GL_CULL_FACE);
-  glCullFace(GL_BACK);
+  if (std::get<2>(_activeShaderStage) != nullptr)
+    std::get<2>(_activeShaderStage)->SetActive();
+  CheckError(__LINE__);
 }
 
 void RenderPass::RegisterCallBack(renderStage stage, int id,
                                   renderCallBack fn)
 {
-  _renderCallbacks.push_back({stage, id, fn});
+  for (RenderNode &node : _graph)
+  {
+    if (std::get<0>(node.pass) != stage || static_cast<int>(std::get<1>(node.pass)) != id)
+      continue;
+    // Registering the same function twice still calls it once
+    if (std::find(node.callbacks.begin(), node.callbacks.end(), fn) == node.callbacks.end())
+    {
+      node.callbacks.push_back(fn);
+      node.callbackNames.push_back(node.name + " callback " + std::to_string(node.callbacks.size()));
+    }
+    return;
+  }
+  Log(Warning, "No shader stage runs in render stage", static_cast<int>(stage), "with id", id,
+      "so the callback will never be called");
 }
 
 renderStage RenderPass::CurrentStage() { return _activeStage; }
 
 std::pair<GLuint, GLuint> RenderPass::GetFrameBuffer(std::string s)
 {
-  auto &fbo = _additionalFBOs[s];
-  if (std::get<1>(fbo) != 0)
-    return {std::get<1>(fbo), std::get<2>(fbo)};
-  else
+  auto it = _additionalFBOs.find(s);
+  if (it == _additionalFBOs.end() || std::get<1>(it->second) == 0)
     return {0, 0};
+  // Whoever asks is about to draw into it or read it, its texture may be written as an image
+  Allocate(it->second);
+  MarkWritten(it->second);
+  return {std::get<1>(it->second), std::get<2>(it->second)};
 }
 
 std::pair<GLuint, GLuint> RenderPass::GetFrameBuffer(int id)
@@ -164,16 +231,28 @@ std::pair<GLuint, GLuint> RenderPass::GetFrameBuffer(int id)
   };
 
   if (id < 3)
+  {
+    Allocate(_primaryFBOs[id]);
+    MarkWritten(_primaryFBOs[id]);
     return {std::get<1>(_primaryFBOs[id]), std::get<2>(_primaryFBOs[id])};
+  }
   else if (id < 6)
+  {
+    Allocate(_secondaryFBOs[id - 3]);
+    MarkWritten(_secondaryFBOs[id - 3]);
     return {std::get<1>(_secondaryFBOs[id - 3]),
             std::get<2>(_secondaryFBOs[id - 3])};
+  }
   else
   {
     auto it =
         std::find_if(_additionalFBOs.begin(), _additionalFBOs.end(), find);
     if (it != _additionalFBOs.end())
+    {
+      Allocate(it->second);
+      MarkWritten(it->second);
       return {std::get<1>(it->second), std::get<2>(it->second)};
+    }
 
     else
       return {0, 0};
@@ -194,112 +273,107 @@ void RenderPass::ResetRender()
 {
 
   _activeStage = renderStage::PreRender;
-  auto lambdaShaderPass = [this](std::pair<const std::string, ShaderPass> s)
-  {
-    return (std::get<0>(s.second) == _activeStage) &&
-           (std::get<1>(s.second) == 0);
-  };
-  auto it = std::find_if(_passess.begin(), _passess.end(), lambdaShaderPass);
-  if (it != _passess.end())
-  {
-    _activeShaderStage = it->second;
-    std::get<1>(_activeShaderStage) = -1;
-  }
   glClearColor(0, 0, 0, 0);
   glClearDepth(1);
-  for (int i = 0; i < 3; ++i)
+  // Only FBOs something drew into have anything to clear
+  for (auto &fbo : _primaryFBOs)
+  {
+    if (std::exchange(_targetStates[std::get<1>(fbo)].written, false))
+      ClearTarget(fbo, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  }
+  for (auto &fbo : _secondaryFBOs)
   {
-    glBindFramebuffer(GL_FRAMEBUFFER, std::get<1>(_primaryFBOs[i]));
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-      return;
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glBindFramebuffer(GL_FRAMEBUFFER, std::get<1>(_secondaryFBOs[i]));
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-      return;
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (std::exchange(_targetStates[std::get<1>(fbo)].written, false))
+      ClearTarget(fbo, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   }
 
   for (auto &fbo : _additionalFBOs)
   {
-    glBindFramebuffer(GL_FRAMEBUFFER, std::get<1>(fbo.second));
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-      return;
-    glClear(GL_COLOR_BUFFER_BIT);
+    // Transient FBOs are cleared by the first stage using them
+    if (std::exchange(_targetStates[std::get<1>(fbo.second)].written, false) &&
+        std::find(_transientFBOs.begin(), _transientFBOs.end(), fbo.first) == _transientFBOs.end())
+      ClearTarget(fbo.second, GL_COLOR_BUFFER_BIT);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  // The window has kept its size since the last resize, drop room it no longer needs. Only capacity
+  // past the headroom a grow would have given is dropped, so a resize that grew reallocates once
+  if (_settleFrames != 0 && --_settleFrames == 0)
+  {
+    const glm::ivec2 window = {defaultWindow->w, defaultWindow->h};
+    const glm::ivec2 headroom = CapacityFor(window + window / 4);
+    if (glm::any(glm::greaterThan(_capacity, headroom)))
+    {
+      _capacity = glm::min(_capacity, headroom);
+      ReleaseTargets();
+    }
   }
 }
 
 void RenderPass::ResizeFBOs()
 {
-  auto screenSize = glm::vec2(defaultWindow->w, defaultWindow->h);
-  for (auto &p : _primaryFBOs)
+  const glm::ivec2 window = {defaultWindow->w, defaultWindow->h};
+  if (glm::any(glm::greaterThan(window, _capacity)))
   {
-    glBindFramebuffer(GL_FRAMEBUFFER, std::get<2>(p));
-    glBindTexture(GL_TEXTURE_2D, std::get<2>(p));
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, static_cast<GLsizei>(screenSize.x),
-                 static_cast<GLsizei>(screenSize.y), 0, GL_RGBA, GL_FLOAT,
-                 NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glBindTexture(GL_TEXTURE_2D, std::get<3>(p));
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH32F_STENCIL8, static_cast<int>(screenSize.x),
-                 static_cast<int>(screenSize.y), 0,
-                 GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, nullptr);
-    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
-                           GL_TEXTURE_2D, std::get<3>(p), 0);
+    // Outgrown, a quarter more keeps the rest of a drag from outgrowing it again
+    _capacity = glm::max(_capacity, CapacityFor(window + window / 4));
+    // Each FBO gets new textures at the new size when it is next used
+    ReleaseTargets();
+  }
+  // Fit to the window again once it stops changing, in ResetRender
+  _settleFrames = _settleDelay;
+}
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+glm::ivec2 RenderPass::ViewportSize(GLuint fbo)
+{
+  RenderTargetDesc const &desc = _targets[fbo];
+  if (desc.width != 0 && desc.height != 0)
+    return {desc.width, desc.height};
+  // The layers render at the dynamic resolution scale
+  const auto layer = [fbo](frameBufferObject const &f)
+  { return std::get<1>(f) == fbo; };
+  const bool scaled = std::any_of(_primaryFBOs.begin(), _primaryFBOs.end(), layer) ||
+                      std::any_of(_secondaryFBOs.begin(), _secondaryFBOs.end(), layer);
+  const glm::vec2 size = glm::vec2(defaultWindow->w, defaultWindow->h) * desc.scale * (scaled ? _renderScale : 1.f);
+  return glm::max(glm::ivec2(glm::round(size)), glm::ivec2(1));
+}
 
-    CheckError(__LINE__);
-  }
-  glBindTexture(GL_TEXTURE_2D, 0);
+void RenderPass::SetRenderScale(float scale)
+{
+  _renderScale = std::clamp(scale, 0.05f, 1.f);
+}
+
+glm::vec2 RenderPass::ViewportScale(GLuint fbo)
+{
+  return glm::vec2(ViewportSize(fbo)) / glm::vec2(TargetSize(_targets[fbo]));
+}
+
+void RenderPass::ReleaseTargets()
+{
+  for (auto &p : _primaryFBOs)
+    Release(p);
   for (auto &p : _secondaryFBOs)
-  {
-    // glBindFramebuffer(GL_FRAMEBUFFER, std::get<2>(p));
-    glBindTexture(GL_TEXTURE_2D, std::get<2>(p));
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, static_cast<GLsizei>(screenSize.x),
-                 static_cast<GLsizei>(screenSize.y), 0, GL_RGBA, GL_FLOAT,
-                 NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glBindTexture(GL_TEXTURE_2D, std::get<3>(p));
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH32F_STENCIL8, static_cast<int>(screenSize.x),
-                 static_cast<int>(screenSize.y), 0,
-                 GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, nullptr);
-    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
-                           GL_TEXTURE_2D, std::get<3>(p), 0);
-
-    glBindTexture(GL_TEXTURE_2D, 0);
-    CheckError(__LINE__);
-  }
-  glBindTexture(GL_TEXTURE_2D, 0);
+    Release(p);
   for (auto &adi : _additionalFBOs)
+    Release(adi.second);
+  for (size_t slot = 0; slot < _aliasSlots.size(); ++slot)
   {
-    auto &fbo = adi.second;
-    glBindFramebuffer(GL_FRAMEBUFFER, std::get<1>(fbo));
-    glDeleteTextures(1, &std::get<2>(fbo));
-    glGenTextures(1, &std::get<2>(fbo));
-    glBindTexture(GL_TEXTURE_2D, std::get<2>(fbo));
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, static_cast<GLsizei>(screenSize.x),
-                 static_cast<GLsizei>(screenSize.y), 0, GL_RGBA, GL_FLOAT,
-                 NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                           std::get<2>(fbo), 0);
-    glBindTexture(GL_TEXTURE_2D, std::get<3>(fbo));
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH32F_STENCIL8, static_cast<int>(screenSize.x),
-                 static_cast<int>(screenSize.y), 0,
-                 GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, nullptr);
-    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
-                           GL_TEXTURE_2D, std::get<3>(fbo), 0);
-
-    glBindTexture(GL_TEXTURE_2D, 0);
-    CheckError(__LINE__);
-  }
-  glBindTexture(GL_TEXTURE_2D, 0);
-  // glViewport(0, 0, defaultWindow->vx, defaultWindow->vh);
+    auto &[texture, depth] = _aliasSlots[slot];
+    RenderTargetPool::Instance()->Release(texture);
+    RenderTargetPool::Instance()->Release(depth);
+    texture = depth = 0;
+  }
 }
 
 void RenderPass::ResizeSpecificFBO(std::string s, glm::vec2 const &newSize)
 {
   auto &frameBuffer = _additionalFBOs[s];
+  // Resized on its own it can't share textures anymore, leave the shared ones alone
+  if (_aliases.erase(s) != 0)
+  {
+    std::get<2>(frameBuffer) = 0;
+    std::get<3>(frameBuffer) = 0;
+  }
   // --------------------------
   // Ahhhh, don't we all love c++'s antics. It is technically legal to store a
   // reference inside a std data structure HOWEVER it would be meaningless to
@@ -308,30 +382,12 @@ void RenderPass::ResizeSpecificFBO(std::string s, glm::vec2 const &newSize)
   // what you want fukin hurray
   //    - Lorenzo
   // --------------------------
-  auto [stage, frame, texture, depth] = frameBuffer;
-  glBindFramebuffer(GL_FRAMEBUFFER, frame);
-  // To resize a texture with how we are making them
-  // we must delete it first
-  glDeleteTextures(1, &texture);
-  glDeleteTextures(1, &depth);
-
-  glGenTextures(1, &texture);
-  glGenTextures(1, &depth);
-
-  glBindTexture(GL_TEXTURE_2D, texture);
-  glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, static_cast<int>(newSize.x),
-                 static_cast<int>(newSize.y));
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                         texture, 0);
-  glBindTexture(GL_TEXTURE_2D, depth);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH32F_STENCIL8, static_cast<int>(newSize.x),
-               static_cast<int>(newSize.y), 0,
-               GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, nullptr);
-  glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
-                         GL_TEXTURE_2D, depth, 0);
-
-  glBindTexture(GL_TEXTURE_2D, 0);
+  Release(frameBuffer);
+  // It keeps the asked for size from now on, window resizes leave it alone
+  RenderTargetDesc &desc = _targets[std::get<1>(frameBuffer)];
+  desc.width = std::max(static_cast<int>(newSize.x), 1);
+  desc.height = std::max(static_cast<int>(newSize.y), 1);
+  Allocate(frameBuffer);
 }
 
 bool RenderPass::QuerryAttribute(std::string s)
@@ -339,6 +395,16 @@ bool RenderPass::QuerryAttribute(std::string s)
   return std::get<2>(_activeShaderStage)->QuerryAttribute(s);
 }
 
+void RenderPass::SelectVariant(unsigned flags)
+{
+  std::get<2>(_activeShaderStage)->SelectVariant(flags);
+}
+
+bool RenderPass::HasVariant(unsigned flag)
+{
+  return (std::get<2>(_activeShaderStage)->Variants() & flag) != 0;
+}
+
 bool RenderPass::QuerryStage(std::string s)
 {
   return _passess.find(s) != _passess.end();
@@ -347,29 +413,9 @@ bool RenderPass::QuerryStage(std::string s)
 int RenderPass::MakeFBO(std::string s)
 {
   GLuint fbo;
-  GLuint texture, depth;
   glGenFramebuffers(1, &fbo);
-  glGenTextures(1, &texture);
-  glGenTextures(1, &depth);
-
-  auto screenSize = glm::vec2(1280, 720);
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-  glBindTexture(GL_TEXTURE_2D, texture);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, static_cast<GLsizei>(screenSize.x),
-               static_cast<GLsizei>(screenSize.y), 0, GL_RGBA, GL_FLOAT, NULL);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                         texture, 0);
-  glBindTexture(GL_TEXTURE_2D, depth);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH32F_STENCIL8,
-               static_cast<GLsizei>(screenSize.x),
-               static_cast<GLsizei>(screenSize.y), 0, GL_DEPTH_STENCIL,
-               GL_FLOAT_32_UNSIGNED_INT_24_8_REV, nullptr);
-  glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
-                         GL_TEXTURE_2D, depth, 0);
-
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  frameBufferObject newest = {renderStage::PrimaryRender, fbo, texture, depth};
+  _targets[fbo] = RenderTargetDesc();
+  frameBufferObject newest = {renderStage::PrimaryRender, fbo, 0, 0};
   _additionalFBOs[s] = newest;
   return fbo;
 }
@@ -397,52 +443,26 @@ void RenderPass::SetBindings(GLuint b, GLuint VAO)
 void RenderPass::SetupDefaultFBOs()
 {
   GLuint defaultFBOs[6] = {0};
-  GLuint Textures[6] = {0};
-  GLuint depthBuffers[6] = {0};
   glGenFramebuffers(6, defaultFBOs);
   CheckError(__LINE__);
-  glGenTextures(6, Textures);
-  glGenTextures(6, depthBuffers);
-  auto screenSize = glm::vec2(1280, 720); /* GLBackend::GetWindowDimensions();*/
-  for (int i = 0; i < 6; ++i)
-  {
-    glBindFramebuffer(GL_FRAMEBUFFER, defaultFBOs[i]);
-    CheckError(__LINE__);
-    glBindTexture(GL_TEXTURE_2D, Textures[i]);
-    auto width = static_cast<GLsizei>(screenSize.x),
-         height = static_cast<GLsizei>(screenSize.y);
-    CheckError(__LINE__);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_FLOAT,
-                 NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                           Textures[i], 0);
-    glBindTexture(GL_TEXTURE_2D, depthBuffers[i]);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH32F_STENCIL8, width, height, 0,
-                 GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, nullptr);
-    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
-                           GL_TEXTURE_2D, depthBuffers[i], 0);
-
-    CheckError(__LINE__);
-  }
-  CheckError(__LINE__);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  // RGBA8 and a float depth, the textures come from the pool when each is first bound
+  for (GLuint fbo : defaultFBOs)
+    _targets[fbo] = RenderTargetDesc();
+  if (defaultWindow != nullptr)
+    _capacity = CapacityFor({defaultWindow->w, defaultWindow->h});
 
   _primaryFBOs[0] = frameBufferObject(
-      renderStage::PrimaryRender, defaultFBOs[0], Textures[0], depthBuffers[0]);
+      renderStage::PrimaryRender, defaultFBOs[0], 0, 0);
   _primaryFBOs[1] = frameBufferObject(
-      renderStage::PrimaryRender, defaultFBOs[1], Textures[1], depthBuffers[1]);
+      renderStage::PrimaryRender, defaultFBOs[1], 0, 0);
   _primaryFBOs[2] = frameBufferObject(
-      renderStage::PrimaryRender, defaultFBOs[2], Textures[2], depthBuffers[2]);
+      renderStage::PrimaryRender, defaultFBOs[2], 0, 0);
   _secondaryFBOs[0] =
-      frameBufferObject(renderStage::SecondaryRender, defaultFBOs[3],
-                        Textures[3], depthBuffers[3]);
+      frameBufferObject(renderStage::SecondaryRender, defaultFBOs[3], 0, 0);
   _secondaryFBOs[1] =
-      frameBufferObject(renderStage::SecondaryRender, defaultFBOs[4],
-                        Textures[4], depthBuffers[4]);
+      frameBufferObject(renderStage::SecondaryRender, defaultFBOs[4], 0, 0);
   _secondaryFBOs[2] =
-      frameBufferObject(renderStage::SecondaryRender, defaultFBOs[5],
-                        Textures[5], depthBuffers[5]);
+      frameBufferObject(renderStage::SecondaryRender, defaultFBOs[5], 0, 0);
 }
 
 bool RenderPass::CheckBufferExists(std::string &s)
@@ -472,23 +492,12 @@ RenderPass::RenderPass(const int v)
     GLuint newBuffer = 0;
     glGenBuffers(1, &newBuffer);
     _buffers["RenderBuffer"] = {newBuffer, GL_SHADER_STORAGE_BUFFER};
-    glGenBuffers(1, &newBuffer);
-    _buffers["MaterialBuffer"] = {newBuffer, GL_SHADER_STORAGE_BUFFER};
 
     GLuint fbo;
-    GLuint depth;
     glGenFramebuffers(1, &fbo);
-    glGenTextures(1, &depth);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-    glBindTexture(GL_TEXTURE_2D, depth);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH32F_STENCIL8,
-                 static_cast<GLsizei>(defaultWindow->w),
-                 static_cast<GLsizei>(defaultWindow->h), 0, GL_DEPTH_STENCIL,
-                 GL_FLOAT_32_UNSIGNED_INT_24_8_REV, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
-
-    _additionalFBOs["shadows"] = {renderStage::PreRender, fbo, 0, depth};
+    // Depth only
+    _targets[fbo] = {0, GL_DEPTH32F_STENCIL8, 1.f};
+    _additionalFBOs["shadows"] = {renderStage::PreRender, fbo, 0, 0};
   }
   break;
   }
@@ -496,6 +505,7 @@ RenderPass::RenderPass(const int v)
 
   _flattenStage = flattenRender;
   _flattenStage->parent = this;
+  CompileGraph();
 }
 
 RenderPass::RenderPass(const char *f) : RenderPass(std::string(f)) {}
@@ -508,8 +518,10 @@ RenderPass::RenderPass(std::string path) : _flattenStage(new ShaderStage(1))
     throw std::invalid_argument("Bad file path");
   // Read each line and check for <
   std::string token;
-  auto screenSize = glm::vec2(1280, 720); /* GLBackend::GetWindowDimensions();*/
   SetupDefaultFBOs();
+  // Stages are loaded together once the whole pass is read
+  std::vector<std::string> stagePaths;
+  std::vector<std::tuple<std::string, renderStage, unsigned>> stageSlots;
   while (file.isEOF() != true)
   {
     // if we fine a < then set what section we are reading
@@ -535,9 +547,8 @@ RenderPass::RenderPass(std::string path) : _flattenStage(new ShaderStage(1))
             const size_t eq = token.find('=');
             token = token.erase(0, eq + 1);
             unsigned int id = std::stoi(token);
-            ShaderStage *s = new ShaderStage(name + ".meta");
-            s->parent = this;
-            _passess[name.substr(name.rfind('/') + 1)] = {stage, id, s};
+            stagePaths.push_back(name + ".meta");
+            stageSlots.push_back({name.substr(name.rfind('/') + 1), stage, id});
           }
         }
       }
@@ -556,34 +567,20 @@ RenderPass::RenderPass(std::string path) : _flattenStage(new ShaderStage(1))
             std::string name = token.substr(0, eq);
             // erase up to and afterthe equal sign
             token = token.erase(0, eq + 1);
-            renderStage stage = static_cast<renderStage>(std::stoi(token));
-            GLuint newFBO;
-            GLuint newTexture;
-            GLuint depth;
-            glGenTextures(1, &depth);
-            glGenFramebuffers(1, &newFBO);
-            glGenTextures(1, &newTexture);
-            glBindFramebuffer(GL_FRAMEBUFFER, newFBO);
-            glBindTexture(GL_TEXTURE_2D, newTexture);
-            glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F,
-                           static_cast<int>(screenSize.x),
-                           static_cast<int>(screenSize.y));
-
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                                   GL_TEXTURE_2D, newTexture, 0);
-
-            glBindTexture(GL_TEXTURE_2D, depth);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH32F_STENCIL8,
-                         static_cast<int>(screenSize.x),
-                         static_cast<int>(screenSize.y), 0, GL_DEPTH_STENCIL,
-                         GL_FLOAT_32_UNSIGNED_INT_24_8_REV, nullptr);
-            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER,
-                                   GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D,
-                                   depth, 0);
-
-            _additionalFBOs[name] = {stage, newFBO, newTexture, depth};
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-            glBindTexture(GL_TEXTURE_2D, 0);
+            ORB_CompiledFBO fbo;
+            fbo.stage = std::stoi(token);
+            // [option,option] after the render stage
+            const size_t open = token.find('['), close = token.find(']');
+            std::string options = open != std::string::npos ? token.substr(open + 1, close - open - 1) : "";
+            for (size_t start = 0; start < options.size();)
+            {
+              const size_t end = std::min(options.find(',', start), options.size());
+              const std::string option = options.substr(start, end - start);
+              if (ORB_ApplyFBOOption(fbo, option) == false)
+                Log(Warning, "Unknown option", option, "on FBO", name, "in", path);
+              start = end + 1;
+            }
+            AddFBO(name, fbo);
           }
         }
       }
@@ -600,150 +597,469 @@ RenderPass::RenderPass(std::string path) : _flattenStage(new ShaderStage(1))
           std::string name = token.substr(0, bracket);
           // Erase the name
           token.erase(token.begin(), token.begin() + bracket + 1);
-          int type = std::stoi(token);
-          GLuint newBuffer = 0;
-          glGenBuffers(1, &newBuffer);
-          _buffers[name] = {newBuffer, bufferTypes.at(type)};
-          Log(Message, "Added buffer:", name, "to Shader:", path);
+          AddBuffer(name, std::stoi(token), path);
+        }
+      }
+      else if (token == "<resources>")
+      {
+        while (true)
+        {
+          token = file.readString();
+          if (makeLowerCase(token) == "</resources>" || file.isEOF())
+            break;
+          AddResourceUse(token, path);
         }
       }
     }
   }
+
+  // Read every .meta and source on the pool, then give every program to the driver before
+  // waiting on any, so the pass takes about as long as its slowest stage
+  LoadStages(ShaderStage::Parse(stagePaths), stageSlots);
+  CompileGraph();
 }
 
-RenderPass::RenderPass(RenderPass const &r) {}
+RenderPass::RenderPass(ORB_CompiledPass const &pass) : _flattenStage(new ShaderStage(1))
+{
+  SetupDefaultFBOs();
+  for (ORB_CompiledFBO const &f : pass.fbos)
+    AddFBO(f.name, f);
+  for (ORB_CompiledBuffer const &b : pass.buffers)
+    AddBuffer(b.name, b.type, pass.path);
+  std::vector<ShaderStageDesc> descs;
+  std::vector<std::tuple<std::string, renderStage, unsigned>> stageSlots;
+  for (ORB_CompiledStage const &s : pass.stages)
+  {
+    descs.push_back(ShaderStage::Parse(s));
+    stageSlots.push_back({s.name, static_cast<renderStage>(s.stage), s.id});
+  }
+  for (ORB_CompiledResource const &r : pass.resources)
+    _resourceUses.push_back({r.stage, r.resource, r.access});
+  LoadStages(descs, stageSlots);
+  CompileGraph();
+}
 
-RenderPass &RenderPass::operator=(RenderPass const &)
+void RenderPass::AddFBO(std::string const &name, ORB_CompiledFBO const &fbo)
 {
-  // TODO: insert return statement here
-  return *this;
+  if (fbo.transient)
+    _transientFBOs.push_back(name);
+  GLuint newFBO;
+  glGenFramebuffers(1, &newFBO);
+  _targets[newFBO] = {fbo.format, fbo.depth, fbo.scale};
+  _targetStates[newFBO].overwritten = fbo.overwritten;
+  _additionalFBOs[name] = {static_cast<renderStage>(fbo.stage), newFBO, 0, 0};
 }
 
-RenderPass::~RenderPass()
+void RenderPass::AddBuffer(std::string const &name, int type, std::string const &path)
 {
-  for (auto &pass : _passess)
+  GLuint newBuffer = 0;
+  glGenBuffers(1, &newBuffer);
+  _buffers[name] = {newBuffer, bufferTypes.at(type)};
+  Log(Message, "Added buffer:", name, "to Shader:", path);
+}
+
+void RenderPass::AddResourceUse(std::string const &entry, std::string const &path)
+{
+  const size_t open = entry.find('['), close = entry.find(']'), eq = entry.find('=');
+  if (open == std::string::npos || close == std::string::npos || eq == std::string::npos || open == 0 ||
+      close < open || eq != close + 1 || eq + 1 == entry.size())
   {
-    delete std::get<2>(pass.second);
+    Log(Error, "Resource use", entry, "in", path, "should look like stage[rw]=resource");
+    return;
   }
-  for (auto &fbo : _additionalFBOs)
+  const std::string access = makeLowerCase(entry.substr(open + 1, close - open - 1));
+  unsigned bits = 0;
+  bool bad = access.empty();
+  for (char c : access)
   {
-    glDeleteFramebuffers(1, &std::get<1>(fbo.second));
-    glDeleteTextures(1, &std::get<2>(fbo.second));
-    glDeleteTextures(1, &std::get<3>(fbo.second));
+    if (c == 'r')
+      bits |= static_cast<unsigned>(resourceAccess::read);
+    else if (c == 'w')
+      bits |= static_cast<unsigned>(resourceAccess::write);
+    else
+      bad = true;
   }
-  for (auto &fbo : _primaryFBOs)
+  if (bad)
   {
-    glDeleteFramebuffers(1, &std::get<1>(fbo));
-    glDeleteTextures(1, &std::get<2>(fbo));
-    glDeleteTextures(1, &std::get<3>(fbo));
+    Log(Error, "Resource use", entry, "in", path, "needs r, w or rw in the brackets");
+    return;
   }
-  for (auto &fbo : _secondaryFBOs)
+  // Stage names are lower case like in <Stages>
+  _resourceUses.push_back({makeLowerCase(entry.substr(0, open)), entry.substr(eq + 1), bits});
+}
+
+void RenderPass::LoadStages(std::vector<ShaderStageDesc> const &descs,
+                            std::vector<std::tuple<std::string, renderStage, unsigned>> const &stageSlots)
+{
+  std::vector<ShaderStage *> stages;
+  for (size_t i = 0; i < descs.size(); ++i)
   {
-    glDeleteFramebuffers(1, &std::get<1>(fbo));
-    glDeleteTextures(1, &std::get<2>(fbo));
-    glDeleteTextures(1, &std::get<3>(fbo));
+    ShaderStage *s = new ShaderStage(descs[i]);
+    s->parent = this;
+    auto const &[name, stage, id] = stageSlots[i];
+    _passess[name] = {stage, id, s};
+    stages.push_back(s);
   }
+  for (ShaderStage *s : stages)
+    s->Finish();
 }
 
-
-
-void RenderPass::Update()
+void RenderPass::CompileGraph()
 {
+  _graph.clear();
+  for (auto const &stage : _passess)
+  {
+    RenderNode &node = _graph.emplace_back();
+    node.pass = stage.second;
+  }
+  std::sort(_graph.begin(), _graph.end(), [](RenderNode const &a, RenderNode const &b)
+            { return std::tie(std::get<0>(a.pass), std::get<1>(a.pass)) < std::tie(std::get<0>(b.pass), std::get<1>(b.pass)); });
+  for (size_t s = 0, i = 0; s < _stageStart.size(); ++s)
+  {
+    while (i < _graph.size() && static_cast<size_t>(std::get<0>(_graph[i].pass)) < s)
+      ++i;
+    _stageStart[s] = i;
+  }
+  std::unordered_map<std::string, size_t> order;
+  for (size_t i = 0; i < _graph.size(); ++i)
+  {
+    for (auto const &stage : _passess)
+    {
+      if (std::get<2>(stage.second) == std::get<2>(_graph[i].pass))
+      {
+        order[stage.first] = i;
+        _graph[i].name = stage.first;
+      }
+    }
+  }
 
-  // Get current ShaderStage ID
-  // Find all callbacks with same render stage and id
-  // Call all callbacks
-  // After all callbacks get called move to next stage
-  signed int id = static_cast<int>(std::get<1>(_activeShaderStage));
-  // Continuously search till we find either a valid render stage or don't
-  bool broken = false;
-  while (!broken)
+  // Sort the declared uses into the stages, FBO names are lower case like in <FBOs>
+  std::vector<std::vector<std::pair<std::string, unsigned>>> uses(_graph.size());
+  std::map<std::string, std::pair<size_t, size_t>> lifetimes;
+  std::map<std::string, bool> written;
+  for (auto const &[stage, name, access] : _resourceUses)
   {
-    auto lambdaShaderPass = [this,
-                             id](std::pair<const std::string, ShaderPass> s)
+    auto at = order.find(stage);
+    if (at == order.end())
     {
-      return (std::get<0>(s.second) == _activeStage) &&
-             (std::get<1>(s.second) == (id + 1));
-    };
-    auto st = std::find_if(_passess.begin(), _passess.end(), lambdaShaderPass);
-    if (st != _passess.end())
+      Log(Warning, "A resource use names stage", stage, "which the pass doesn't have");
+      continue;
+    }
+    const std::string resource = _additionalFBOs.contains(makeLowerCase(name)) ? makeLowerCase(name) : name;
+    uses[at->second].push_back({resource, access});
+    auto life = lifetimes.try_emplace(resource, at->second, at->second).first;
+    life->second.first = std::min(life->second.first, at->second);
+    life->second.second = std::max(life->second.second, at->second);
+    written[resource] = written[resource] || (access & static_cast<unsigned>(resourceAccess::write)) != 0;
+  }
+
+  // The target of a pass or stage buffer, 0 if there is no such buffer
+  auto bufferTarget = [this](std::string const &resource) -> GLenum
+  {
+    auto buffer = _buffers.find(resource);
+    if (buffer != _buffers.end())
+      return buffer->second.second;
+    for (RenderNode const &node : _graph)
     {
-      _activeShaderStage = st->second;
-      broken = true;
+      if (std::get<2>(node.pass)->HasBuffer(resource))
+        return std::get<2>(node.pass)->GetBuffer(resource).second;
     }
-    else
+    return 0;
+  };
+  // What a reader has to wait on after a stage writes a resource, shader writes aren't ordered with
+  // later reads but rendering to an FBO is ordered with sampling it
+  auto barrierFor = [&](std::string const &resource, ShaderStage *writer) -> GLbitfield
+  {
+    if (_additionalFBOs.contains(resource))
+      return writer->IsCompute() ? GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT : 0;
+    const GLenum target = bufferTarget(resource);
+    return target != 0 ? BufferBarrier(target) : 0;
+  };
+  for (auto const &life : lifetimes)
+  {
+    if (_additionalFBOs.contains(life.first) == false && bufferTarget(life.first) == 0)
+      Log(Warning, "A resource use names", life.first, "which is neither an FBO nor a buffer of the pass");
+  }
+  // Walk the frame twice so writes at the end of one frame are waited on at the start of the next
+  std::map<std::string, GLbitfield> pending;
+  for (int lap = 0; lap < 2; ++lap)
+  {
+    for (size_t i = 0; i < _graph.size(); ++i)
     {
-      // Increase the stage we are on
-      _activeStage =
-          static_cast<renderStage>((static_cast<int>(_activeStage) + 1));
-      // Check if we are on the end stage
-      if (_activeStage == renderStage::End)
+      RenderNode &node = _graph[i];
+      node.barrier = 0;
+      for (auto const &[resource, access] : uses[i])
       {
-        // Back up 1 stage and return
-        _activeStage =
-            static_cast<renderStage>((static_cast<int>(_activeStage) - 1));
-        return;
+        if ((access & static_cast<unsigned>(resourceAccess::read)) != 0)
+          node.barrier |= pending[resource];
       }
-      id = -1;
+      for (auto &p : pending)
+        p.second &= ~node.barrier;
+      for (auto const &[resource, access] : uses[i])
+      {
+        if ((access & static_cast<unsigned>(resourceAccess::write)) != 0)
+          pending[resource] |= barrierFor(resource, std::get<2>(node.pass));
+      }
+    }
+  }
+  // Compute stages write FBOs through images without binding them, so say so when they run
+  for (size_t i = 0; i < _graph.size(); ++i)
+  {
+    for (auto const &[resource, access] : uses[i])
+    {
+      if ((access & static_cast<unsigned>(resourceAccess::write)) != 0 && _additionalFBOs.contains(resource))
+        _graph[i].writes.push_back(&_additionalFBOs[resource]);
     }
   }
+
+  // Transient FBOs get cleared by the first stage using them, and ones never alive at the
+  // same time share textures if they have the same format and size
+  std::vector<std::pair<size_t, std::vector<std::string>>> slots;
+  for (size_t i = 0; i < _transientFBOs.size();)
+  {
+    const std::string &name = _transientFBOs[i];
+    auto life = lifetimes.find(name);
+    if (_additionalFBOs.contains(name) == false || life == lifetimes.end() || written[name] == false)
+    {
+      Log(Warning, "Transient FBO", name, "isn't written by any stage, it is kept like any other FBO");
+      _transientFBOs.erase(_transientFBOs.begin() + i);
+      continue;
+    }
+    _graph[life->second.first].clears.push_back(&_additionalFBOs[name]);
+    _graph[life->second.second].discards.push_back(&_additionalFBOs[name]);
+    ++i;
+  }
+  std::vector<std::string> byStart = _transientFBOs;
+  std::sort(byStart.begin(), byStart.end(), [&](std::string const &a, std::string const &b)
+            { return lifetimes[a].first < lifetimes[b].first; });
+  for (std::string const &name : byStart)
+  {
+    RenderTargetDesc const &desc = _targets[std::get<1>(_additionalFBOs[name])];
+    auto slot = std::find_if(slots.begin(), slots.end(), [&](auto const &s)
+                             { return s.first < lifetimes[name].first &&
+                                      _targets[std::get<1>(_additionalFBOs[s.second[0]])] == desc; });
+    if (slot == slots.end())
+      slot = slots.insert(slots.end(), {0, {}});
+    slot->first = lifetimes[name].second;
+    slot->second.push_back(name);
+  }
+  for (auto const &[end, names] : slots)
+  {
+    if (names.size() < 2)
+      continue;
+    // The slot gets its textures when one of its FBOs is first used
+    _aliasSlots.push_back({0, 0});
+    for (std::string const &name : names)
+    {
+      Release(_additionalFBOs[name]);
+      _aliases[name] = _aliasSlots.size() - 1;
+    }
+    Log(Message, "Transient FBOs", names[0], "and", names.size() - 1, "more share textures");
+  }
 }
 
-void RenderPass::RunStage()
+void RenderPass::AttachAliasSlot(size_t slot)
 {
-  renderCallBack lastfn = nullptr;
-
-  // ------------------------------------------------------------
-  // Note:
-  // ------------------------------------------------------------
-  // This is a lambda function, they are really cool and are essentially a
-  // function within a function that acts like a variable. that can be passed as
-  // is to another function or used as a template param The first brackets part
-  // is called the capture list, bassically the things inside there are
-  // variables inside the lambda that aren't going to be messed with Then you
-  // have the parameters then the body The arrow defines what the return is,
-  // just like rust however if you have a return statement in a lambda then the
-  // compiler can figure out what the return is automatically
-  //     - Lorenzo
-  // ------------------------------------------------------------
-  auto lambdaFunctions = [this, lastfn](callback const &s) -> bool
+  auto const [texture, depth] = _aliasSlots[slot];
+  for (auto const &[name, s] : _aliases)
   {
-    return (std::get<0>(s) == _activeStage) &&
-           (std::get<1>(s) == std::get<1>(_activeShaderStage)) &&
-           (std::get<2>(s) != lastfn);
-  };
-  auto it = std::find_if(_renderCallbacks.begin(), _renderCallbacks.end(),
-                         lambdaFunctions);
-  auto &shader = std::get<2>(_activeShaderStage);
-  shader->SetActive();
-  auto lastIterator = _renderCallbacks.end();
-  while (it != _renderCallbacks.end() && it != lastIterator)
+    if (s != slot)
+      continue;
+    frameBufferObject &fbo = _additionalFBOs[name];
+    std::get<2>(fbo) = texture;
+    std::get<3>(fbo) = depth;
+    glNamedFramebufferTexture(std::get<1>(fbo), GL_COLOR_ATTACHMENT0, texture, 0);
+    glNamedFramebufferTexture(std::get<1>(fbo), GL_DEPTH_STENCIL_ATTACHMENT, depth, 0);
+    CheckComplete(std::get<1>(fbo));
+  }
+}
+
+glm::ivec2 RenderPass::TargetSize(RenderTargetDesc const &desc) const
+{
+  if (desc.width != 0 && desc.height != 0)
+    return {desc.width, desc.height};
+  const glm::vec2 size = glm::vec2(_capacity) * desc.scale;
+  return glm::max(glm::ivec2(glm::ceil(size)), glm::ivec2(1));
+}
+
+glm::ivec2 RenderPass::CapacityFor(glm::ivec2 window)
+{
+  const glm::ivec2 steps = (glm::max(window, glm::ivec2(1)) + (_capacityStep - 1)) / _capacityStep;
+  return steps * _capacityStep;
+}
+
+void RenderPass::Allocate(frameBufferObject &fbo)
+{
+  auto &[stage, frame, texture, depth] = fbo;
+  if (texture != 0 || depth != 0)
+    return;
+  RenderTargetDesc const &desc = _targets[frame];
+  const glm::ivec2 size = TargetSize(desc);
+  auto acquire = [&size](GLenum format) -> GLuint
+  { return format != 0 ? RenderTargetPool::Instance()->Acquire(format, size.x, size.y) : 0; };
+  // Transient FBOs sharing a slot all take the slot's textures
+  for (auto const &[name, slot] : _aliases)
   {
-    // Log(TraceLevels::CONSOLESPAMMMM, "Calling callback\n");
-    lastfn = std::get<2>(*it);
-    int err = lastfn();
-    if (err != 0)
+    if (&_additionalFBOs[name] != &fbo)
+      continue;
+    auto &[slotTexture, slotDepth] = _aliasSlots[slot];
+    if (slotTexture == 0 && slotDepth == 0)
     {
-      Log(Error, "Shader function exited early due to error:", err);
+      slotTexture = acquire(desc.format);
+      slotDepth = acquire(desc.depth);
     }
-  loopIt:
-    auto lambdaFunctionssss = [this, lastfn](callback const &s) -> bool
+    AttachAliasSlot(slot);
+    return;
+  }
+  texture = acquire(desc.format);
+  depth = acquire(desc.depth);
+  glNamedFramebufferTexture(frame, GL_COLOR_ATTACHMENT0, texture, 0);
+  glNamedFramebufferTexture(frame, GL_DEPTH_STENCIL_ATTACHMENT, depth, 0);
+  CheckComplete(frame);
+  // Pool textures hold whatever was last drawn into them, and this frame's clears are already done
+  const GLfloat clear[4] = {0, 0, 0, 0};
+  if (texture != 0 && _targetStates[frame].complete)
+  {
+    glClearNamedFramebufferfv(frame, GL_COLOR, 0, clear);
+    RenderStats::Instance()->Clear();
+  }
+  if (depth != 0 && _targetStates[frame].complete)
+  {
+    glClearNamedFramebufferfi(frame, GL_DEPTH_STENCIL, 0, 1.f, 0);
+    RenderStats::Instance()->Clear();
+  }
+  CheckError(__LINE__);
+}
+
+void RenderPass::Release(frameBufferObject &fbo)
+{
+  auto &[stage, frame, texture, depth] = fbo;
+  if (texture == 0 && depth == 0)
+    return;
+  // Shared textures belong to the slot, they are given back with it
+  const bool shared = std::any_of(_aliases.begin(), _aliases.end(), [&](auto const &alias)
+                                  { return &_additionalFBOs[alias.first] == &fbo; });
+  if (shared == false)
+  {
+    RenderTargetPool::Instance()->Release(texture);
+    RenderTargetPool::Instance()->Release(depth);
+  }
+  texture = depth = 0;
+  glNamedFramebufferTexture(frame, GL_COLOR_ATTACHMENT0, 0, 0);
+  glNamedFramebufferTexture(frame, GL_DEPTH_STENCIL_ATTACHMENT, 0, 0);
+  _targetStates[frame].complete = false;
+}
+
+void RenderPass::CheckComplete(GLuint fbo)
+{
+  const GLenum status = glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER);
+  _targetStates[fbo].complete = status == GL_FRAMEBUFFER_COMPLETE;
+  if (status != GL_FRAMEBUFFER_COMPLETE)
+    Log(Error, "FBO", fbo, "is incomplete, status", status, "so it will never be cleared");
+}
+
+void RenderPass::ClearTarget(frameBufferObject const &fbo, GLbitfield mask)
+{
+  const GLuint frame = std::get<1>(fbo);
+  TargetState const &state = _targetStates[frame];
+  if (state.complete == false)
+    return;
+  if (state.overwritten && std::get<2>(fbo) != 0)
+  {
+    // Every pixel is drawn again, the driver only has to drop what is there
+    const GLenum color = GL_COLOR_ATTACHMENT0;
+    glInvalidateNamedFramebufferData(frame, 1, &color);
+    mask &= ~GL_COLOR_BUFFER_BIT;
+  }
+  if (std::get<2>(fbo) == 0)
+    mask &= ~GL_COLOR_BUFFER_BIT;
+  if (std::get<3>(fbo) == 0)
+    mask &= ~GL_DEPTH_BUFFER_BIT;
+  if (mask == 0)
+    return;
+  glBindFramebuffer(GL_FRAMEBUFFER, frame);
+  glClear(mask);
+  RenderStats::Instance()->FBOBind();
+  RenderStats::Instance()->Clear();
+}
+
+void RenderPass::MarkWritten(frameBufferObject const &fbo)
+{
+  _targetStates[std::get<1>(fbo)].written = true;
+}
+
+RenderPass::RenderPass(RenderPass const &r) {}
+
+RenderPass &RenderPass::operator=(RenderPass const &)
+{
+  // TODO: insert return statement here
+  return *this;
+}
+
+RenderPass::~RenderPass()
+{
+  for (auto &pass : _passess)
+  {
+    delete std::get<2>(pass.second);
+  }
+  // The textures go back to the pool, a pass loaded next can pick them up
+  ReleaseTargets();
+  for (auto &fbo : _additionalFBOs)
+    glDeleteFramebuffers(1, &std::get<1>(fbo.second));
+  for (auto &fbo : _primaryFBOs)
+    glDeleteFramebuffers(1, &std::get<1>(fbo));
+  for (auto &fbo : _secondaryFBOs)
+    glDeleteFramebuffers(1, &std::get<1>(fbo));
+  glDeleteVertexArrays(1, &_compositeVAO);
+  delete _upsampleStage;
+}
+
+
+
+void RenderPass::Run(renderStage first, renderStage last)
+{
+  const size_t end = _stageStart[static_cast<size_t>(last) + 1];
+  for (size_t i = _stageStart[static_cast<size_t>(first)]; i < end; ++i)
+  {
+    RenderNode const &node = _graph[i];
+    ProfileScope stageScope(node.name);
+    _activeStage = std::get<0>(node.pass);
+    _activeShaderStage = node.pass;
+    if (node.clears.empty() == false)
     {
-      return (std::get<0>(s) == _activeStage) &&
-             (std::get<1>(s) == std::get<1>(_activeShaderStage)) &&
-             (std::get<2>(s) != lastfn);
-    };
-    auto lit = std::find_if(it, _renderCallbacks.end(), lambdaFunctionssss);
-    lastIterator = it;
-    if (lit > lastIterator)
+      glClearColor(0, 0, 0, 0);
+      glClearDepth(1);
+      for (frameBufferObject *fbo : node.clears)
+      {
+        Allocate(*fbo);
+        ClearTarget(*fbo, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      }
+      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+    if (node.barrier != 0)
+      glMemoryBarrier(node.barrier);
+    for (frameBufferObject *fbo : node.writes)
+      MarkWritten(*fbo);
+    std::get<2>(node.pass)->SetActive();
+    for (size_t c = 0; c < node.callbacks.size(); ++c)
     {
-      it = lit;
+      ProfileScope callbackScope(node.callbackNames[c]);
+      int err = node.callbacks[c]();
+      if (err != 0)
+      {
+        Log(Error, "Shader function exited early due to error:", err);
+      }
     }
-    else if (lit < lastIterator)
+    // Nothing reads these again this frame, the driver can drop them instead of keeping them
+    for (frameBufferObject *fbo : node.discards)
     {
-      goto loopIt;
+      if (std::get<2>(*fbo) == 0 && std::get<3>(*fbo) == 0)
+        continue;
+      const GLenum attachments[] = {GL_COLOR_ATTACHMENT0, GL_DEPTH_STENCIL_ATTACHMENT};
+      glInvalidateNamedFramebufferData(std::get<1>(*fbo), _countof(attachments), attachments);
     }
   }
+  _activeStage = last;
 }
 
 void RenderPass::SetSpecificStage(std::string s)
@@ -794,6 +1110,8 @@ void RenderPass::BindActiveFBO(int id)
   if (id == -1)
   {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    RenderStats::Instance()->FBOBind();
+    SetViewport(0);
     return;
   }
   auto find = [&](std::pair<std::string, frameBufferObject> const &a) -> bool
@@ -801,17 +1119,26 @@ void RenderPass::BindActiveFBO(int id)
     return (std::get<0>(a.second) == _activeStage) &&
            (std::get<1>(a.second) == id);
   };
+  // FBOs get their textures the first time they are bound
+  auto bind = [this](frameBufferObject &fbo)
+  {
+    Allocate(fbo);
+    MarkWritten(fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, std::get<1>(fbo));
+    RenderStats::Instance()->FBOBind();
+    SetViewport(std::get<1>(fbo));
+  };
   switch (_activeStage)
   {
   case renderStage::PrimaryRender:
     if (id < 3)
-      glBindFramebuffer(GL_FRAMEBUFFER, std::get<1>(_primaryFBOs[id]));
+      bind(_primaryFBOs[id]);
     else
     {
       auto it =
           std::find_if(_additionalFBOs.begin(), _additionalFBOs.end(), find);
       if (it != _additionalFBOs.end())
-        glBindFramebuffer(GL_FRAMEBUFFER, std::get<1>(it->second));
+        bind(it->second);
       else
       {
         Log(Error, "Attempted to bind non existant FBO");
@@ -821,13 +1148,13 @@ void RenderPass::BindActiveFBO(int id)
     break;
   case renderStage::SecondaryRender:
     if (id < 3)
-      glBindFramebuffer(GL_FRAMEBUFFER, std::get<1>(_secondaryFBOs[id]));
+      bind(_secondaryFBOs[id]);
     else
     {
       auto it =
           std::find_if(_additionalFBOs.begin(), _additionalFBOs.end(), find);
       if (it != _additionalFBOs.end())
-        glBindFramebuffer(GL_FRAMEBUFFER, std::get<1>(it->second));
+        bind(it->second);
       else
       {
         Log(Error, "Attempted to bind non existant FBO");
@@ -840,7 +1167,7 @@ void RenderPass::BindActiveFBO(int id)
     auto it =
         std::find_if(_additionalFBOs.begin(), _additionalFBOs.end(), find);
     if (it != _additionalFBOs.end())
-      glBindFramebuffer(GL_FRAMEBUFFER, std::get<1>(it->second));
+      bind(it->second);
     else
     {
       Log(Error, "Attempted to bind non existant FBO");
@@ -850,7 +1177,41 @@ void RenderPass::BindActiveFBO(int id)
   }
 }
 
-void RenderPass::UnBindActiveFBO() { glBindFramebuffer(GL_FRAMEBUFFER, 0); }
+void RenderPass::BindFrameBuffer(GLuint fbo)
+{
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  RenderStats::Instance()->FBOBind();
+  SetViewport(fbo);
+  auto state = _targetStates.find(fbo);
+  if (state != _targetStates.end())
+    state->second.written = true;
+}
+
+void RenderPass::UnBindActiveFBO()
+{
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  RenderStats::Instance()->FBOBind();
+  SetViewport(0);
+}
+
+void RenderPass::SetViewport(GLuint fbo)
+{
+  if (fbo == 0)
+  {
+    // The window whose context is current
+    SDL_Window *const current = SDL_GL_GetCurrentWindow();
+    auto it = std::find_if(activeWindows.begin(), activeWindows.end(), [current](Window *w)
+                           { return w->window == current; });
+    Window const *w = it != activeWindows.end() ? *it : defaultWindow;
+    glViewport(0, 0, w->w, w->h);
+    return;
+  }
+  // FBOs this pass doesn't know are left to whoever made them
+  if (_targets.contains(fbo) == false)
+    return;
+  const glm::ivec2 size = ViewportSize(fbo);
+  glViewport(0, 0, size.x, size.y);
+}
 
 void RenderPass::WriteBuffer(std::string s, size_t dataSize, void *data)
 {
@@ -863,4 +1224,5 @@ void RenderPass::WriteBuffer(std::string s, size_t dataSize, void *data)
     auto &bufferObject = _buffers[s];
     glBufferData(bufferObject.second, dataSize, data, GL_STATIC_DRAW);
   }
+  RenderStats::Instance()->BufferWrite(dataSize);
 }
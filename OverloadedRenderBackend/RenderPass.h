@@ -8,10 +8,16 @@
  *********************************************************************/
 #pragma once
 #include <glad.h>
+#include "Render Target Pool.h"
 #include <unordered_map>
 #include <map>
 #include <array>
+#include <tuple>
+#include <vector>
 class ShaderStage;
+typedef struct ShaderStageDesc ShaderStageDesc;
+typedef struct ORB_CompiledPass ORB_CompiledPass;
+typedef struct ORB_CompiledFBO ORB_CompiledFBO;
 // RenderPass
 // ----------------------------------
 // ----------------------------------
@@ -21,6 +27,23 @@ class ShaderStage;
 //
 // All stages must have a runtime order ID, which says in what order it will be run during each
 // stage's update IE: in the primary Render set, shaders in this stage will be run from ID 0 to n.
+//
+// The rpass.meta can say what each stage does with the pass's FBOs and buffers:
+//   <Resources>
+//     primary[w]=glow
+//     lighting[rw]=RenderBuffer
+//   </Resources>
+// When the pass loads it is compiled into a render graph, the stages in the order they run with
+// their callbacks, and the memory barriers those reads and writes need. An FBO declared as
+// glow=4[transient] only lives between the stages using it, so FBOs that are never alive at
+// the same time share their textures when their formats and sizes match.
+//
+// FBOs get their textures from the RenderTargetPool the first time they are bound or asked for,
+// so FBOs that are never drawn to take no memory. The brackets can also pick the color format,
+// the depth and the size relative to the window: bloom=3[rgba16f,nodepth,0.5]
+//
+// Only FBOs bound or handed out during a frame are cleared after it. One declared [overwritten]
+// has every pixel drawn each frame, so its color is invalidated instead of cleared.
 
 // These define where in the RenderPass Update will the shader stage be called
 enum class renderStage : int
@@ -49,31 +72,43 @@ typedef std::tuple<renderStage, int, renderCallBack> callback;
 typedef std::tuple<renderStage, GLuint, GLuint, GLuint> frameBufferObject;
 typedef std::pair<GLuint, GLenum> shaderBuffer;
 
+// What a stage does with a resource, a bit mask
+enum class resourceAccess : unsigned
+{
+  read = 1 << 0,
+  write = 1 << 1,
+};
+/**@typedef
+ * @brief A <Resources> entry of a render pass.
+ *
+ * @details std::string - the stage's name
+ *          std::string - the FBO or buffer's name
+ *          unsigned    - resourceAccess bits
+ */
+typedef std::tuple<std::string, std::string, unsigned> resourceUse;
+
 class RenderPass
 {
 public:
   RenderPass(const int v = 0);
   RenderPass(const char *f);
   RenderPass(std::string s);
-  RenderPass(RenderPass const &r);
-  RenderPass &operator=(RenderPass const &);
-  ~RenderPass();
   /**
-   * @brief Update what stage of the renderpass we are on
-   *
-   * @details This is not the same as a normal update loop function
-   * This will check what stage of the renderpass we are on the progress to the next one
+   * @brief Load a pass compiled by the PipelineCompiler, nothing is read from disk.
    *
+   * @param pass the compiled pass
    */
-  void Update();
-
+  RenderPass(ORB_CompiledPass const &pass);
+  RenderPass(RenderPass const &r);
+  RenderPass &operator=(RenderPass const &);
+  ~RenderPass();
   /**
-   * @brief Run the current shaderstage and move active to the next one
-   *
-   * @details
+   * @brief Run the stages of a range of render stages in order, with their callbacks.
    *
+   * @param first the first render stage to run
+   * @param last the last render stage to run
    */
-  void RunStage();
+  void Run(renderStage first, renderStage last);
   /**
    * @brief Set the stage to a specific stage.
    *
@@ -98,6 +133,12 @@ public:
    * @param id the FBO to bind
    */
   void BindActiveFBO(int id);
+  /**
+   * @brief Bind an FBO by its GL name, ResetRender clears it at the end of the frame.
+   *
+   * @param fbo the FBO's GL name
+   */
+  void BindFrameBuffer(GLuint fbo);
   /**
    * @brief reset the active FBO.
    *
@@ -122,12 +163,29 @@ public:
   void WriteSubBufferData(std::string, int index, size_t structSize, void *data);
 
   void SetBufferBase(std::string buffer, int base);
+  /**
+   * @brief Get the GL name and target of a buffer, looking in the active stage first.
+   *
+   * @param buffer the buffer name
+   * @return the name and target
+   */
+  shaderBuffer GetBuffer(std::string buffer);
 
   /**
-   * @brief Flatten all active FBOs.
+   * @brief Composite the primary FBOs drawn into this frame onto the window, in one draw.
    *
    */
   void FlattenFBOs();
+  /**
+   * @brief Stretch the drawn part of a texture over an FBO with bilinear filtering, blended on top.
+   *
+   * @details For effects rendered into scaled down FBOs, the stage active
+   * before is active again after.
+   * @param texture the texture of the scaled FBO
+   * @param scale the part of the texture that was drawn into, from ViewportScale
+   * @param target the FBO to draw into, 0 for the window
+   */
+  void Upsample(GLuint texture, glm::vec2 scale, GLuint target);
 
   /**
    * @brief Register a callBack function for a specific renderstage.
@@ -170,15 +228,41 @@ public:
    */
   std::array<frameBufferObject, 3> const &GetSecondaryFBOs();
   /**
-   * @brief Clear all FBOs and reset stage.
+   * @brief Clear the FBOs drawn into this frame and reset stage.
    *
    */
   void ResetRender();
   /**
-   * @brief Resize all FBOs.
+   * @brief Follow a change in the window's size.
    *
+   * @details FBOs are made a bit bigger than the window and drawn through a
+   * viewport the window's size, so a window resized within them keeps its
+   * textures. A window outgrowing them reallocates at once, one that shrank
+   * well inside them reallocates once its size has settled for a while.
    */
   void ResizeFBOs();
+  /**
+   * @brief The part of an FBO's textures the window covers, in pixels.
+   *
+   * @param fbo the FBO
+   * @return the viewport to draw into it with
+   */
+  glm::ivec2 ViewportSize(GLuint fbo);
+  /**
+   * @brief The part of an FBO's textures the window covers, as a fraction of them.
+   *
+   * @param fbo the FBO
+   * @return what to scale texture coordinates by to sample it
+   */
+  glm::vec2 ViewportScale(GLuint fbo);
+  /**
+   * @brief Set the scale the primary and secondary FBOs are drawn at.
+   *
+   * @details Only their viewport shrinks, the textures stay allocated for
+   * the whole window and FlattenFBOs stretches the drawn part over it.
+   * @param scale the scale of the window's size, clamped to (0, 1]
+   */
+  void SetRenderScale(float scale);
   /**
    * @brief Resize a specific FBO identified by name.
    *
@@ -188,6 +272,19 @@ public:
   void ResizeSpecificFBO(std::string, glm::vec2 const &newSize);
 
   bool QuerryAttribute(std::string);
+  /**
+   * @brief Switch the active stage to the program built for a set of shaderVariant flags.
+   *
+   * @param flags the shaderVariant flags
+   */
+  void SelectVariant(unsigned flags);
+  /**
+   * @brief Check if the active stage is specialised on a shaderVariant flag.
+   *
+   * @param flag the flag
+   * @return true if the flag picks a program instead of being a uniform
+   */
+  bool HasVariant(unsigned flag);
 
   bool QuerryStage(std::string);
 
@@ -202,20 +299,105 @@ public:
   void SetBindings(GLuint b, GLuint VAO);
 
 private:
+  // A stage of the compiled render graph
+  typedef struct RenderNode
+  {
+    ShaderPass pass;
+    std::vector<renderCallBack> callbacks;
+    // What the profiler calls the stage and each of its callbacks
+    std::string name;
+    std::vector<std::string> callbackNames;
+    // Transient FBOs this stage writes first, their textures hold another FBO's leftovers
+    std::vector<frameBufferObject *> clears;
+    // Transient FBOs this stage uses last, nothing reads them again this frame
+    std::vector<frameBufferObject *> discards;
+    // FBOs the <Resources> say this stage writes, they get cleared in ResetRender
+    std::vector<frameBufferObject *> writes;
+    // glMemoryBarrier bits for what earlier stages wrote that this one reads
+    GLbitfield barrier = 0;
+  }RenderNode;
+
+  // What happened to an FBO
+  typedef struct TargetState
+  {
+    // glCheckFramebufferStatus from when its textures were attached
+    bool complete = false;
+    // Bound or handed out since the last ResetRender
+    bool written = false;
+    // Declared [overwritten], every pixel is drawn each frame
+    bool overwritten = false;
+  }TargetState;
 
   void SetupDefaultFBOs();
+  // Add an FBO declared by the pass, its textures are made when it is first used
+  void AddFBO(std::string const &name, ORB_CompiledFBO const &fbo);
+  // Give an FBO its textures from the pool if it has none yet
+  void Allocate(frameBufferObject &fbo);
+  // Give an FBO's textures back to the pool, the next use allocates again
+  void Release(frameBufferObject &fbo);
+  // Give every FBO's and alias slot's textures back to the pool
+  void ReleaseTargets();
+  // Check an FBO is complete once its textures are attached, instead of every time it is cleared
+  void CheckComplete(GLuint fbo);
+  // Set the viewport to the part of an FBO that is drawn into, 0 for the current window
+  void SetViewport(GLuint fbo);
+  // Clear the parts of an FBO in the mask, invalidating the color instead if it is [overwritten]
+  void ClearTarget(frameBufferObject const &fbo, GLbitfield mask);
+  // Mark an FBO as drawn into this frame
+  void MarkWritten(frameBufferObject const &fbo);
+  // Read a <Resources> entry, stage[access]=resource
+  void AddResourceUse(std::string const &entry, std::string const &path);
+  /**
+   * @brief Put the stages in running order and work out their barriers, clears and which transient FBOs share textures.
+   *
+   */
+  void CompileGraph();
+  // Give every FBO in an alias slot the slot's textures
+  void AttachAliasSlot(size_t slot);
+  // The size of an FBO's textures, its fixed size or its scale of the capacity
+  glm::ivec2 TargetSize(RenderTargetDesc const &desc) const;
+  // The capacity for a window size, rounded up so nearby sizes fit in it
+  static glm::ivec2 CapacityFor(glm::ivec2 window);
+  void AddBuffer(std::string const &name, int type, std::string const &path);
+  // Submit every stage before finishing any, so the driver compiles them together
+  void LoadStages(std::vector<ShaderStageDesc> const &descs,
+                  std::vector<std::tuple<std::string, renderStage, unsigned>> const &stageSlots);
   bool CheckBufferExists(std::string &s);
   // The primary render and the secondary render each get 3 FBOs, assigned to be BG, FG and UI.
   std::array<frameBufferObject, 3> _primaryFBOs;
   std::array<frameBufferObject, 3> _secondaryFBOs;
   // The rpass.meta file can add more FBOs
   std::map<std::string, frameBufferObject> _additionalFBOs;
+  // What the textures of every FBO look like, by the FBO's name
+  std::unordered_map<GLuint, RenderTargetDesc> _targets;
+  std::unordered_map<GLuint, TargetState> _targetStates;
 
   std::unordered_map<std::string, ShaderPass> _passess;
   std::unordered_map<std::string, shaderBuffer> _buffers;
 
-  std::vector<callback> _renderCallbacks;
+  std::vector<resourceUse> _resourceUses;
+  std::vector<std::string> _transientFBOs;
+  // The stages in the order they run, and where each render stage starts in it
+  std::vector<RenderNode> _graph;
+  std::array<size_t, static_cast<size_t>(renderStage::End) + 1> _stageStart = {};
+  // Transient FBOs that share textures, and the color and depth texture of each group, 0 until one is used
+  std::map<std::string, size_t> _aliases;
+  std::vector<std::pair<GLuint, GLuint>> _aliasSlots;
   ShaderPass _activeShaderStage;
   renderStage _activeStage = renderStage::PreRender;
   ShaderStage *_flattenStage = nullptr;
+  // Made the first time Upsample is used
+  ShaderStage *_upsampleStage = nullptr;
+  // Empty, the flatten stage's triangle comes from the vertex id
+  GLuint _compositeVAO = 0;
+  // What window sized FBOs are allocated for, at least the window's size
+  glm::ivec2 _capacity = {1, 1};
+  // Scale of the window the primary and secondary FBOs are drawn at
+  float _renderScale = 1;
+  // Frames left until a resized window is taken as settled and oversized FBOs are shrunk
+  int _settleFrames = 0;
+  // Capacity is rounded up to this many pixels
+  static constexpr int _capacityStep = 256;
+  // Frames the window size has to stay the same before FBOs are reallocated smaller
+  static constexpr int _settleDelay = 30;
 };
@@ -18,14 +18,26 @@ constexpr int ENABLE_SHADER_PRINTF = 0;
 #include "../ShaderPrintf/shaderprintf.h"
 #endif
 #include "Stream.h"
+#include "Program Cache.h"
+#include "Compiled Pipeline.h"
+#include "Asset Pack.h"
+#include "Render Stats.h"
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <tuple>
 
 #include "ShaderLog.hpp"
 void CheckError(int i);
 
-static std::vector<GLchar> &loadFile(const char *fileName)
+// Returns by value, stages are read on several threads at once
+static std::string loadFile(const char *fileName)
 {
-  static std::vector<GLchar> file;
-  file.clear();
+  std::string file;
+  std::string_view packed;
+  std::vector<char> unpacked;
+  if (AssetPack::Instance()->Read(fileName, packed, unpacked))
+    return std::string(packed);
   FILE *f;
 #ifdef _MSC_VER
   fopen_s(&f, fileName, "rb");
@@ -37,7 +49,7 @@ static std::vector<GLchar> &loadFile(const char *fileName)
   size_t length = 0;
   fseek(f, 0, SEEK_END);
   length = ftell(f);
-  file.resize(length + 1);
+  file.resize(length);
   fseek(f, 0, 0);
   fread(file.data(), length, 1, f);
   fclose(f);
@@ -49,8 +61,7 @@ GLuint createShader(const std::string &path, GLenum shaderType)
 {
 
   using namespace std;
-  auto &file = loadFile(path.c_str());
-  string source = string(file.begin(), file.end());
+  string source = loadFile(path.c_str());
   GLuint shader = glCreateShader(shaderType);
   auto ptr = (const GLchar *)source.c_str();
 
@@ -70,60 +81,427 @@ GLuint createShader(const std::string &path, GLenum shaderType)
   return shader;
 }
 #endif
-GLuint ShaderStage::CreateShader(GLenum type, const char *filepath)
+GLuint ShaderStage::CreateShader(GLenum type, const char *source)
 {
-  auto &frag = loadFile(filepath);
   GLuint result = glCreateShader(type);
-  auto p = frag.data();
-  glShaderSource(result, 1, &p, nullptr);
+  glShaderSource(result, 1, &source, nullptr);
+  // Not checked here, asking for the status would wait for the compile to finish
   glCompileShader(result);
+  return result;
+}
 
-  int linkok = 0;
-  glGetShaderiv(result, GL_COMPILE_STATUS, &linkok);
-  if (linkok == 0)
+// KHR_parallel_shader_compile is not in our GLAD profile
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+typedef void(APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+// With the extension glCompileShader and glLinkProgram return straight away and the driver works
+// on its own threads, without it most drivers still defer work until the status is asked for
+static void EnableParallelCompile()
+{
+  static bool checked = false;
+  if (checked)
+    return;
+  checked = true;
+  for (auto [extension, function] : {std::pair{"GL_KHR_parallel_shader_compile", "glMaxShaderCompilerThreadsKHR"},
+                                     std::pair{"GL_ARB_parallel_shader_compile", "glMaxShaderCompilerThreadsARB"}})
   {
-    char buffer[1000];
-    GLsizei len;
-    glGetShaderInfoLog(result, _countof(buffer), &len, buffer);
-    Log(Error, "Compile Failed: ", buffer);
-    throw std::runtime_error(buffer);
+    if (SDL_GL_ExtensionSupported(extension) == SDL_FALSE)
+      continue;
+    auto maxThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(SDL_GL_GetProcAddress(function));
+    if (maxThreads == nullptr)
+      continue;
+    // As many threads as the driver wants
+    maxThreads(0xFFFFFFFF);
+    Log(Message, "Compiling shaders in parallel with", extension);
+    return;
   }
+}
+
+// The name a .meta <variants> block uses for each flag and the #define it compiles in
+static const std::tuple<shaderVariant, const char *, const char *> variantNames[] = {
+    {shaderVariant::textured, "textured", "ORB_TEXTURED"},
+    {shaderVariant::lighting, "lighting", "ORB_LIGHTING"},
+};
 
-  Log(Message, "Shader compiled correctly: ", filepath);
+// Put the defines of a variant right after #version, which has to stay first
+static std::string WithDefines(std::string const &source, unsigned flags)
+{
+  std::string defines = "#define ORB_VARIANTS\n";
+  for (auto const &[flag, name, define] : variantNames)
+  {
+    if ((flags & static_cast<unsigned>(flag)) != 0)
+      defines += std::string("#define ") + define + "\n";
+  }
+  size_t at = 0;
+  const size_t version = source.find("#version");
+  if (version != std::string::npos)
+  {
+    at = source.find('\n', version);
+    at = at == std::string::npos ? source.size() : at + 1;
+  }
+  // Keep the line numbers of compile errors matching the file
+  defines += "#line " + std::to_string(std::count(source.begin(), source.begin() + at, '\n') + 1) + "\n";
+  std::string result = source;
+  result.insert(at, defines);
   return result;
 }
 
+void ShaderStage::Submit(std::vector<ShaderSource> const &sources, bool cacheable)
+{
+  const auto start = std::chrono::steady_clock::now();
+  EnableParallelCompile();
+  ProgramCache *cache = ProgramCache::Instance();
+  _cacheable = cacheable;
+  _variants.assign(_variantMask + 1, Variant());
+  for (unsigned flags = 0; flags <= _variantMask; ++flags)
+  {
+    // Only combinations of the flags the stage is specialised on
+    if ((flags & _variantMask) != flags)
+      continue;
+    Variant &v = _variants[flags];
+    v.program = flags == 0 ? _program : glCreateProgram();
+    std::vector<ShaderSource> specialised;
+    if (_variantMask != 0)
+    {
+      for (ShaderSource const &s : sources)
+        specialised.push_back({s.first, WithDefines(s.second, flags)});
+    }
+    std::vector<ShaderSource> const &used = _variantMask != 0 ? specialised : sources;
+    v.cacheKey = cacheable ? cache->Key(used, _inputAttributes) : 0;
+    v.pending = true;
+    if (cacheable && cache->Load(v.program, v.cacheKey))
+    {
+      v.pending = false;
+      continue;
+    }
+    for (ShaderSource const &s : used)
+    {
+      v.pendingShaders.push_back(CreateShader(s.first, s.second.c_str()));
+      glAttachShader(v.program, v.pendingShaders.back());
+    }
+    for (auto &in : _inputAttributes)
+      glBindAttribLocation(v.program, in.second.first, in.first.c_str());
+    glProgramParameteri(v.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(v.program);
+  }
+  cache->AddBuildTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+void ShaderStage::Finish()
+{
+  const auto start = std::chrono::steady_clock::now();
+  for (Variant &v : _variants)
+  {
+    if (v.pending == false)
+      continue;
+    // Compile errors say more than the link error they cause
+    for (GLuint s : v.pendingShaders)
+    {
+      int compileok = 0;
+      glGetShaderiv(s, GL_COMPILE_STATUS, &compileok);
+      if (compileok == 0)
+      {
+        char buffer[1000];
+        GLsizei len;
+        glGetShaderInfoLog(s, _countof(buffer), &len, buffer);
+        Log(Error, "Compile Failed: ", buffer);
+        throw std::runtime_error(buffer);
+      }
+    }
+
+    assert(glIsProgram(v.program));
+    GLint linkok = 0;
+    glGetProgramiv(v.program, GL_LINK_STATUS, &linkok);
+    if (linkok == 0)
+    {
+      char buffer[1000];
+      GLsizei len;
+      glGetProgramInfoLog(v.program, _countof(buffer), &len, buffer);
+      Log(Error, "Linking Failed: ", buffer);
+      throw std::runtime_error(buffer);
+    }
+    for (GLuint s : v.pendingShaders)
+    {
+      glDetachShader(v.program, s);
+      glDeleteShader(s);
+    }
+    v.pendingShaders.clear();
+    v.pending = false;
+    if (_cacheable)
+      ProgramCache::Instance()->Store(v.program, v.cacheKey);
+  }
+  _variant = 0;
+  _program = _variants[0].program;
+  InitializeShaderProgram();
+  ProgramCache::Instance()->AddBuildTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
 bool ShaderStage::hasStage(shaderStages s)
 {
   return (_activeShaders & static_cast<int>(s)) != 0;
 }
 
-void ShaderStage::InitializeShaderProgram()
+bool ShaderStage::IsCompute()
 {
+  return hasStage(shaderStages::compute);
+}
 
-  // Read that section
-  // Loop the input attributes
-  size_t totalSize = 0;
-  for (auto &in : _inputAttributes)
+namespace
+{
+  // One setter per GLSL type, picked once at reflection so a write is a single indirect call
+  void SetNothing(GLint, GLsizei, void const *) {}
+  void SetFloat(GLint l, GLsizei c, void const *d) { glUniform1fv(l, c, static_cast<GLfloat const *>(d)); }
+  void SetVec2(GLint l, GLsizei c, void const *d) { glUniform2fv(l, c, static_cast<GLfloat const *>(d)); }
+  void SetVec3(GLint l, GLsizei c, void const *d) { glUniform3fv(l, c, static_cast<GLfloat const *>(d)); }
+  void SetVec4(GLint l, GLsizei c, void const *d) { glUniform4fv(l, c, static_cast<GLfloat const *>(d)); }
+  void SetInt(GLint l, GLsizei c, void const *d) { glUniform1iv(l, c, static_cast<GLint const *>(d)); }
+  void SetIVec2(GLint l, GLsizei c, void const *d) { glUniform2iv(l, c, static_cast<GLint const *>(d)); }
+  void SetIVec3(GLint l, GLsizei c, void const *d) { glUniform3iv(l, c, static_cast<GLint const *>(d)); }
+  void SetIVec4(GLint l, GLsizei c, void const *d) { glUniform4iv(l, c, static_cast<GLint const *>(d)); }
+  void SetUInt(GLint l, GLsizei c, void const *d) { glUniform1uiv(l, c, static_cast<GLuint const *>(d)); }
+  void SetUVec2(GLint l, GLsizei c, void const *d) { glUniform2uiv(l, c, static_cast<GLuint const *>(d)); }
+  void SetUVec3(GLint l, GLsizei c, void const *d) { glUniform3uiv(l, c, static_cast<GLuint const *>(d)); }
+  void SetUVec4(GLint l, GLsizei c, void const *d) { glUniform4uiv(l, c, static_cast<GLuint const *>(d)); }
+  void SetMat2(GLint l, GLsizei c, void const *d) { glUniformMatrix2fv(l, c, GL_FALSE, static_cast<GLfloat const *>(d)); }
+  void SetMat3(GLint l, GLsizei c, void const *d) { glUniformMatrix3fv(l, c, GL_FALSE, static_cast<GLfloat const *>(d)); }
+  void SetMat4(GLint l, GLsizei c, void const *d) { glUniformMatrix4fv(l, c, GL_FALSE, static_cast<GLfloat const *>(d)); }
+
+  bool IsDouble(GLenum type)
   {
-    glBindAttribLocation(_program, in.second.first, in.first.c_str());
-    totalSize += in.second.second;
+    return type == GL_DOUBLE || (type >= GL_DOUBLE_VEC2 && type <= GL_DOUBLE_VEC4) || (type >= GL_DOUBLE_MAT2 && type <= GL_DOUBLE_MAT4x3);
+  }
+
+  UniformSetter SetterFor(GLenum type)
+  {
+    if (IsDouble(type))
+      return SetNothing;
+    switch (type)
+    {
+    case GL_FLOAT: return SetFloat;
+    case GL_FLOAT_VEC2: return SetVec2;
+    case GL_FLOAT_VEC3: return SetVec3;
+    case GL_FLOAT_VEC4: return SetVec4;
+    case GL_INT:
+    case GL_BOOL: return SetInt;
+    case GL_INT_VEC2:
+    case GL_BOOL_VEC2: return SetIVec2;
+    case GL_INT_VEC3:
+    case GL_BOOL_VEC3: return SetIVec3;
+    case GL_INT_VEC4:
+    case GL_BOOL_VEC4: return SetIVec4;
+    case GL_UNSIGNED_INT: return SetUInt;
+    case GL_UNSIGNED_INT_VEC2: return SetUVec2;
+    case GL_UNSIGNED_INT_VEC3: return SetUVec3;
+    case GL_UNSIGNED_INT_VEC4: return SetUVec4;
+    case GL_FLOAT_MAT2: return SetMat2;
+    case GL_FLOAT_MAT3: return SetMat3;
+    case GL_FLOAT_MAT4: return SetMat4;
+    }
+    // Every sampler and image type is set with the unit it reads from
+    return SetInt;
+  }
+
+  // Bytes of one element, what a write of that type reads
+  size_t TypeBytes(GLenum type)
+  {
+    const UniformSetter set = SetterFor(type);
+    if (set == SetVec2 || set == SetIVec2 || set == SetUVec2)
+      return 8;
+    if (set == SetVec3 || set == SetIVec3 || set == SetUVec3)
+      return 12;
+    if (set == SetVec4 || set == SetIVec4 || set == SetUVec4 || set == SetMat2)
+      return 16;
+    if (set == SetMat3)
+      return 36;
+    if (set == SetMat4)
+      return 64;
+    return 4;
+  }
+
+  const UniformSlot noUniform = {-1, 0, 1, SetNothing};
+
+  bool IsOpaque(GLenum type)
+  {
+    return SetterFor(type) == SetInt && type != GL_INT && type != GL_BOOL;
+  }
+
+  // The size codes .meta files used to give uniforms, checked against what the shader really declares
+  bool MatchesSizeCode(GLenum type, size_t code)
+  {
+    switch (code)
+    {
+    case ULLONG_MAX: return IsOpaque(type) || type == GL_INT;
+    case 64: return type == GL_FLOAT_MAT4;
+    case 16: return type == GL_FLOAT_VEC4;
+    case 12: return type == GL_FLOAT_VEC3;
+    case 8:
+    case 80: return type == GL_FLOAT_VEC2;
+    case 81: return type == GL_INT_VEC2;
+    case 4:
+    case 40: return type == GL_FLOAT;
+    case 1:
+    case 41: return type == GL_INT || type == GL_BOOL;
+    }
+    return true;
+  }
+
+  // Components of an input, vertex data is always fed as floats
+  size_t InputSize(GLenum type)
+  {
+    switch (type)
+    {
+    case GL_FLOAT_VEC2:
+    case GL_INT_VEC2:
+    case GL_UNSIGNED_INT_VEC2: return 2;
+    case GL_FLOAT_VEC3:
+    case GL_INT_VEC3:
+    case GL_UNSIGNED_INT_VEC3: return 3;
+    case GL_FLOAT_VEC4:
+    case GL_INT_VEC4:
+    case GL_UNSIGNED_INT_VEC4: return 4;
+    }
+    return 1;
+  }
+
+  std::string ResourceName(GLuint program, GLenum iface, GLuint i, GLint length)
+  {
+    std::string name(std::max(length, 1), '\0');
+    glGetProgramResourceName(program, iface, i, length, nullptr, name.data());
+    name.resize(std::strlen(name.c_str()));
+    return name;
+  }
+}
+
+void ShaderStage::ReflectUniforms(Variant &v)
+{
+  GLint count = 0;
+  glGetProgramInterfaceiv(v.program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+  for (GLint i = 0; i < count; ++i)
+  {
+    const GLenum props[] = {GL_NAME_LENGTH, GL_TYPE, GL_LOCATION, GL_ARRAY_SIZE, GL_BLOCK_INDEX};
+    GLint values[_countof(props)] = {};
+    glGetProgramResourceiv(v.program, GL_UNIFORM, i, _countof(props), props, _countof(values), nullptr, values);
+    // Members of uniform blocks are written through the block's buffer
+    if (values[4] != -1 || values[2] == -1)
+      continue;
+    std::string name = ResourceName(v.program, GL_UNIFORM, i, values[0]);
+    const GLenum type = static_cast<GLenum>(values[1]);
+    if (IsDouble(type))
+      Log(Warning, "Double uniform", name, "can't be written");
+    const UniformSlot slot = {values[2], type, values[3], SetterFor(type)};
+    auto found = _uniformIndex.find(name);
+    int index = found == _uniformIndex.end() ? -1 : found->second;
+    if (index == -1)
+    {
+      index = static_cast<int>(_uniformShapes.size());
+      _uniformShapes.push_back({0, 0});
+      _uniformIndex[name] = index;
+      // Arrays answer to both "name" and "name[0]"
+      const size_t bracket = name.rfind("[0]");
+      if (bracket != std::string::npos && bracket + 3 == name.size())
+        _uniformIndex[name.substr(0, bracket)] = index;
+    }
+    _uniformShapes[index] = {TypeBytes(type), std::max(_uniformShapes[index].second, slot.count)};
+    v.uniforms.resize(_uniformShapes.size(), noUniform);
+    v.uniforms[index] = slot;
+  }
+}
+
+void ShaderStage::Reflect()
+{
+  _uniformIndex.clear();
+  _uniformShapes.clear();
+  _blocks.clear();
+  for (Variant &v : _variants)
+  {
+    v.uniforms.clear();
+    if (v.program != 0)
+      ReflectUniforms(v);
+  }
+
+  // Uniforms a .meta or built in stage declares stay writable even if the compiler dropped them
+  for (auto &uni : _uniformAttributes)
+  {
+    auto found = _uniformIndex.find(uni.first);
+    if (found == _uniformIndex.end())
+    {
+      _uniformIndex[uni.first] = static_cast<int>(_uniformShapes.size());
+      _uniformShapes.push_back({0, 1});
+      uni.second.first = static_cast<GLuint>(-1);
+      continue;
+    }
+    // Every variant has the same declarations, the first one that kept the uniform is as good as any
+    UniformSlot slot = noUniform;
+    for (Variant const &v : _variants)
+    {
+      if (found->second < static_cast<int>(v.uniforms.size()) && v.uniforms[found->second].location != -1)
+      {
+        slot = v.uniforms[found->second];
+        break;
+      }
+    }
+    uni.second.first = slot.location;
+    if (MatchesSizeCode(slot.type, uni.second.second) == false)
+      Log(Warning, "Uniform", uni.first, "is declared with size", uni.second.second, "but the shader says type", slot.type);
   }
-  glLinkProgram(_program);
 
-  assert(glIsProgram(_program));
-  GLint linkok = 0;
-  glGetProgramiv(_program, GL_LINK_STATUS, &linkok);
-  if (linkok == 0)
+  GLint count = 0;
+  for (GLenum iface : {GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK})
   {
-    char buffer[1000];
-    GLsizei len;
-    glGetProgramInfoLog(_program, _countof(buffer), &len, buffer);
-    Log(Error, "Linking Failed: ", buffer);
-    throw std::runtime_error(buffer);
+    glGetProgramInterfaceiv(_program, iface, GL_ACTIVE_RESOURCES, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+      const GLenum props[] = {GL_NAME_LENGTH, GL_BUFFER_BINDING};
+      GLint values[_countof(props)] = {};
+      glGetProgramResourceiv(_program, iface, i, _countof(props), props, _countof(values), nullptr, values);
+      _blocks[ResourceName(_program, iface, i, values[0])] = {iface == GL_UNIFORM_BLOCK ? GL_UNIFORM_BUFFER : GL_SHADER_STORAGE_BUFFER, values[1]};
+    }
   }
+
+  // Stages without an <in> block take their inputs from the shader
+  if (_inputAttributes.empty() && hasStage(shaderStages::vertex))
+  {
+    glGetProgramInterfaceiv(_program, GL_PROGRAM_INPUT, GL_ACTIVE_RESOURCES, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+      const GLenum props[] = {GL_NAME_LENGTH, GL_TYPE, GL_LOCATION};
+      GLint values[_countof(props)] = {};
+      glGetProgramResourceiv(_program, GL_PROGRAM_INPUT, i, _countof(props), props, _countof(values), nullptr, values);
+      // Built ins like gl_VertexID have no location
+      if (values[2] == -1)
+        continue;
+      _inputAttributes[ResourceName(_program, GL_PROGRAM_INPUT, i, values[0])] = {static_cast<GLuint>(values[2]), InputSize(static_cast<GLenum>(values[1]))};
+    }
+  }
+  // Every variant answers to every index, uniforms it doesn't have write nowhere
+  for (Variant &v : _variants)
+    v.uniforms.resize(_uniformShapes.size(), noUniform);
+  _values.assign(_uniformShapes.size(), {});
+  _written.assign(_uniformShapes.size(), 0);
+  _writes = 0;
+  Log(Message, "Reflected", _uniformShapes.size(), "uniforms,", _blocks.size(), "blocks and", _inputAttributes.size(), "inputs over",
+      std::count_if(_variants.begin(), _variants.end(), [](Variant const &v) { return v.program != 0; }), "variants");
+}
+
+std::vector<shaderAttribute> ShaderStage::InputLayout() const
+{
+  // Interleaved in location order, which is the order the vertex struct declares them in
+  std::vector<shaderAttribute> layout;
+  for (auto const &in : _inputAttributes)
+    layout.push_back(in.second);
+  std::sort(layout.begin(), layout.end());
+  return layout;
+}
+
+void ShaderStage::InitializeShaderProgram()
+{
+  Reflect();
+  // Loop the input attributes
+  size_t totalSize = 0;
+  for (auto &in : _inputAttributes)
+    totalSize += in.second.second;
   glUseProgram(_program);
-  assert(linkok == 1 && "Link was not ok");
+  RenderStats::Instance()->UseProgram(_program);
   if (hasStage(shaderStages::vertex))
   {
     GLuint temp;
@@ -145,27 +523,21 @@ void ShaderStage::InitializeShaderProgram()
     }
     size_t offset = 0;
 
-    for (auto &in : _inputAttributes)
+    for (shaderAttribute const &in : InputLayout())
     {
       glVertexAttribPointer(
-          in.second.first,
-          static_cast<GLint>(in.second.second),
+          in.first,
+          static_cast<GLint>(in.second),
           GL_FLOAT,
           GL_FALSE,
           static_cast<GLsizei>(totalSize) * sizeof(float),
           reinterpret_cast<void *>(offset * sizeof(float)));
-      offset += in.second.second;
+      offset += in.second;
       CheckError(__LINE__);
     }
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
   }
-  for (auto &uni : _uniformAttributes)
-  {
-    uni.second.first = glGetUniformLocation(_program, uni.first.c_str());
-    CheckError(__LINE__);
-    Log(Message, "Recieved Uniform", uni.first, "location:", uni.second.first);
-  }
 }
 
 void ShaderStage::CleanUp()
@@ -180,7 +552,16 @@ void ShaderStage::CleanUp()
   _buffers.clear();
   _inputAttributes.clear();
   _uniformAttributes.clear();
-  glDeleteProgram(_program);
+  _uniformIndex.clear();
+  _uniformShapes.clear();
+  _values.clear();
+  _written.clear();
+  _blocks.clear();
+  if (_variants.empty())
+    glDeleteProgram(_program);
+  for (Variant const &v : _variants)
+    glDeleteProgram(v.program);
+  _variants.clear();
 }
 
 void ShaderStage::Dispatch(int x, int y, int z)
@@ -208,7 +589,8 @@ void ShaderStage::Dispatch(int x, int y, int z)
 
 GLuint ShaderStage::QueryUniformBinding(std::string uniform)
 {
-  return _uniformAttributes[uniform].first;
+  const int index = UniformIndex(uniform);
+  return index == -1 ? static_cast<GLuint>(-1) : static_cast<GLuint>(_variants[_variant].uniforms[index].location);
 }
 
 GLuint ShaderStage::QueryBufferID(std::string buffer)
@@ -240,16 +622,16 @@ std::string ShaderStage::MakeExtraVAO(std::string name)
   CheckError(__LINE__);
   size_t offset = 0;
 
-  for (auto &in : _inputAttributes)
+  for (shaderAttribute const &in : InputLayout())
   {
     glVertexAttribPointer(
-        in.second.first,
-        static_cast<GLint>(in.second.second),
+        in.first,
+        static_cast<GLint>(in.second),
         GL_FLOAT,
         GL_FALSE,
         static_cast<GLsizei>(totalSize) * sizeof(float),
         reinterpret_cast<void *>(offset * sizeof(float)));
-    offset += in.second.second;
+    offset += in.second;
     CheckError(__LINE__);
   }
   glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -291,16 +673,16 @@ void ShaderStage::SetBindings(GLuint b, GLuint VA)
   CheckError(__LINE__);
   size_t offset = 0;
 
-  for (auto &in : _inputAttributes)
+  for (shaderAttribute const &in : InputLayout())
   {
     glVertexAttribPointer(
-        in.second.first,
-        static_cast<GLint>(in.second.second),
+        in.first,
+        static_cast<GLint>(in.second),
         GL_FLOAT,
         GL_FALSE,
         static_cast<GLsizei>(totalSize) * sizeof(float),
         reinterpret_cast<void *>(offset * sizeof(float)));
-    offset += in.second.second;
+    offset += in.second;
     CheckError(__LINE__);
   }
   glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -322,9 +704,11 @@ ShaderStage::ShaderStage(int version)
     FLATTEN,
     DEFAULT_STORED_RENDER,
     DEFAULT_SHADOW_PASS,
+    UPSAMPLE,
   };
   _program = glCreateProgram();
   Log(Message, "Standard Shader Ctor");
+  std::vector<ShaderSource> sources;
   switch (static_cast<VERSIONS>(version))
   {
   case VERSIONS::DEFAULT_RENDER:
@@ -332,34 +716,7 @@ ShaderStage::ShaderStage(int version)
 #include "defaultRender.vert.inc"
 #include "defaultRender.frag.inc"
 
-    const char *const vert = defaultRender_vert;
-    const char *const frag = defaultRender_frag;
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER), vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(fragmentShader, 1, &frag, nullptr);
-    glShaderSource(vertexShader, 1, &vert, nullptr);
-    glCompileShader(vertexShader);
-    int linkok = 0;
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &linkok);
-    if (linkok == 0)
-    {
-      char buffer[1000];
-      GLsizei len;
-      glGetShaderInfoLog(vertexShader, _countof(buffer), &len, buffer);
-      Log(Error, "Compile Failed: ", buffer);
-      throw std::runtime_error(buffer);
-    }
-    glCompileShader(fragmentShader);
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &linkok);
-    if (linkok == 0)
-    {
-      char buffer[1000];
-      GLsizei len;
-      glGetShaderInfoLog(fragmentShader, _countof(buffer), &len, buffer);
-      Log(Error, "Compile Failed: ", buffer);
-      throw std::runtime_error(buffer);
-    }
-    glAttachShader(_program, fragmentShader);
-    glAttachShader(_program, vertexShader);
+    sources = {{GL_VERTEX_SHADER, defaultRender_vert}, {GL_FRAGMENT_SHADER, defaultRender_frag}};
     _inputAttributes["pos"] = {0, 4};
     _inputAttributes["vecColor"] = {1, 4};
     _inputAttributes["normal"] = {2, 4};
@@ -369,8 +726,6 @@ ShaderStage::ShaderStage(int version)
     _uniformAttributes["screenMatrix"] = {0, 64};
     _uniformAttributes["normalMatrix"] = {0, 64};
     _uniformAttributes["tex"] = {0, ULLONG_MAX};
-    _uniformAttributes["textured"] = {0, 1};
-    _uniformAttributes["enableLighting"] = {0, 1};
     _uniformAttributes["zoom"] = {0, 4};
     _uniformAttributes["specular_exponent"] = {0, 4};
     _uniformAttributes["diffuse_coefficient"] = {0, 12};
@@ -379,6 +734,11 @@ ShaderStage::ShaderStage(int version)
     _uniformAttributes["globalColor"] = {0, 16};
     _uniformAttributes["light_position"] = {0, 16};
     _uniformAttributes["eye_position"] = {0, 16};
+    _uniformAttributes["virtualTextured"] = {0, 1};
+    _uniformAttributes["vtIndirection"] = {0, ULLONG_MAX};
+    _uniformAttributes["vtInfo"] = {0, 16};
+    _uniformAttributes["vtPage"] = {0, 16};
+    _variantMask = static_cast<unsigned>(shaderVariant::textured) | static_cast<unsigned>(shaderVariant::lighting);
 
     // TODO: make ORB Settings function to enable or disable lighting, make functions to set light positions and material properties
     // Then turn the lighting into a multipass shader that uses a shadow mask to create shadows
@@ -393,40 +753,10 @@ ShaderStage::ShaderStage(int version)
 #include "flatten.vert.inc"
 #include "flatten.frag.inc"
 
-    const char *const vert = flatten_vert;
-    const char *const frag = flatten_frag;
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER), vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(fragmentShader, 1, &frag, nullptr);
-    glShaderSource(vertexShader, 1, &vert, nullptr);
-    glCompileShader(vertexShader);
-    int linkok = 0;
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &linkok);
-    if (linkok == 0)
-    {
-      char buffer[1000];
-      GLsizei len;
-      glGetShaderInfoLog(vertexShader, _countof(buffer), &len, buffer);
-      Log(Error, "Compile Failed: ", buffer);
-      throw std::runtime_error(buffer);
-    }
-    glCompileShader(fragmentShader);
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &linkok);
-    if (linkok == 0)
-    {
-      char buffer[1000];
-      GLsizei len;
-      glGetShaderInfoLog(fragmentShader, _countof(buffer), &len, buffer);
-      Log(Error, "Compile Failed: ", buffer);
-      throw std::runtime_error(buffer);
-    }
-    glAttachShader(_program, fragmentShader);
-    glAttachShader(_program, vertexShader);
-    _uniformAttributes["FBO"] = {0, ULLONG_MAX};
-    _uniformAttributes["FBOArray"] = {0, ULLONG_MAX};
-    _uniformAttributes["array"] = {0, 1};
-
-    _inputAttributes["pos"] = {0, 2};
-    _inputAttributes["texPos"] = {2, 2};
+    sources = {{GL_VERTEX_SHADER, flatten_vert}, {GL_FRAGMENT_SHADER, flatten_frag}};
+    _uniformAttributes["layers"] = {0, ULLONG_MAX};
+    _uniformAttributes["layerCount"] = {0, 1};
+    _uniformAttributes["viewportScale"] = {0, 8};
 
     _activeShaders |= static_cast<int>(shaderStages::fragment) | static_cast<int>(shaderStages::vertex);
 
@@ -437,36 +767,7 @@ ShaderStage::ShaderStage(int version)
   {
 #include "defaultStoredRender.vert.inc"
 #include "defaultStoredRender.frag.inc"
-    const char *const vert = defaultStoredRender_vert;
-    const char *const frag = defaultStoredRender_frag;
-
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER), vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(fragmentShader, 1, &frag, nullptr);
-    glShaderSource(vertexShader, 1, &vert, nullptr);
-    glCompileShader(vertexShader);
-    int linkok = 0;
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &linkok);
-    if (linkok == 0)
-    {
-      char buffer[1000];
-      GLsizei len;
-      glGetShaderInfoLog(vertexShader, _countof(buffer), &len, buffer);
-      Log(Error, "Compile Failed: ", buffer);
-      throw std::runtime_error(buffer);
-    }
-
-    glCompileShader(fragmentShader);
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &linkok);
-    if (linkok == 0)
-    {
-      char buffer[1000];
-      GLsizei len;
-      glGetShaderInfoLog(fragmentShader, _countof(buffer), &len, buffer);
-      Log(Error, "Compile Failed: ", buffer);
-      throw std::runtime_error(buffer);
-    }
-    glAttachShader(_program, fragmentShader);
-    glAttachShader(_program, vertexShader);
+    sources = {{GL_VERTEX_SHADER, defaultStoredRender_vert}, {GL_FRAGMENT_SHADER, defaultStoredRender_frag}};
     _inputAttributes["pos"] = {0, 4};
     _inputAttributes["vecColor"] = {1, 4};
     _inputAttributes["normal"] = {2, 4};
@@ -474,12 +775,12 @@ ShaderStage::ShaderStage(int version)
     //_uniformAttributes[name] = { 0, size };
     _uniformAttributes["screenMatrix"] = {0, 64};
     _uniformAttributes["tex"] = {0, ULLONG_MAX};
-    _uniformAttributes["textured"] = {0, 1};
-    _uniformAttributes["enableLighting"] = {0, 1};
+    _uniformAttributes["residentTextures"] = {0, ULLONG_MAX};
     _uniformAttributes["zoom"] = {0, 4};
     _uniformAttributes["light_color"] = {0, 12};
     _uniformAttributes["light_position"] = {0, 16};
     _uniformAttributes["eye_position"] = {0, 16};
+    _variantMask = static_cast<unsigned>(shaderVariant::textured) | static_cast<unsigned>(shaderVariant::lighting);
 
     // Then turn the lighting into a multipass shader that uses a shadow mask to create shadows
 
@@ -491,22 +792,8 @@ ShaderStage::ShaderStage(int version)
   case VERSIONS::DEFAULT_SHADOW_PASS:
   {
 #include "shadows.vert.inc"
-    const char *const vert = shadows_vert;
-    GLuint  vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vert, nullptr);
-    glCompileShader(vertexShader);
-    int linkok = 0;
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &linkok);
-    if (linkok == 0)
-    {
-      char buffer[1000];
-      GLsizei len;
-      glGetShaderInfoLog(vertexShader, _countof(buffer), &len, buffer);
-      Log(Error, "Compile Failed: ", buffer);
-      throw std::runtime_error(buffer);
-    }
-    glAttachShader(_program, vertexShader);
-        _inputAttributes["pos"] = {0, 4};
+    sources = {{GL_VERTEX_SHADER, shadows_vert}};
+    _inputAttributes["pos"] = {0, 4};
     _inputAttributes["vecColor"] = {1, 4};
     _inputAttributes["normal"] = {2, 4};
     _inputAttributes["texcoord"] = {3, 2};
@@ -514,11 +801,24 @@ ShaderStage::ShaderStage(int version)
     _uniformAttributes["zoom"] = {0, 4};
   }
   break;
+  case VERSIONS::UPSAMPLE:
+  {
+#include "flatten.vert.inc"
+#include "upsample.frag.inc"
+
+    sources = {{GL_VERTEX_SHADER, flatten_vert}, {GL_FRAGMENT_SHADER, upsample_frag}};
+    _uniformAttributes["source"] = {0, ULLONG_MAX};
+    _uniformAttributes["viewportScale"] = {0, 8};
+
+    _activeShaders |= static_cast<int>(shaderStages::fragment) | static_cast<int>(shaderStages::vertex);
   }
-  InitializeShaderProgram();
+  break;
+  }
+  Submit(sources);
+  Finish();
 }
 
-ShaderStage::ShaderStage(std::string path)
+ShaderStageDesc ShaderStage::Parse(std::string const &path)
 {
   Stream file(path);
   if (file.Open() == false)
@@ -528,9 +828,9 @@ ShaderStage::ShaderStage(std::string path)
   }
 
   // Read each line and check for <
+  ShaderStageDesc desc;
+  desc.path = path;
   std::string token;
-  _program = glCreateProgram();
-  std::vector<GLuint> shaders;
   while (file.isEOF() != true)
   {
     // if we fine a < then set what section we are reading
@@ -540,55 +840,29 @@ ShaderStage::ShaderStage(std::string path)
       //
       if (token == "<vertex>")
       {
-        _activeShaders |= static_cast<int>(shaderStages::vertex);
-
-        GLuint vert = CreateShader(
-            GL_VERTEX_SHADER, (file.readString()).c_str());
-        // Create the shader
-        shaders.push_back(vert);
-        assert(glIsShader(vert) && "Shader was not created properly");
-        glAttachShader(_program, vert);
-        Log(Message, "Created Vertex Stage");
+        desc.activeShaders |= static_cast<int>(shaderStages::vertex);
+        desc.sources.push_back({GL_VERTEX_SHADER, loadFile(file.readString().c_str())});
       }
       else if (token == "<fragment>")
       {
-        _activeShaders |= static_cast<int>(shaderStages::fragment);
-        GLuint frag = CreateShader(
-            GL_FRAGMENT_SHADER, (file.readString()).c_str());
-        assert(glIsShader(frag) && "Shader was not created properly");
-        glAttachShader(_program, frag);
-        shaders.push_back(frag);
-        Log(Message, "Created Fragment Stage");
+        desc.activeShaders |= static_cast<int>(shaderStages::fragment);
+        desc.sources.push_back({GL_FRAGMENT_SHADER, loadFile(file.readString().c_str())});
       }
       else if (token == "<compute>")
       {
-        if (hasStage(shaderStages::fragment) || hasStage(shaderStages::vertex))
+        if ((desc.activeShaders & (static_cast<int>(shaderStages::fragment) | static_cast<int>(shaderStages::vertex))) != 0)
         {
           throw std::invalid_argument("Cannot have compute shader in graphics pipeling");
         }
+        desc.activeShaders |= static_cast<int>(shaderStages::compute);
         if constexpr (ENABLE_SHADER_PRINTF)
         {
-
-#ifdef ASTRO_ENABLE_SHADER_PRINTF
-          _activeShaders |= static_cast<int>(shaderStages::compute);
-          GLuint com =
-              createShader("./Managed/shaders/" + file.readString(), GL_COMPUTE_SHADER);
-          assert(glIsShader(com) && "Shader was not created properly");
-          glAttachShader(_program, com);
-          shaders.push_back(com);
-          Log(Message, "Created Compute Stage: PRINTF ENABLED");
-#endif
+          // The printf library rewrites the source, there is nothing stable to key the cache on
+          desc.printfCompute = "./Managed/shaders/" + file.readString();
+          desc.cacheable = false;
         }
         else
-        {
-          _activeShaders |= static_cast<int>(shaderStages::compute);
-          GLuint com = CreateShader(
-              GL_COMPUTE_SHADER, (file.readString()).c_str());
-          assert(glIsShader(com) && "Shader was not created properly");
-          glAttachShader(_program, com);
-          shaders.push_back(com);
-          Log(Message, "Created Compute Stage: PRINTF DISABLED");
-        }
+          desc.sources.push_back({GL_COMPUTE_SHADER, loadFile(file.readString().c_str())});
       }
       else if (token == "<in>")
       {
@@ -610,8 +884,7 @@ ShaderStage::ShaderStage(std::string path)
           // Get the position
           GLuint pos = std::stoi(token);
           // Save it
-          _inputAttributes[name] = {pos, size};
-          Log(Message, "Added Attribute:", name, "at location:", pos, "to Shader:", path);
+          desc.inputs[name] = {pos, size};
         }
       }
       else if (token == "<uniform>")
@@ -634,15 +907,30 @@ ShaderStage::ShaderStage(std::string path)
             // Therefore we don't have a specified size as we have to use a different
             // way to bind it SO set the size to be ULLONG_MAX as like an identifier
             // number
-            _uniformAttributes[name] = {0, ULLONG_MAX};
+            desc.uniforms[name] = {0, ULLONG_MAX};
           }
           else
           {
             GLuint size = std::stoi(token);
-            _uniformAttributes[name] = {0, size};
+            desc.uniforms[name] = {0, size};
           }
-
-          Log(Message, "Added Uniform:", name, "to Shader:", path);
+        }
+      }
+      else if (token == "<variants>")
+      {
+        while (true)
+        {
+          token = makeLowerCase(file.readString());
+          if (token == "</variants>")
+            break;
+          auto found = std::find_if(std::begin(variantNames), std::end(variantNames), [&token](auto const &v)
+                                    { return token == std::get<1>(v); });
+          if (found == std::end(variantNames))
+          {
+            Log(Warning, "Unknown variant", token, "in", path);
+            continue;
+          }
+          desc.variants |= static_cast<unsigned>(std::get<0>(*found));
         }
       }
       else if (token == "<buffers>")
@@ -659,19 +947,95 @@ ShaderStage::ShaderStage(std::string path)
           // Erase the name
           token.erase(token.begin(), token.begin() + bracket + 1);
           int type = std::stoi(token);
-          GLuint newBuffer = 0;
-          glGenBuffers(1, &newBuffer);
-          _buffers[name] = {newBuffer, bufferTypes.at(type)};
-          Log(Message, "Added buffer:", name, "to Shader:", path);
+          desc.buffers.push_back({name, bufferTypes.at(type)});
         }
       }
     }
   }
-  InitializeShaderProgram();
-  for (auto &s : shaders)
+  return desc;
+}
+
+std::vector<ShaderStageDesc> ShaderStage::Parse(std::vector<std::string> const &paths)
+{
+  std::vector<ShaderStageDesc> descs(paths.size());
+  std::vector<std::exception_ptr> errors(paths.size());
+  std::atomic<size_t> next = 0;
+  auto worker = [&]()
+  {
+    for (size_t i = next++; i < paths.size(); i = next++)
+    {
+      try
+      {
+        descs[i] = Parse(paths[i]);
+      }
+      catch (...)
+      {
+        errors[i] = std::current_exception();
+      }
+    }
+  };
+  // The calling thread takes a share too
+  const size_t count = std::min<size_t>(paths.size(), std::max(std::thread::hardware_concurrency(), 1u));
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < count; ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread &t : threads)
+    t.join();
+  for (std::exception_ptr const &e : errors)
+  {
+    if (e != nullptr)
+      std::rethrow_exception(e);
+  }
+  return descs;
+}
+
+ShaderStageDesc ShaderStage::Parse(ORB_CompiledStage const &stage)
+{
+  ShaderStageDesc desc;
+  desc.path = stage.name;
+  desc.activeShaders = stage.activeShaders;
+  desc.variants = stage.variants;
+  for (ORB_CompiledSource const &s : stage.sources)
+    desc.sources.push_back({s.type, s.source});
+  for (ORB_CompiledAttribute const &in : stage.inputs)
+    desc.inputs[in.name] = {in.location, in.size};
+  for (ORB_CompiledAttribute const &uni : stage.uniforms)
+    desc.uniforms[uni.name] = {0, uni.size};
+  for (ORB_CompiledBuffer const &b : stage.buffers)
+    desc.buffers.push_back({b.name, bufferTypes.at(b.type)});
+  return desc;
+}
+
+ShaderStage::ShaderStage(ShaderStageDesc const &desc)
+    : _uniformAttributes(desc.uniforms), _inputAttributes(desc.inputs), _variantMask(desc.variants),
+      _activeShaders(desc.activeShaders)
+{
+  _program = glCreateProgram();
+  for (auto const &b : desc.buffers)
+  {
+    GLuint newBuffer = 0;
+    glGenBuffers(1, &newBuffer);
+    _buffers[b.first] = {newBuffer, b.second};
+  }
+#ifdef ASTRO_ENABLE_SHADER_PRINTF
+  if (desc.printfCompute.empty() == false)
   {
-    glDeleteShader(s);
+    GLuint com = createShader(desc.printfCompute, GL_COMPUTE_SHADER);
+    assert(glIsShader(com) && "Shader was not created properly");
+    glAttachShader(_program, com);
+    glDeleteShader(com);
+    Log(Message, "Created Compute Stage: PRINTF ENABLED");
   }
+#endif
+  Submit(desc.sources, desc.cacheable);
+  Log(Message, "Submitted", desc.sources.size(), "stages,", _inputAttributes.size(), "inputs,", _uniformAttributes.size(),
+      "uniforms and", _buffers.size(), "buffers of Shader:", desc.path);
+}
+
+ShaderStage::ShaderStage(std::string path) : ShaderStage(Parse(path))
+{
+  Finish();
 }
 
 ShaderStage::ShaderStage(const char *path) : ShaderStage(std::string(path))
@@ -680,7 +1044,9 @@ ShaderStage::ShaderStage(const char *path) : ShaderStage(std::string(path))
 
 ShaderStage::ShaderStage(ShaderStage &s)
     : _uniformAttributes(s._uniformAttributes), _inputAttributes(s._inputAttributes),
-      _buffers(s._buffers), _activeShaders(s._activeShaders), _program(s._program)
+      _buffers(s._buffers), _variants(s._variants), _variantMask(s._variantMask), _variant(s._variant),
+      _uniformIndex(s._uniformIndex), _uniformShapes(s._uniformShapes), _values(s._values), _written(s._written),
+      _writes(s._writes), _blocks(s._blocks), _activeShaders(s._activeShaders), _program(s._program)
 {
   s.keepAlive = true;
 }
@@ -690,6 +1056,15 @@ ShaderStage &ShaderStage::operator=(ShaderStage const &s)
   _uniformAttributes = s._uniformAttributes;
   _inputAttributes = s._inputAttributes;
   _buffers = s._buffers;
+  _variants = s._variants;
+  _variantMask = s._variantMask;
+  _variant = s._variant;
+  _uniformIndex = s._uniformIndex;
+  _uniformShapes = s._uniformShapes;
+  _values = s._values;
+  _written = s._written;
+  _writes = s._writes;
+  _blocks = s._blocks;
   _activeShaders = s._activeShaders;
   _program = s._program;
   const_cast<ShaderStage &>(s).keepAlive = true;
@@ -698,41 +1073,77 @@ ShaderStage &ShaderStage::operator=(ShaderStage const &s)
 
 void ShaderStage::WriteAttribute(std::string s, void *data)
 {
+  auto found = _uniformIndex.find(s);
+  if (found == _uniformIndex.end())
+  {
+    // Warn once, after that the name writes nowhere
+    Log(Warning, "Wrote to uniform", s, "which the shader does not have");
+    found = _uniformIndex.emplace(s, static_cast<int>(_uniformShapes.size())).first;
+    _uniformShapes.push_back({0, 1});
+    _values.emplace_back();
+    _written.push_back(0);
+    for (Variant &v : _variants)
+      v.uniforms.push_back(noUniform);
+  }
+  WriteUniform(found->second, data);
+}
+
+int ShaderStage::UniformIndex(std::string const &s) const
+{
+  auto found = _uniformIndex.find(s);
+  return found == _uniformIndex.end() ? -1 : found->second;
+}
+
+void ShaderStage::WriteUniform(int index, void const *data, int count)
+{
+  // Uniforms the stage doesn't have are ignored, like writing an unknown name
+  if (index < 0 || index >= static_cast<int>(_uniformShapes.size()))
+    return;
+  glUseProgram(_program);
+  RenderStats::Instance()->UseProgram(_program);
+  Variant &v = _variants[_variant];
+  UniformSlot const &slot = v.uniforms[index];
+  slot.set(slot.location, std::min(count, slot.count), data);
+  RenderStats::Instance()->UniformWrite();
+  if (_variantMask == 0)
+    return;
+  // Kept for the other variants, which get it when they are selected
+  auto const &[bytes, size] = _uniformShapes[index];
+  _values[index].assign(static_cast<unsigned char const *>(data), static_cast<unsigned char const *>(data) + bytes * std::min(count, size));
+  _written[index] = ++_writes;
+  v.synced = _writes;
+}
+
+void ShaderStage::SelectVariant(unsigned flags)
+{
+  flags &= _variantMask;
+  if (flags == _variant)
+    return;
+  _variant = flags;
+  Variant &v = _variants[flags];
+  _program = v.program;
   glUseProgram(_program);
-  auto &attrib = _uniformAttributes[s];
-  switch (attrib.second)
-  {
-  case ULLONG_MAX:
-    glUniform1i(attrib.first, *static_cast<int *>(data));
-    break;
-  case 64:
-    glUniformMatrix4fv(attrib.first, 1, false, reinterpret_cast<const GLfloat *>(data));
-    break;
-  case 16:
-    glUniform4fv(attrib.first, 1, reinterpret_cast<const GLfloat *>(data));
-    break;
-  case 12:
-    glUniform3fv(attrib.first, 1, reinterpret_cast<const GLfloat *>(data));
-    break;
-  case 81:
-    glUniform2iv(attrib.first, 1, reinterpret_cast<const GLint *>(data));
-    break;
-  case 80:
-  case 8:
-    glUniform2fv(attrib.first, 1, reinterpret_cast<const GLfloat *>(data));
-    break;
-  case 41:
-    glUniform1i(attrib.first, *reinterpret_cast<const GLint *>(data));
-    break;
-  case 40:
-  case 4:
-    glUniform1f(attrib.first, *reinterpret_cast<const GLfloat *>(data));
-    break;
-  case 1:
-    glUniform1i(attrib.first, *reinterpret_cast<int *>(data));
-    break;
-  }
-   //CheckError(__LINE__);
+  RenderStats::Instance()->UseProgram(_program);
+  for (size_t i = 0; i < _written.size(); ++i)
+  {
+    if (_written[i] <= v.synced || _values[i].empty())
+      continue;
+    UniformSlot const &slot = v.uniforms[i];
+    const GLsizei count = static_cast<GLsizei>(_values[i].size() / _uniformShapes[i].first);
+    slot.set(slot.location, std::min(count, slot.count), _values[i].data());
+  }
+  v.synced = _writes;
+}
+
+unsigned ShaderStage::Variants() const
+{
+  return _variantMask;
+}
+
+int ShaderStage::QueryBlockBinding(std::string const &block) const
+{
+  auto found = _blocks.find(block);
+  return found == _blocks.end() ? -1 : found->second.second;
 }
 
 void ShaderStage::WriteBuffer(std::string s, size_t dataSize, void *data)
@@ -746,6 +1157,10 @@ void ShaderStage::WriteSubBufferData(std::string s, int index, size_t structSize
   auto &bufferObject = _buffers[s];
   glBufferSubData(bufferObject.second, index * structSize, structSize, data);
 }
+shaderBuffer ShaderStage::GetBuffer(std::string s)
+{
+  return _buffers[s];
+}
 void ShaderStage::SetBufferBase(std::string buffer, int base)
 {
   auto &bufferObject = _buffers[buffer];
@@ -772,11 +1187,12 @@ void ShaderStage::UnBindBuffer(std::string s)
 void ShaderStage::SetActive(void)
 {
   glUseProgram(_program);
+  RenderStats::Instance()->UseProgram(_program);
 }
 
 bool ShaderStage::QuerryAttribute(std::string s)
 {
-  return _uniformAttributes.find(s) != _uniformAttributes.end();
+  return _uniformIndex.find(s) != _uniformIndex.end();
 }
 
 inline GLuint ShaderStage::Program()
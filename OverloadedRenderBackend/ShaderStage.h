@@ -9,7 +9,12 @@
 #pragma once
 
 #include <glad.h>
+#include <string>
 #include <unordered_map>
+#include <vector>
+#include "Program Cache.h"
+
+typedef struct ORB_CompiledStage ORB_CompiledStage;
 
 // Read in the meta file
 // load the shaders and create the program
@@ -25,6 +30,13 @@ enum class shaderStages : long
     geometry = 1 << 3,
 };
 
+// Render state a stage can be specialised on, each flag is compiled in as a #define so the shader doesn't branch on it
+enum class shaderVariant : unsigned
+{
+    textured = 1 << 0, // ORB_TEXTURED
+    lighting = 1 << 1, // ORB_LIGHTING
+};
+
 const std::unordered_map<int, GLenum> bufferTypes = {
     {0, GL_ARRAY_BUFFER},
     {1, GL_ATOMIC_COUNTER_BUFFER},
@@ -43,6 +55,49 @@ const std::unordered_map<int, GLenum> bufferTypes = {
 // size is in bytes
 typedef std::pair<GLuint, size_t> shaderAttribute;
 typedef std::pair<GLuint, GLenum> shaderBuffer;
+typedef void (*UniformSetter)(GLint location, GLsizei count, void const* data);
+
+/**@typedef
+ * @brief A uniform of a linked program, found by reflection.
+ *
+ * @details location - the uniform's location, -1 if the compiler removed it
+ *          type     - the GLSL type, GL_FLOAT_VEC4 etc.
+ *          count    - array size, 1 for plain uniforms
+ *          set      - writes count values of the type at a location
+ */
+typedef struct UniformSlot
+{
+    GLint location;
+    GLenum type;
+    GLint count;
+    UniformSetter set;
+}UniformSlot;
+
+/**@typedef
+ * @brief Everything a shader stage .meta file describes, read without touching GL so it can be made on any thread.
+ *
+ * @details sources       - the source of each stage
+ *          inputs        - attribute locations and sizes
+ *          uniforms      - uniform sizes, locations are filled after linking
+ *          buffers       - buffer names and targets
+ *          activeShaders - shaderStages bit mask
+ *          variants      - shaderVariant flags the stage is specialised on, one program is built per combination
+ *          cacheable     - if the program may go through the ProgramCache
+ *          printfCompute - compute shader to compile with the printf library instead
+ */
+typedef struct ShaderStageDesc
+{
+    std::string path;
+    std::vector<ShaderSource> sources;
+    std::unordered_map<std::string, shaderAttribute> inputs;
+    std::unordered_map<std::string, shaderAttribute> uniforms;
+    std::vector<std::pair<std::string, GLenum>> buffers;
+    long activeShaders = 0;
+    unsigned variants = 0;
+    bool cacheable = true;
+    std::string printfCompute;
+}ShaderStageDesc;
+
 class RenderPass;
 class ShaderStage
 {
@@ -67,6 +122,40 @@ public:
      * @param path const char* version
      */
     ShaderStage(const char* path);
+    /**
+     * @brief Create the program of a parsed stage and hand its shaders to the driver.
+     *
+     * @details Nothing waits on the compile, Finish must be called before the stage is used.
+     * Submitting every stage of a pass before finishing any lets the driver compile them together.
+     * @param desc the parsed stage
+     */
+    ShaderStage(ShaderStageDesc const& desc);
+    /**
+     * @brief Read a shader stage .meta file and the sources it names.
+     *
+     * @param path the .meta file
+     * @return the parsed stage
+     */
+    static ShaderStageDesc Parse(std::string const& path);
+    /**
+     * @brief Parse several .meta files on a pool of threads.
+     *
+     * @param paths the .meta files
+     * @return the parsed stages in the same order
+     */
+    static std::vector<ShaderStageDesc> Parse(std::vector<std::string> const& paths);
+    /**
+     * @brief Make a stage description from one compiled by the PipelineCompiler, without reading any files.
+     *
+     * @param stage the compiled stage
+     * @return the stage description
+     */
+    static ShaderStageDesc Parse(ORB_CompiledStage const& stage);
+    /**
+     * @brief Wait for the program to link, check it for errors and look up its uniforms.
+     *
+     */
+    void Finish();
     ShaderStage(ShaderStage& s);
     ShaderStage& operator=(ShaderStage const&);
     /**
@@ -76,6 +165,42 @@ public:
      * @param data pointer to the data to write
      */
     void WriteAttribute(std::string s, void* data);
+    /**
+     * @brief Get the index of a uniform for WriteUniform.
+     *
+     * @param s the uniform
+     * @return the index, -1 if the stage has no such uniform
+     */
+    int UniformIndex(std::string const& s) const;
+    /**
+     * @brief Write a uniform by index, skipping the name lookup.
+     *
+     * @param index from UniformIndex, -1 is ignored
+     * @param data the value, laid out as the uniform's GLSL type
+     * @param count array elements to write
+     */
+    void WriteUniform(int index, void const* data, int count = 1);
+    /**
+     * @brief Get the binding point of a uniform block or shader storage block.
+     *
+     * @param block the block name
+     * @return the binding, -1 if the stage has no such block
+     */
+    int QueryBlockBinding(std::string const& block) const;
+    /**
+     * @brief Switch to the program built for a set of shaderVariant flags.
+     *
+     * @details Flags the stage isn't specialised on are ignored. Uniforms written
+     * since the program was last active are written to it again.
+     * @param flags the shaderVariant flags
+     */
+    void SelectVariant(unsigned flags);
+    /**
+     * @brief Get the shaderVariant flags the stage is specialised on.
+     *
+     * @return the flags, 0 if the stage has a single program
+     */
+    unsigned Variants() const;
 
     /**
      * @brief Write data to a buffer
@@ -88,6 +213,13 @@ public:
 
     void WriteSubBufferData(std::string, int index, size_t structSize, void* data);
     void SetBufferBase(std::string buffer, int base);
+    /**
+     * @brief Get the GL name and target of a buffer
+     *
+     * @param s the buffer
+     * @return the name and target
+     */
+    shaderBuffer GetBuffer(std::string s);
 
 
     /**
@@ -111,6 +243,12 @@ public:
     void SetActive(void);
 
     bool QuerryAttribute(std::string);
+    /**
+     * @brief Check if the stage is a compute shader, its writes need a memory barrier before they are read
+     *
+     * @return true for a compute stage
+     */
+    bool IsCompute();
     /**
      * @brief Get the program id
      *
@@ -159,14 +297,35 @@ public:
     void SetBindings(GLuint b, GLuint VA);
 
 private:
+    // One program per combination of the variant flags, indexed by the flags
+    typedef struct Variant
+    {
+        GLuint program = 0;
+        // What the linked program really has, _uniformAttributes only holds what was declared
+        std::vector<UniformSlot> uniforms;
+        // Between Submit and Finish
+        std::vector<GLuint> pendingShaders;
+        bool pending = false;
+        unsigned long long cacheKey = 0;
+        // The last uniform write this program has seen
+        unsigned long long synced = 0;
+    }Variant;
+
     /**
-     * @brief Create a shader from a file
+     * @brief Start compiling a shader, the result is checked by Finish
      *
      * @param type the type of the shader
-     * @param filepath the file path to the shader
+     * @param source the source of the shader
      * @return the assigned id of the shader
      */
-    GLuint CreateShader(GLenum type, const char* filepath);
+    GLuint CreateShader(GLenum type, const char* source);
+    /**
+     * @brief Load the program from the program cache, or start compiling and linking it
+     *
+     * @param sources the stages of the program
+     * @param cacheable if the program may be loaded from and saved to the cache
+     */
+    void Submit(std::vector<ShaderSource> const& sources, bool cacheable = true);
     /**
      * @brief Check if the shader has a specific stage
      *
@@ -175,13 +334,41 @@ private:
     bool hasStage(shaderStages s);
 
     void InitializeShaderProgram();
+    /**
+     * @brief Fill the uniform table, blocks and, when the .meta has no <in> block, the inputs from the linked program
+     *
+     */
+    void Reflect();
+    // The inputs sorted by location, the order their offsets into a vertex go in
+    std::vector<shaderAttribute> InputLayout() const;
+    /**
+     * @brief Add the active uniforms of a variant's program to the uniform table
+     *
+     */
+    void ReflectUniforms(Variant& v);
 
     // Using unordered map cause we dont care about order
     std::unordered_map<std::string, shaderAttribute> _uniformAttributes;
     std::unordered_map<std::string, shaderAttribute> _inputAttributes;
     std::unordered_map<std::string, shaderBuffer> _buffers;
+    std::vector<Variant> _variants;
+    unsigned _variantMask = 0;
+    unsigned _variant = 0;
+    // Shared by every variant, so an index is the same in all of them
+    std::unordered_map<std::string, int> _uniformIndex;
+    // Bytes of one element and the array size of each uniform
+    std::vector<std::pair<size_t, GLint>> _uniformShapes;
+    // Last value written to each uniform and when, to bring other variants up to date
+    std::vector<std::vector<unsigned char>> _values;
+    std::vector<unsigned long long> _written;
+    unsigned long long _writes = 0;
+    // target and binding of each uniform and storage block
+    std::unordered_map<std::string, std::pair<GLenum, GLint>> _blocks;
 
     long _activeShaders = 0;
     bool keepAlive = false;
+    // The program of the active variant
     GLuint _program;
+
+    bool _cacheable = false;
 };
@@ -9,6 +9,7 @@
 #include "pch.h"
 
 #include "Stream.h"
+#include "Asset Pack.h"
 #include <algorithm>
 std::string makeLowerCase(std::string s)
 {
@@ -29,10 +30,43 @@ fileTypes GetFileType(std::string s)
 }
 
 
+void MemoryBuffer::Set(std::string_view data)
+{
+    char* begin = const_cast<char*>(data.data());
+    setg(begin, begin, begin + data.size());
+}
+
+MemoryBuffer::pos_type MemoryBuffer::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+    if ((which & std::ios_base::in) == 0)
+        return pos_type(off_type(-1));
+    off_type at = off;
+    if (dir == std::ios_base::cur)
+        at += gptr() - eback();
+    else if (dir == std::ios_base::end)
+        at += egptr() - eback();
+    if (at < 0 || at > egptr() - eback())
+        return pos_type(off_type(-1));
+    setg(eback(), eback() + at, egptr());
+    return pos_type(at);
+}
+
+MemoryBuffer::pos_type MemoryBuffer::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
 Stream::Stream(const char* fileName)
 {
-    _s.open(fileName);
     _path = fileName;
+    std::string_view packed;
+    if (AssetPack::Instance()->Read(_path, packed, _unpacked))
+    {
+        _memory.Set(packed);
+        _s.rdbuf(&_memory);
+    }
+    else if (_file.open(fileName, std::ios::in) != nullptr)
+        _s.rdbuf(&_file);
 }
 
 Stream::Stream(std::string const& fileName) : Stream(fileName.c_str())
@@ -41,8 +75,8 @@ Stream::Stream(std::string const& fileName) : Stream(fileName.c_str())
 
 Stream::~Stream()
 {
-    if (_s.is_open())
-        _s.close();
+    if (_file.is_open())
+        _file.close();
 }
 
 size_t Stream::location()
@@ -93,7 +127,17 @@ std::string Stream::readAllLines(void)
 std::string Stream::readLine(void)
 {
   std::string line;
-  return std::getline(_s, line), line == "" ? std::getline(_s, line) : _s , line;
+  // Packed files keep the \r a text mode ifstream would drop
+  auto next = [&]
+  {
+    std::getline(_s, line);
+    if (line.empty() == false && line.back() == '\r')
+      line.pop_back();
+  };
+  next();
+  if (line == "")
+    next();
+  return line;
 }
 
 
@@ -127,7 +171,7 @@ bool Stream::readBool(void)
 
 bool Stream::Open()
 {
-    return _s.is_open();
+    return _s.rdbuf() != nullptr;
 }
 
 bool Stream::isEOF()
@@ -11,6 +11,8 @@
 #include <fstream>
 #include <glm.hpp>
 #include <string>
+#include <string_view>
+#include <vector>
 enum class fileTypes : int
 {
   invalid = -1,
@@ -28,11 +30,25 @@ enum class fileTypes : int
 std::string makeLowerCase(std::string s);
 fileTypes GetFileType(std::string s);
 
+/**
+ * @brief A read only stream buffer over memory, used for files found in an asset pack.
+ *
+ */
+class MemoryBuffer : public std::streambuf
+{
+public:
+    void Set(std::string_view data);
+
+protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+};
+
 class Stream
 {
 public:
     /**
-     * @brief Ctors
+     * @brief Ctors, the mounted asset packs are checked for the file before the disk
      *
      * @param fileName the file to open a stream to
      */
@@ -137,6 +153,11 @@ public:
     std::string Path();
 
 private:
-    std::ifstream _s;
+    std::filebuf _file;
+    MemoryBuffer _memory;
+    // A decompressed packed file
+    std::vector<char> _unpacked;
+    // Reads from _file or _memory, no buffer if the file wasn't found
+    std::istream _s{nullptr};
     std::string _path;
 };
@@ -0,0 +1,279 @@
+#include "pch.h"
+#include "Texture Container.h"
+#include "Asset Pack.h"
+#include <bit>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+  // Vulkan formats a KTX2 file can hold that we can upload
+  enum VkFormat : unsigned
+  {
+    VK_FORMAT_R8G8B8A8_UNORM = 37,
+    VK_FORMAT_R8G8B8A8_SRGB = 43,
+    VK_FORMAT_BC1_RGBA_UNORM_BLOCK = 133,
+    VK_FORMAT_BC1_RGBA_SRGB_BLOCK = 134,
+    VK_FORMAT_BC3_UNORM_BLOCK = 137,
+    VK_FORMAT_BC3_SRGB_BLOCK = 138,
+    VK_FORMAT_BC7_UNORM_BLOCK = 145,
+    VK_FORMAT_BC7_SRGB_BLOCK = 146,
+  };
+
+  // The DXGI formats a DX10 DDS header can hold that we can upload
+  enum DxgiFormat : unsigned
+  {
+    DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+    DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29,
+    DXGI_FORMAT_BC1_UNORM = 71,
+    DXGI_FORMAT_BC1_UNORM_SRGB = 72,
+    DXGI_FORMAT_BC3_UNORM = 77,
+    DXGI_FORMAT_BC3_UNORM_SRGB = 78,
+    DXGI_FORMAT_BC7_UNORM = 98,
+    DXGI_FORMAT_BC7_UNORM_SRGB = 99,
+  };
+
+  constexpr unsigned char ktx2Identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+  template <typename T>
+  T Read(std::vector<unsigned char> const& data, size_t offset)
+  {
+    T v;
+    std::memcpy(&v, data.data() + offset, sizeof(T));
+    return v;
+  }
+
+  constexpr unsigned FourCC(char a, char b, char c, char d)
+  {
+    return unsigned(a) | (unsigned(b) << 8) | (unsigned(c) << 16) | (unsigned(d) << 24);
+  }
+
+  GLenum FromVkFormat(unsigned f)
+  {
+    switch (f)
+    {
+    case VK_FORMAT_R8G8B8A8_UNORM: return GL_RGBA8;
+    case VK_FORMAT_R8G8B8A8_SRGB: return GL_SRGB8_ALPHA8;
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+    case VK_FORMAT_BC3_UNORM_BLOCK: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case VK_FORMAT_BC3_SRGB_BLOCK: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+    case VK_FORMAT_BC7_UNORM_BLOCK: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    case VK_FORMAT_BC7_SRGB_BLOCK: return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+    }
+    return 0;
+  }
+
+  GLenum FromDxgiFormat(unsigned f)
+  {
+    switch (f)
+    {
+    case DXGI_FORMAT_R8G8B8A8_UNORM: return GL_RGBA8;
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB: return GL_SRGB8_ALPHA8;
+    case DXGI_FORMAT_BC1_UNORM: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    case DXGI_FORMAT_BC1_UNORM_SRGB: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+    case DXGI_FORMAT_BC3_UNORM: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case DXGI_FORMAT_BC3_UNORM_SRGB: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+    case DXGI_FORMAT_BC7_UNORM: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    case DXGI_FORMAT_BC7_UNORM_SRGB: return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+    }
+    return 0;
+  }
+
+  // Bytes per 4x4 block, 0 for formats that are not block compressed
+  size_t BlockBytes(GLenum format)
+  {
+    switch (format)
+    {
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+      return 8;
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+    case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+      return 16;
+    }
+    return 0;
+  }
+
+  // Bigger than any GPU can make, and keeps the level sizes far from overflowing
+  constexpr int maxDimension = 1 << 16;
+
+  // Levels of a full mip chain down to 1x1, files can't have more
+  unsigned MaxLevels(int w, int h)
+  {
+    return static_cast<unsigned>(std::bit_width(static_cast<unsigned>(std::max(w, h))));
+  }
+
+  bool ValidSize(int w, int h, std::string& error)
+  {
+    if (w <= 0 || h <= 0 || w > maxDimension || h > maxDimension)
+      return error = "bad size " + std::to_string(w) + "x" + std::to_string(h), false;
+    return true;
+  }
+
+  size_t LevelBytes(GLenum format, int w, int h)
+  {
+    const size_t block = BlockBytes(format);
+    if (block == 0)
+      return static_cast<size_t>(w) * h * 4;
+    return static_cast<size_t>((w + 3) / 4) * ((h + 3) / 4) * block;
+  }
+
+  bool ReadKTX2(TextureContainer& out, std::string& error)
+  {
+    std::vector<unsigned char> const& d = out.data;
+    if (d.size() < 80)
+      return error = "truncated header", false;
+    const unsigned vkFormat = Read<unsigned>(d, 12);
+    const int w = Read<int>(d, 20), h = Read<int>(d, 24);
+    if (ValidSize(w, h, error) == false)
+      return false;
+    const unsigned depth = Read<unsigned>(d, 28), layers = Read<unsigned>(d, 32), faces = Read<unsigned>(d, 36);
+    const unsigned levelCount = std::clamp(Read<unsigned>(d, 40), 1u, MaxLevels(w, h));
+    if (Read<unsigned>(d, 44) != 0)
+      return error = "supercompressed files are not supported", false;
+    if (depth > 1 || layers > 1 || faces != 1)
+      return error = "only 2D textures are supported", false;
+    out.format = FromVkFormat(vkFormat);
+    if (out.format == 0)
+      return error = "unsupported vkFormat " + std::to_string(vkFormat), false;
+    if (d.size() < 80 + size_t(levelCount) * 24)
+      return error = "truncated level index", false;
+
+    for (unsigned i = 0; i < levelCount; ++i)
+    {
+      TextureLevel l;
+      l.w = std::max(w >> i, 1);
+      l.h = std::max(h >> i, 1);
+      l.offset = static_cast<size_t>(Read<unsigned long long>(d, 80 + size_t(i) * 24));
+      l.size = static_cast<size_t>(Read<unsigned long long>(d, 80 + size_t(i) * 24 + 8));
+      out.levels.push_back(l);
+    }
+    return true;
+  }
+
+  bool ReadDDS(TextureContainer& out, std::string& error)
+  {
+    std::vector<unsigned char> const& d = out.data;
+    if (d.size() < 128)
+      return error = "truncated header", false;
+    const int h = Read<int>(d, 12), w = Read<int>(d, 16);
+    if (ValidSize(w, h, error) == false)
+      return false;
+    const unsigned levelCount = std::clamp(Read<unsigned>(d, 28), 1u, MaxLevels(w, h));
+    const unsigned pfFlags = Read<unsigned>(d, 80), fourCC = Read<unsigned>(d, 84);
+    size_t offset = 128;
+
+    if ((pfFlags & 0x4) != 0) // DDPF_FOURCC
+    {
+      if (fourCC == FourCC('D', 'X', 'T', '1'))
+        out.format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+      else if (fourCC == FourCC('D', 'X', 'T', '5'))
+        out.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+      else if (fourCC == FourCC('D', 'X', '1', '0'))
+      {
+        if (d.size() < 148)
+          return error = "truncated DX10 header", false;
+        if (Read<unsigned>(d, 132) != 3 || Read<unsigned>(d, 140) > 1) // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+          return error = "only 2D textures are supported", false;
+        out.format = FromDxgiFormat(Read<unsigned>(d, 128));
+        offset = 148;
+      }
+    }
+    else if ((pfFlags & 0x40) != 0 && Read<unsigned>(d, 88) == 32) // DDPF_RGB
+    {
+      out.format = GL_RGBA8;
+      out.pixelFormat = Read<unsigned>(d, 92) == 0xff ? GL_RGBA : GL_BGRA;
+    }
+    if (out.format == 0)
+      return error = "unsupported pixel format", false;
+
+    // DDS levels are stored back to back from level 0
+    for (unsigned i = 0; i < levelCount; ++i)
+    {
+      TextureLevel l;
+      l.w = std::max(w >> i, 1);
+      l.h = std::max(h >> i, 1);
+      l.offset = offset;
+      l.size = LevelBytes(out.format, l.w, l.h);
+      offset += l.size;
+      out.levels.push_back(l);
+    }
+    return true;
+  }
+}
+
+bool IsTextureContainer(std::string const& filename)
+{
+  const size_t dot = filename.rfind('.');
+  if (dot == std::string::npos)
+    return false;
+  std::string ext = filename.substr(dot);
+  std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  return ext == ".ktx2" || ext == ".dds";
+}
+
+bool ReadTextureContainer(std::string const& filename, TextureContainer& out, std::string& error)
+{
+  std::string_view packed;
+  std::vector<char> unpacked;
+  if (AssetPack::Instance()->Read(filename, packed, unpacked))
+    out.data.assign(packed.begin(), packed.end());
+  else
+  {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (file.is_open() == false)
+      return error = "could not open file", false;
+    out.data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(out.data.data()), out.data.size());
+  }
+
+  bool read = false;
+  if (out.data.size() >= 12 && std::memcmp(out.data.data(), ktx2Identifier, 12) == 0)
+    read = ReadKTX2(out, error);
+  else if (out.data.size() >= 4 && Read<unsigned>(out.data, 0) == FourCC('D', 'D', 'S', ' '))
+    read = ReadDDS(out, error);
+  else
+    error = "not a KTX2 or DDS file";
+  if (read == false)
+    return false;
+
+  out.compressed = BlockBytes(out.format) != 0;
+  for (auto const& l : out.levels)
+  {
+    // Checked without adding, a crafted offset near the top of size_t would wrap
+    if (l.offset > out.data.size() || l.size > out.data.size() - l.offset || l.size < LevelBytes(out.format, l.w, l.h))
+      return error = "level data runs past the end of the file", false;
+  }
+  return true;
+}
+
+GLuint UploadTextureContainer(TextureContainer const& c)
+{
+  const int levels = static_cast<int>(c.levels.size());
+  GLuint texture = 0;
+  glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+  glTextureStorage2D(texture, levels, c.format, c.levels[0].w, c.levels[0].h);
+  for (int i = 0; i < levels; ++i)
+  {
+    TextureLevel const& l = c.levels[i];
+    if (c.compressed)
+      glCompressedTextureSubImage2D(texture, i, 0, 0, l.w, l.h, c.format, static_cast<GLsizei>(l.size), c.data.data() + l.offset);
+    else
+      glTextureSubImage2D(texture, i, 0, 0, l.w, l.h, c.pixelFormat, GL_UNSIGNED_BYTE, c.data.data() + l.offset);
+  }
+  glTextureParameteri(texture, GL_TEXTURE_MAX_LEVEL, levels - 1);
+  glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST);
+  return texture;
+}
+
+size_t TextureBytes(GLenum format, int w, int h, int levels)
+{
+  size_t bytes = 0;
+  for (int i = 0; i < levels; ++i)
+    bytes += LevelBytes(format, std::max(w >> i, 1), std::max(h >> i, 1));
+  return bytes;
+}
@@ -0,0 +1,86 @@
+/*********************************************************************
+ * @file   Texture Container.h
+ * @brief  Reads KTX2 and DDS files holding pre-mipmapped, optionally
+ * block compressed, textures
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#pragma once
+#include <glad.h>
+#include <string>
+#include <vector>
+
+// EXT_texture_compression_s3tc is on every desktop driver but not in our GLAD profile
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+/**@typedef
+ * @brief One mip level of a texture container.
+ *
+ * @details w, h   - size of the level in pixels
+ *          offset - where the level starts in TextureContainer::data
+ *          size   - size of the level in bytes
+ */
+typedef struct TextureLevel
+{
+  int w, h;
+  size_t offset, size;
+}TextureLevel;
+
+/**@typedef
+ * @brief A texture read from a KTX2 or DDS file, ready to upload.
+ *
+ * @details format      - sized internal format to allocate the texture with
+ *          pixelFormat - client format of uncompressed data, GL_RGBA or GL_BGRA
+ *          compressed  - if the levels are block compressed
+ *          levels      - the mip chain, level 0 first
+ *          data        - the contents of the file
+ */
+typedef struct TextureContainer
+{
+  GLenum format = 0;
+  GLenum pixelFormat = GL_RGBA;
+  bool compressed = false;
+  std::vector<TextureLevel> levels;
+  std::vector<unsigned char> data;
+}TextureContainer;
+
+/**
+ * @brief Check if a file should be read with ReadTextureContainer.
+ *
+ * @param filename the file
+ * @return if the file is a .ktx2 or .dds file
+ */
+bool IsTextureContainer(std::string const& filename);
+/**
+ * @brief Read a KTX2 or DDS file.
+ *
+ * @details Supports 2D textures stored as BC1, BC3, BC7 or RGBA8, without supercompression.
+ * @param filename the file
+ * @param out the container to fill
+ * @param error why the file could not be read
+ * @return if the file was read
+ */
+bool ReadTextureContainer(std::string const& filename, TextureContainer& out, std::string& error);
+/**
+ * @brief Make a texture with storage for every level and upload them.
+ *
+ * @param c the container
+ * @return the texture
+ */
+GLuint UploadTextureContainer(TextureContainer const& c);
+/**
+ * @brief Get the GPU size of a texture.
+ *
+ * @param format the sized internal format
+ * @param w the width of level 0
+ * @param h the height of level 0
+ * @param levels the number of mip levels
+ * @return the size in bytes
+ */
+size_t TextureBytes(GLenum format, int w, int h, int levels);
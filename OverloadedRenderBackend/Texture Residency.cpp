@@ -0,0 +1,171 @@
+#include "pch.h"
+#include "Texture Residency.h"
+#include "Textures.h"
+
+// Empty space left around each texture so neighbours do not bleed into each other
+constexpr int padding = 2;
+constexpr int initialLayers = 4;
+
+TextureResidency *TextureResidency::Instance()
+{
+  if (_instance == nullptr)
+    _instance = new TextureResidency();
+  return _instance;
+}
+
+ResidentTexture const &TextureResidency::MakeResident(ORB_Texture *t)
+{
+  if (t == nullptr)
+    return _notResident;
+  auto exists = _resident.find(t);
+  if (exists != _resident.end())
+    return exists->second;
+
+  // Atlas sub textures live wherever their page does
+  if (t->Atlas() != nullptr)
+  {
+    ResidentTexture const page = MakeResident(t->Atlas());
+    if (page.layer == -1)
+      return _notResident;
+    glm::vec4 const &sub = t->UVRect();
+    ResidentTexture &r = _resident[t];
+    r.layer = page.layer;
+    r.uvRect = {glm::vec2(page.uvRect) + glm::vec2(sub) * glm::vec2(page.uvRect.z, page.uvRect.w),
+                glm::vec2(sub.z, sub.w) * glm::vec2(page.uvRect.z, page.uvRect.w)};
+    return r;
+  }
+
+  // Evicted and loading textures hold the 1x1 placeholder, the fallback binds it until FinishLoad
+  if (t->Ready() == false)
+    return _notResident;
+  // Textures are all loaded as RGBA8 but flagged with GL_RGBA32I, anything else can't be copied into the array
+  if (t->Format() != GL_RGBA32I || t->Width() > _pageSize || t->Height() > _pageSize)
+    return _notResident;
+
+  if (_array == 0)
+  {
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    _pageSize = std::min(_pageSize, static_cast<int>(maxSize));
+    Grow();
+  }
+
+  int layer = 0;
+  glm::ivec2 pos;
+  if (Allocate(std::min(t->Width() + padding, _pageSize), std::min(t->Height() + padding, _pageSize), layer, pos) == false)
+    return _notResident;
+
+  glCopyImageSubData(t->texture(), GL_TEXTURE_2D, 0, 0, 0, 0,
+                     _array, GL_TEXTURE_2D_ARRAY, 0, pos.x, pos.y, layer,
+                     t->Width(), t->Height(), 1);
+  ++_pages[layer].residents;
+  float const size = static_cast<float>(_pageSize);
+  ResidentTexture &r = _resident[t];
+  r.layer = layer;
+  r.uvRect = {pos.x / size, pos.y / size, t->Width() / size, t->Height() / size};
+  return r;
+}
+
+void TextureResidency::Evict(ORB_Texture *t)
+{
+  auto exists = _resident.find(t);
+  if (exists == _resident.end())
+    return;
+  if (t->Atlas() != nullptr)
+  {
+    _resident.erase(exists);
+    return;
+  }
+  std::erase_if(_resident, [t](auto const &r)
+                { return r.first->Atlas() == t; });
+  exists = _resident.find(t);
+  Page &p = _pages[exists->second.layer];
+  if (--p.residents == 0)
+  {
+    p.shelves.clear();
+    p.top = 0;
+  }
+  _resident.erase(exists);
+}
+
+void TextureResidency::Bind(int unit)
+{
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, _array);
+}
+
+bool TextureResidency::Allocate(int w, int h, int &layer, glm::ivec2 &pos)
+{
+  for (int i = 0; i < static_cast<int>(_pages.size()); ++i)
+  {
+    if (AllocateOnPage(_pages[i], w, h, pos))
+    {
+      layer = i;
+      return true;
+    }
+  }
+  GLint maxLayers = 0;
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+  if (_layers >= maxLayers)
+  {
+    Log(Warning, "Texture array is full, texture will be bound on its own");
+    return false;
+  }
+  layer = _layers;
+  Grow();
+  return AllocateOnPage(_pages[layer], w, h, pos);
+}
+
+bool TextureResidency::AllocateOnPage(Page &p, int w, int h, glm::ivec2 &pos)
+{
+  // Use the first shelf that is tall enough and has room left
+  for (auto &shelf : p.shelves)
+  {
+    if (shelf.height >= h && shelf.x + w <= _pageSize)
+    {
+      pos = {shelf.x, shelf.y};
+      shelf.x += w;
+      return true;
+    }
+  }
+  if (p.top + h > _pageSize)
+    return false;
+  p.shelves.push_back({.y = p.top, .height = h, .x = w});
+  pos = {0, p.top};
+  p.top += h;
+  return true;
+}
+
+void TextureResidency::Grow()
+{
+  GLint maxLayers = 0;
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+  int layers = std::min(std::max(initialLayers, _layers * 2), static_cast<int>(maxLayers));
+
+  GLuint newArray = 0;
+  glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &newArray);
+  glTextureStorage3D(newArray, 1, GL_RGBA8, _pageSize, _pageSize, layers);
+  glTextureParameteri(newArray, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTextureParameteri(newArray, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTextureParameteri(newArray, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTextureParameteri(newArray, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  if (_array != 0)
+  {
+    // Existing pages are copied on the GPU, nothing has to be re-uploaded
+    glCopyImageSubData(_array, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+                       newArray, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+                       _pageSize, _pageSize, _layers);
+    glDeleteTextures(1, &_array);
+  }
+  _array = newArray;
+  _layers = layers;
+  _pages.resize(layers);
+}
+
+TextureResidency::~TextureResidency()
+{
+  if (_array != 0)
+    glDeleteTextures(1, &_array);
+  _pages.clear();
+  _resident.clear();
+}
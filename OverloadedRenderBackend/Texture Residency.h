@@ -0,0 +1,95 @@
+/*********************************************************************
+ * @file   Texture Residency.h
+ * @brief  Packs textures into the pages of a texture array so the stored
+ * renderer can draw differently textured instances in a single draw
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#pragma once
+#include <glad.h>
+#include <glm.hpp>
+#include <vector>
+#include <unordered_map>
+typedef struct ORB_Texture ORB_Texture;
+
+/**@typedef
+ * @brief Where a texture lives inside the resident texture array.
+ *
+ * @details layer  - the array layer (page) the texture was packed into, -1 if not resident
+ *          uvRect - offset (xy) and scale (zw) to map the texture's 0-1 UVs into the page
+ */
+typedef struct ResidentTexture
+{
+  int layer = -1;
+  glm::vec4 uvRect = {0, 0, 1, 1};
+}ResidentTexture;
+
+class TextureResidency
+{
+public:
+
+  ~TextureResidency();
+  static TextureResidency* Instance();
+
+  /**
+   * @brief Get the location of a texture in the texture array, packing it if needed.
+   *
+   * @details Only RGBA textures that fit inside a page can be made resident, for any other
+   * texture the returned layer is -1 and the texture has to be bound on its own.
+   * @param t the texture
+   * @return where the texture lives
+   */
+  ResidentTexture const& MakeResident(ORB_Texture* t);
+  /**
+   * @brief Remove a texture from the texture array.
+   *
+   * @details The space is given back once every texture on its page has been evicted.
+   * @param t the texture
+   */
+  void Evict(ORB_Texture* t);
+  /**
+   * @brief Bind the texture array to a texture unit.
+   *
+   * @param unit the unit to bind to
+   */
+  void Bind(int unit);
+
+  int PageSize() const { return _pageSize; }
+  int Layers() const { return _layers; }
+
+private:
+  TextureResidency() = default;
+
+  TextureResidency(TextureResidency const&) = delete;
+  TextureResidency& operator=(TextureResidency const&) = delete;
+  TextureResidency(TextureResidency&&) = delete;
+
+  // A row of a page, textures are placed left to right along it
+  typedef struct Shelf
+  {
+    int y;
+    int height;
+    int x;
+  }Shelf;
+
+  typedef struct Page
+  {
+    std::vector<Shelf> shelves;
+    int top = 0;
+    int residents = 0;
+  }Page;
+
+  bool Allocate(int w, int h, int& layer, glm::ivec2& pos);
+  bool AllocateOnPage(Page& p, int w, int h, glm::ivec2& pos);
+  void Grow();
+
+  static inline TextureResidency* _instance = nullptr;
+
+  GLuint _array = 0;
+  int _layers = 0;
+  int _pageSize = 2048;
+  std::vector<Page> _pages;
+  std::unordered_map<ORB_Texture*, ResidentTexture> _resident;
+  const ResidentTexture _notResident = {};
+};
@@ -9,11 +9,34 @@
 #include "pch.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "Textures.h"
+#include "Texture Residency.h"
+#include "Upload Service.h"
+#include "Texture Container.h"
+#include "Stream.h"
+#include "Asset Pack.h"
 #include "stb_image.h"
+#include <cstring>
 #include <iostream>
 // #include <stacktrace>
 extern std::ofstream traceLog;
 
+// Plain RGBA8 containers get the same label as stb loads so they can still be packed into the texture array
+static GLenum ContainerFormat(TextureContainer const& c)
+{
+    return (c.format == GL_RGBA8 && c.pixelFormat == GL_RGBA) ? GL_RGBA32I : c.format;
+}
+
+// Decode an image to RGBA8 from the asset packs, or from disk if it isn't packed
+static unsigned char* LoadPixels(std::string const& filename, int* w, int* h)
+{
+    int channels = 0;
+    std::string_view packed;
+    std::vector<char> unpacked;
+    if (AssetPack::Instance()->Read(filename, packed, unpacked))
+        return stbi_load_from_memory(reinterpret_cast<stbi_uc const*>(packed.data()), static_cast<int>(packed.size()), w, h, &channels, 4);
+    return stbi_load(filename.c_str(), w, h, &channels, 4);
+}
+
 template <typename Arg, typename... vArgs>
 void TextureManager::Log(TraceLevels l, Arg&& arg1, vArgs&&... variadic)
 {
@@ -42,17 +65,14 @@ void TextureManager::Log(TraceLevels l, Arg&& arg1, vArgs&&... variadic)
 
 ORB_Texture* TextureManager::LoadTexture(std::string filename, bool KeepAlive)
 {
-    for (auto& t : _textures)
-    {
-        if (t->name() == filename)
-        {
-            t->_uses++;
-            return t;
-        }
-    }
-    int w, h, channels;
+    auto exists = _lookup.find(filename);
+    if (exists != _lookup.end())
+        return exists->second;
+    if (IsTextureContainer(filename))
+        return LoadContainer(filename, KeepAlive);
+    int w, h;
 
-    unsigned char* file = stbi_load(filename.c_str(), &w, &h, &channels, 4);
+    unsigned char* file = LoadPixels(filename, &w, &h);
     if (file == nullptr)
       return nullptr;
     GLuint texture = 0;
@@ -64,27 +84,365 @@ ORB_Texture* TextureManager::LoadTexture(std::string filename, bool KeepAlive)
     if (t == nullptr)
       return nullptr;
     t->name(filename);
+    t->_reloadable = true;
     _textures.push_back(t);
+    _lookup[filename] = t;
+    Track(t);
     stbi_image_free(file);
     return t;
 }
 
+ORB_Texture* TextureManager::LoadContainer(std::string filename, bool KeepAlive)
+{
+    TextureContainer c;
+    std::string error;
+    if (ReadTextureContainer(filename, c, error) == false)
+    {
+        Log(Error, "Could not load texture:", filename, error);
+        return nullptr;
+    }
+    ORB_Texture* t = new ORB_Texture(UploadTextureContainer(c), c.levels[0].w, c.levels[0].h, ContainerFormat(c), KeepAlive);
+    t->_levels = static_cast<int>(c.levels.size());
+    t->name(filename);
+    t->_reloadable = true;
+    _textures.push_back(t);
+    _lookup[filename] = t;
+    Track(t);
+    return t;
+}
+
 ORB_Texture* TextureManager::LoadTexture(const char* filename)
 {
     std::string s = std::string(filename);
     return LoadTexture(s);
 }
 
-ORB_Texture* TextureManager::CreateFromMemeory(std::string name, int w, int h, int depth, void* data)
+ORB_Texture* TextureManager::LoadTextureAsync(std::string filename, bool KeepAlive)
 {
-    for (auto& t : _textures)
+    auto exists = _lookup.find(filename);
+    if (exists != _lookup.end())
+        return exists->second;
+    ORB_Texture* t = new ORB_Texture(Placeholder(), 1, 1, GL_RGBA32I, KeepAlive);
+    t->name(filename);
+    t->_reloadable = true;
+    _textures.push_back(t);
+    _lookup[filename] = t;
+    QueueLoad(t);
+    return t;
+}
+
+ORB_Texture* TextureManager::LoadVirtualTexture(std::string filename)
+{
+    auto exists = _lookup.find(filename);
+    if (exists != _lookup.end())
+        return exists->second;
+    std::string error;
+    VirtualTexture* vt = VirtualTexture::Load(filename, error);
+    if (vt == nullptr)
+    {
+        Log(Error, "Could not load virtual texture:", filename, error);
+        return nullptr;
+    }
+    // Flagged as plain RGBA8 so it is never copied into the residency array
+    ORB_Texture* t = new ORB_Texture(vt->Fallback(), vt->Width(), vt->Height(), GL_RGBA8, true);
+    t->name(filename);
+    t->_virtual = vt;
+    _textures.push_back(t);
+    _lookup[filename] = t;
+    _virtualTextures.push_back(vt);
+    return t;
+}
+
+GLuint TextureManager::Placeholder()
+{
+    if (_placeholder == 0)
+    {
+        const unsigned char white[4] = {255, 255, 255, 255};
+        glCreateTextures(GL_TEXTURE_2D, 1, &_placeholder);
+        glTextureStorage2D(_placeholder, 1, GL_RGBA8, 1, 1);
+        glTextureSubImage2D(_placeholder, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    }
+    return _placeholder;
+}
+
+void TextureManager::QueueLoad(ORB_Texture* t)
+{
+    if (_workers.empty())
+        StartWorkers();
+    t->_ready = false;
+    t->_texture = Placeholder();
+
+    LoadJob& job = _jobs.emplace_back();
+    job.target = t;
+    job.filename = t->name();
+    {
+        std::lock_guard<std::mutex> lock(_jobLock);
+        _toDecode.push_back(&job);
+    }
+    _jobReady.notify_one();
+}
+
+void TextureManager::StartWorkers()
+{
+    // Leave a core for the render thread, decoding is bound by file IO past a few threads anyway
+    unsigned count = std::clamp(std::thread::hardware_concurrency(), 2u, 5u) - 1;
+    for (unsigned i = 0; i < count; ++i)
+        _workers.emplace_back(&TextureManager::DecodeWorker, this);
+}
+
+void TextureManager::DecodeWorker()
+{
+    while (true)
+    {
+        LoadJob* job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(_jobLock);
+            _jobReady.wait(lock, [this] { return _stopWorkers || _toDecode.empty() == false; });
+            if (_stopWorkers)
+                return;
+            job = _toDecode.front();
+            _toDecode.pop_front();
+        }
+        if (IsTextureContainer(job->filename))
+        {
+            std::string error;
+            if (ReadTextureContainer(job->filename, job->container, error))
+                job->w = job->container.levels[0].w, job->h = job->container.levels[0].h;
+            else
+                job->container = {};
+        }
+        else
+            job->pixels = LoadPixels(job->filename, &job->w, &job->h);
+        std::lock_guard<std::mutex> lock(_jobLock);
+        _decoded.push_back(job);
+    }
+}
+
+void TextureManager::StreamUploads(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(_jobLock);
+        _uploading.splice(_uploading.end(), _decoded);
+    }
+
+    // Drop cancelled loads and failed decodes before touching the GPU
+    std::erase_if(_uploading, [this](LoadJob* job)
+    {
+        if (job->target != nullptr && Decoded(job))
+            return false;
+        FinishLoad(job);
+        return true;
+    });
+    if (_uploading.empty())
+        return;
+
+    if (UploadService::Instance()->Available())
+    {
+        // The upload thread does not hold up the frame, so it takes whole images
+        for (LoadJob* job : _uploading)
+        {
+            UploadService::Instance()->Submit([job]
+            {
+                job->rowsUploaded = job->h;
+                if (job->container.levels.empty() == false)
+                {
+                    job->texture = UploadTextureContainer(job->container);
+                    return;
+                }
+                glCreateTextures(GL_TEXTURE_2D, 1, &job->texture);
+                glTextureStorage2D(job->texture, 1, GL_RGBA8, job->w, job->h);
+                glTextureParameteri(job->texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTextureSubImage2D(job->texture, 0, 0, 0, job->w, job->h, GL_RGBA, GL_UNSIGNED_BYTE, job->pixels);
+            }, [this, job] { FinishLoad(job); });
+        }
+        _uploading.clear();
+        return;
+    }
+
+    // Containers are already compressed and mipped, they go up whole
+    std::erase_if(_uploading, [this](LoadJob* job)
+    {
+        if (job->container.levels.empty())
+            return false;
+        job->texture = UploadTextureContainer(job->container);
+        FinishLoad(job);
+        return true;
+    });
+    if (_uploading.empty())
+        return;
+
+    // Always fit at least one row of the next texture, however small the budget is
+    const size_t firstRow = static_cast<size_t>(_uploading.front()->w) * 4;
+    const size_t size = std::max(_uploadBudget, firstRow);
+    if (_uploadBuffer == 0)
+        glCreateBuffers(1, &_uploadBuffer);
+    // Orphan the last frame's storage so mapping never waits on the GPU
+    glNamedBufferData(_uploadBuffer, size, nullptr, GL_STREAM_DRAW);
+    unsigned char* mapped = static_cast<unsigned char*>(
+        glMapNamedBufferRange(_uploadBuffer, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    if (mapped == nullptr)
+        return;
+
+    typedef struct Slice
+    {
+        LoadJob* job;
+        int firstRow, rows;
+        size_t offset;
+    }Slice;
+    std::vector<Slice> slices;
+    size_t used = 0;
+    for (LoadJob* job : _uploading)
+    {
+        const size_t rowSize = static_cast<size_t>(job->w) * 4;
+        const int rows = std::min(job->h - job->rowsUploaded, static_cast<int>((size - used) / rowSize));
+        if (rows <= 0)
+            break;
+        std::memcpy(mapped + used, job->pixels + rowSize * job->rowsUploaded, rowSize * rows);
+        slices.push_back({job, job->rowsUploaded, rows, used});
+        job->rowsUploaded += rows;
+        used += rowSize * rows;
+    }
+    glUnmapNamedBuffer(_uploadBuffer);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _uploadBuffer);
+    for (Slice const& s : slices)
+    {
+        LoadJob* job = s.job;
+        if (job->texture == 0)
+        {
+            glCreateTextures(GL_TEXTURE_2D, 1, &job->texture);
+            glTextureStorage2D(job->texture, 1, GL_RGBA8, job->w, job->h);
+            glTextureParameteri(job->texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        }
+        glTextureSubImage2D(job->texture, 0, 0, s.firstRow, job->w, s.rows, GL_RGBA, GL_UNSIGNED_BYTE,
+                            reinterpret_cast<void*>(s.offset));
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    std::erase_if(_uploading, [this](LoadJob* job)
+    {
+        if (job->rowsUploaded < job->h)
+            return false;
+        FinishLoad(job);
+        return true;
+    });
+}
+
+void TextureManager::FinishLoad(LoadJob* job)
+{
+    ORB_Texture* t = job->target;
+    if (t != nullptr && Decoded(job))
+    {
+        // Swap the finished texture in for the placeholder, which may have been packed into the texture array
+        TextureResidency::Instance()->Evict(t);
+        t->_texture = job->texture;
+        t->_w = job->w;
+        t->_h = job->h;
+        if (job->container.levels.empty() == false)
+        {
+            t->_format = ContainerFormat(job->container);
+            t->_levels = static_cast<int>(job->container.levels.size());
+        }
+        t->_ready = true;
+        Track(t);
+    }
+    else
     {
-        if (t->name() == name)
+        if (t != nullptr)
+            Log(Error, "Could not load texture:", job->filename);
+        if (job->texture != 0)
+            glDeleteTextures(1, &job->texture);
+    }
+    stbi_image_free(job->pixels);
+    _jobs.remove_if([job](LoadJob const& j) { return &j == job; });
+}
+
+void TextureManager::SetUploadBudget(size_t bytes)
+{
+    _uploadBudget = bytes;
+}
+
+void TextureManager::CancelLoad(ORB_Texture* t)
+{
+    if (t->_ready)
+        return;
+    // The job finishes decoding and is thrown away by StreamUploads
+    for (auto& job : _jobs)
+    {
+        if (job.target == t)
+            job.target = nullptr;
+    }
+}
+
+bool TextureManager::LoadAtlas(std::string filename)
+{
+    Stream file(filename);
+    if (file.Open() == false)
+    {
+        Log(Error, "Bad atlas path:", filename);
+        return false;
+    }
+    std::vector<ORB_Texture*> pages;
+    std::string token;
+    while (file.isEOF() != true)
+    {
+        token = makeLowerCase(file.readString());
+        if (token == "<pages>")
         {
-            t->_uses++;
-            return t;
+            while (true)
+            {
+                token = file.readString();
+                if (makeLowerCase(token) == "</pages>" || file.isEOF())
+                    break;
+                ORB_Texture* page = LoadTexture(token);
+                if (page == nullptr)
+                {
+                    Log(Error, "Could not load atlas page:", token);
+                    return false;
+                }
+                pages.push_back(page);
+            }
+        }
+        else if (token == "<textures>")
+        {
+            while (true)
+            {
+                // name[page]=x,y,w,h
+                token = file.readString();
+                if (makeLowerCase(token) == "</textures>" || file.isEOF())
+                    break;
+                const size_t brq = token.rfind('[');
+                std::string name = token.substr(0, brq);
+                token.erase(0, brq + 1);
+                ORB_Texture* page = pages.at(std::stoi(token));
+                token.erase(0, token.find('=') + 1);
+                int rect[4] = {};
+                for (int& r : rect)
+                {
+                    r = std::stoi(token);
+                    token.erase(0, token.find(',') + 1);
+                }
+
+                // The image is looked up through the page, which can be evicted and reloaded under a new name
+                ORB_Texture* t = new ORB_Texture(0, rect[2], rect[3], page->_format, true);
+                t->_atlas = page;
+                t->_uvRect = {rect[0] / static_cast<float>(page->_w), rect[1] / static_cast<float>(page->_h),
+                              rect[2] / static_cast<float>(page->_w), rect[3] / static_cast<float>(page->_h)};
+                t->name(name);
+                _textures.push_back(t);
+                _lookup[name] = t;
+            }
         }
     }
+    Log(Message, "Loaded atlas:", filename, "with", pages.size(), "pages");
+    return true;
+}
+
+ORB_Texture* TextureManager::CreateFromMemeory(std::string name, int w, int h, int depth, void* data)
+{
+    auto exists = _lookup.find(name);
+    if (exists != _lookup.end())
+        return exists->second;
     // CheckError(__LINE__);
     if (data == 0 || w == 0 || h == 0 || depth == 0)
         return nullptr;
@@ -110,36 +468,190 @@ ORB_Texture* TextureManager::CreateFromMemeory(std::string name, int w, int h, i
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     t->name(name);
     _textures.push_back(t);
+    _lookup[name] = t;
+    Track(t);
+    return t;
+}
+
+ORB_Texture* TextureManager::CreateDynamicTexture(std::string name, int w, int h)
+{
+    auto exists = _lookup.find(name);
+    if (exists != _lookup.end())
+        return exists->second;
+    if (w <= 0 || h <= 0)
+        return nullptr;
+    GLuint texture = 0;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, GL_RGBA8, w, h);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    // Flagged as plain RGBA8 so a stale copy never ends up in the residency array
+    ORB_Texture* t = new ORB_Texture(texture, w, h, GL_RGBA8, true);
+    t->_dynamic = new DynamicTexture(w, h);
+    t->name(name);
+    _textures.push_back(t);
+    _lookup[name] = t;
+    Track(t);
     return t;
 }
 
+bool TextureManager::UpdateTexture(ORB_Texture* t, int x, int y, int w, int h, int depth, void const* data)
+{
+    if (t == nullptr || t->_dynamic == nullptr || data == nullptr)
+        return false;
+    return t->_dynamic->Update(t->_texture, x, y, w, h, depth, data);
+}
+
 void TextureManager::DeleteTextureFromMemory(ORB_Texture* t)
 {
-    Image i = t->texture();
-    glDeleteTextures(1, &i);
+    std::erase(_textures, t);
+    ReleaseTexture(t);
+}
+
+void TextureManager::ReleaseTexture(ORB_Texture* t)
+{
+    TextureResidency::Instance()->Evict(t);
+    CancelLoad(t);
+    Untrack(t);
+    auto exists = _lookup.find(t->name());
+    if (exists != _lookup.end() && exists->second == t)
+        _lookup.erase(exists);
+    // Atlas sub textures share their page's image, pending loads share the placeholder
+    if (t->_virtual != nullptr)
+    {
+        // The fallback belongs to the virtual texture
+        std::erase(_virtualTextures, t->_virtual);
+        delete t->_virtual;
+    }
+    else if (t->_atlas == nullptr && t->_ready)
+        glDeleteTextures(1, &t->_texture);
+    delete t->_dynamic;
     delete t;
 }
 
 void TextureManager::Update(void)
 {
-    for (int i = 0; i < _textures.size(); ++i)
+    ++_frame;
+    // Walk up from the least recently used end until back in budget
+    auto it = _lru.end();
+    while (_stats.residentBytes > _stats.budget && it != _lru.begin())
     {
-        if (_textures[i]->_keepAlive == false && _textures[i]->_uses-- < -50)
-            DropTexture(_textures[i]);
+        --it;
+        ORB_Texture* t = *it;
+        // Everything from here up was drawn in the last frame and is likely still on screen
+        if (t->_lastUsed + 1 >= _frame)
+            break;
+        // Textures made in memory have nothing to reload from, and the caller still holds them
+        if (t->_keepAlive || t->_reloadable == false)
+            continue;
+        ++_stats.evictions;
+        _stats.evictedBytes += Bytes(t);
+        auto next = std::next(it);
+        Evict(t);
+        it = next;
     }
+    for (VirtualTexture* vt : _virtualTextures)
+        vt->Update(_frame);
+}
+
+void TextureManager::Touch(ORB_Texture* t)
+{
+    // Sub textures keep their atlas page alive
+    if (t->_atlas != nullptr)
+        t = t->_atlas;
+    t->_lastUsed = _frame;
+    if (t->_evicted)
+    {
+        t->_evicted = false;
+        ++_stats.reloads;
+        QueueLoad(t);
+    }
+    if (t->_tracked)
+        _lru.splice(_lru.begin(), _lru, t->_lruEntry);
+}
+
+void TextureManager::Pin(ORB_Texture* t, bool pinned)
+{
+    if (t == nullptr)
+        return;
+    if (t->_atlas != nullptr)
+        t = t->_atlas;
+    t->_keepAlive = pinned;
+}
+
+void TextureManager::SetBudget(size_t bytes)
+{
+    _stats.budget = bytes;
+}
+
+TextureStats const& TextureManager::Stats()
+{
+    _stats.residentTextures = static_cast<unsigned>(_lru.size());
+    _stats.pinnedTextures = static_cast<unsigned>(std::ranges::count_if(_lru, [](ORB_Texture* t) { return t->_keepAlive; }));
+    return _stats;
+}
+
+void TextureManager::Track(ORB_Texture* t)
+{
+    if (t->_tracked)
+        return;
+    t->_tracked = true;
+    t->_lastUsed = _frame;
+    t->_lruEntry = _lru.insert(_lru.begin(), t);
+    _stats.residentBytes += Bytes(t);
+}
+
+void TextureManager::Untrack(ORB_Texture* t)
+{
+    if (t->_tracked == false)
+        return;
+    t->_tracked = false;
+    _lru.erase(t->_lruEntry);
+    _stats.residentBytes -= Bytes(t);
+}
+
+void TextureManager::Evict(ORB_Texture* t)
+{
+    TextureResidency::Instance()->Evict(t);
+    Untrack(t);
+    glDeleteTextures(1, &t->_texture);
+    // The handle stays valid and keeps its size, Touch brings the pixels back
+    t->_texture = Placeholder();
+    t->_ready = false;
+    t->_evicted = true;
+}
+
+size_t TextureManager::Bytes(ORB_Texture const* t)
+{
+    if (t->_format == GL_RGB32I)
+        return static_cast<size_t>(t->_w) * t->_h * 3;
+    return TextureBytes(t->_format == GL_RGBA32I ? GL_RGBA8 : t->_format, t->_w, t->_h, t->_levels);
+}
+
+bool TextureManager::Decoded(LoadJob const* job)
+{
+    return job->pixels != nullptr || job->container.levels.empty() == false;
 }
 
 void TextureManager::DropTexture(ORB_Texture* ti)
 {
+    // Sub textures can't outlive the page they are drawn from
+    if (ti != nullptr && ti->_atlas == nullptr)
+    {
+        std::erase_if(_textures, [this, ti](ORB_Texture* t)
+        {
+            if (t->_atlas != ti)
+                return false;
+            ReleaseTexture(t);
+            return true;
+        });
+    }
     int idx = 0;
     for (auto& t : _textures)
     {
         if (t == ti)
         {
             Log(TraceLevels::High, "Dropped unused Texture: ", t->name());
-            Image im = t->texture();
-            glDeleteTextures(1, &im);
-            delete t;
+            ReleaseTexture(t);
             t = nullptr;
             _textures.erase(_textures.begin() + idx);
             break;
@@ -151,12 +663,9 @@ void TextureManager::DropTexture(ORB_Texture* ti)
 void TextureManager::DropAll(void)
 {
     for (auto& texture : _textures)
-    {
-        Image im = texture->texture();
-        glDeleteTextures(1, &im);
-        delete texture;
-    }
+        ReleaseTexture(texture);
     _textures.clear();
+    _lookup.clear();
 }
 
 std::vector<ORB_Texture*> const& TextureManager::GetTextures() const
@@ -181,6 +690,24 @@ TextureManager::TextureManager()
 TextureManager::~TextureManager()
 {
     DropAll();
+    {
+        std::lock_guard<std::mutex> lock(_jobLock);
+        _stopWorkers = true;
+    }
+    _jobReady.notify_all();
+    for (auto& worker : _workers)
+        worker.join();
+    for (auto& job : _jobs)
+    {
+        stbi_image_free(job.pixels);
+        if (job.texture != 0)
+            glDeleteTextures(1, &job.texture);
+    }
+    _jobs.clear();
+    if (_placeholder != 0)
+        glDeleteTextures(1, &_placeholder);
+    if (_uploadBuffer != 0)
+        glDeleteBuffers(1, &_uploadBuffer);
 }
 
 void TextureManager::checkError()
@@ -197,7 +724,8 @@ void TextureManager::checkError()
 
 Image const ORB_Texture::texture() const
 {
-  const_cast<ORB_Texture*>(this)->IncramentUses();
+    if (_atlas != nullptr)
+        return _atlas->_texture;
     return _texture;
 }
 
@@ -226,22 +754,46 @@ GLenum ORB_Texture::Format() const
     return _format;
 }
 
-void ORB_Texture::IncramentUses()
+bool ORB_Texture::Ready() const
+{
+    if (_atlas != nullptr)
+        return _atlas->_ready;
+    return _ready;
+}
+
+ORB_Texture* ORB_Texture::Atlas() const
+{
+    return _atlas;
+}
+
+glm::vec4 const& ORB_Texture::UVRect() const
 {
-    ++_uses;
+    return _uvRect;
+}
+
+VirtualTexture* ORB_Texture::Virtual() const
+{
+    return _virtual;
+}
+
+unsigned long long ORB_Texture::LastUsed() const
+{
+    return _lastUsed;
 }
 
 void ORB_Texture::SetSampleMode(int mode)
 {
-  glBindTexture(GL_TEXTURE_2D, _texture);
+  glBindTexture(GL_TEXTURE_2D, texture());
+  // Keep sampling the mip chain if there is one
+  const bool mipped = _levels > 1;
   switch (mode) 
   {
   case 0:
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     break;
   case 1:
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipped ? GL_NEAREST_MIPMAP_LINEAR : GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     break;
   }
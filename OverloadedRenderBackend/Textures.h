@@ -9,7 +9,16 @@
 #pragma once
 #include "ShaderLog.hpp"
 #include "glad.h"
+#include "Texture Container.h"
+#include "Virtual Texture.h"
+#include "Dynamic Texture.h"
+#include <glm.hpp>
+#include <condition_variable>
+#include <list>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 typedef GLuint Image;
 
@@ -25,7 +34,7 @@ public:
      * @param he the height of the texture
      */
     ORB_Texture(Image te, int wi, int he, GLenum format, bool keepAlive)
-        : _texture(te), _w(wi), _h(he), _uses(0),  _keepAlive(keepAlive), _format(format)
+        : _texture(te), _w(wi), _h(he), _keepAlive(keepAlive), _format(format)
     {
     }
     /**
@@ -62,21 +71,85 @@ public:
     GLenum Format() const;
 
     /**
-     * @brief Increase the uses count for the texture
+     * @brief Get the last frame the texture was drawn with.
      *
+     * @return the frame number
      */
-    void IncramentUses();
+    unsigned long long LastUsed() const;
 
     void SetSampleMode(int mode);
 
+    /**
+     * @brief Get the atlas page this texture lives on.
+     *
+     * @return the page, nullptr if this texture is not part of an atlas
+     */
+    ORB_Texture* Atlas() const;
+    /**
+     * @brief Get where this texture lives on its atlas page.
+     *
+     * @return offset (xy) and scale (zw) of the texture in the page's UV space
+     */
+    glm::vec4 const& UVRect() const;
+    /**
+     * @brief Check if the texture's pixels are on the GPU.
+     *
+     * @details Textures from LoadTextureAsync show a placeholder and report a
+     * size of 1x1 until this is true.
+     * @return if the texture is loaded
+     */
+    bool Ready() const;
+    /**
+     * @brief Get the streamed texture behind a texture from LoadVirtualTexture.
+     *
+     * @details texture() of a virtual texture is its coarsest level, for shaders that
+     * can't sample the page cache.
+     * @return the virtual texture, nullptr for regular textures
+     */
+    VirtualTexture* Virtual() const;
+
 private:
     std::string _name;
     Image _texture;
-    int _w, _h, _uses;
+    int _w, _h;
     bool _keepAlive;
     GLenum _format;
+    ORB_Texture* _atlas = nullptr;
+    glm::vec4 _uvRect = {0, 0, 1, 1};
+    bool _ready = true;
+    int _levels = 1;
+    VirtualTexture* _virtual = nullptr;
+    DynamicTexture* _dynamic = nullptr;
+    // Residency bookkeeping, see TextureManager::Touch
+    bool _reloadable = false;
+    bool _evicted = false;
+    bool _tracked = false;
+    unsigned long long _lastUsed = 0;
+    std::list<ORB_Texture*>::iterator _lruEntry;
 } Texture;
 
+/**@typedef
+ * @brief GPU memory use of the textures the TextureManager owns.
+ *
+ * @details budget           - bytes the manager tries to stay under
+ *          residentBytes    - bytes of texture data currently on the GPU
+ *          residentTextures - textures currently on the GPU
+ *          pinnedTextures   - resident textures that are never evicted
+ *          evictions        - textures evicted to stay in budget
+ *          evictedBytes     - bytes freed by those evictions
+ *          reloads          - evicted textures that were used again and reloaded
+ */
+typedef struct TextureStats
+{
+    size_t budget = 0;
+    size_t residentBytes = 0;
+    unsigned residentTextures = 0;
+    unsigned pinnedTextures = 0;
+    unsigned long long evictions = 0;
+    unsigned long long evictedBytes = 0;
+    unsigned long long reloads = 0;
+}TextureStats;
+
 class TextureManager
 {
 public:
@@ -84,10 +157,12 @@ public:
     /**
      * @brief .Load a texture
      *
+     * @details .ktx2 and .dds files are uploaded with their mip chain and block compression as is
      * @param filename std::string of filename
+     * @param KeepAlive true to never evict it, see Pin
      * @return the loaded texture
      */
-    ORB_Texture* LoadTexture(std::string filename, bool KeepAlive = true);
+    ORB_Texture* LoadTexture(std::string filename, bool KeepAlive = false);
     /**
      * @brief Load a texutre.
      *
@@ -95,6 +170,49 @@ public:
      * @return the loaded texutre
      */
     ORB_Texture* LoadTexture(const char* filename);
+    /**
+     * @brief Load a texture without blocking the render thread.
+     *
+     * @details The file is decoded on a worker thread and uploaded in slices by
+     * StreamUploads. The returned texture can be used straight away, it draws
+     * a placeholder until Ready() is true.
+     * @param filename std::string of filename
+     * @param KeepAlive true to never evict it, see Pin
+     * @return the texture
+     */
+    ORB_Texture* LoadTextureAsync(std::string filename, bool KeepAlive = false);
+    /**
+     * @brief Upload decoded async textures.
+     *
+     * @details Whole textures go to the upload thread when it is available, otherwise
+     * at most the upload budget is uploaded per call.
+     *
+     */
+    void StreamUploads(void);
+    /**
+     * @brief Set how many bytes StreamUploads may upload per call.
+     *
+     * @param bytes the budget
+     */
+    void SetUploadBudget(size_t bytes);
+    /**
+     * @brief Load an atlas manifest made by the AtlasPacker.
+     *
+     * @details After this, loading any texture that was packed into the atlas
+     * returns a sub texture of the atlas page instead of loading the file.
+     * @param filename the .atlas.meta manifest
+     * @return if the atlas was loaded
+     */
+    bool LoadAtlas(std::string filename);
+    /**
+     * @brief Open a .vtex file made by the VirtualTextureBuilder.
+     *
+     * @details Only the coarsest level is loaded, the tiles the default shader samples are
+     * streamed in by Update. Virtual textures are never evicted, their page cache has a fixed size.
+     * @param filename the .vtex file
+     * @return the texture, nullptr on failure
+     */
+    ORB_Texture* LoadVirtualTexture(std::string filename);
     /**
      * @brief Create a texture from program memory.
      *
@@ -115,13 +233,68 @@ public:
      */
     void DeleteTextureFromMemory(ORB_Texture* t);
     /**
-     * @brief Upate the manager
+     * @brief Create an RGBA8 texture meant to be rewritten every frame.
+     *
+     * @details The storage is immutable and updates go through UpdateTexture, which
+     * never waits on the GPU. Dynamic textures are never evicted.
+     * @param name the texture name
+     * @param w the width of the texture
+     * @param h the height of the texture
+     * @return the texture
+     */
+    ORB_Texture* CreateDynamicTexture(std::string name, int w, int h);
+    /**
+     * @brief Write new pixels into part of a dynamic texture.
      *
+     * @param t the texture, made with CreateDynamicTexture
+     * @param x the left of the rect
+     * @param y the top of the rect
+     * @param w the width of the rect
+     * @param h the height of the rect
+     * @param depth 3 for RGB or 4 for RGBA data
+     * @param data w * h tightly packed pixels
+     * @return if the update was queued, false if it was invalid or dropped
+     * because the GPU was still reading every buffer
+     */
+    bool UpdateTexture(ORB_Texture* t, int x, int y, int w, int h, int depth, void const* data);
+    /**
+     * @brief Advance a frame and evict least recently used textures until the manager is back in budget.
+     *
+     * @details Textures drawn this frame or last frame, pinned textures and textures made in
+     * memory are never evicted. Only the GPU copy of a texture loaded from a file is freed, its
+     * handle stays valid and it is reloaded in the background when it is next drawn. Virtual
+     * textures stream their tiles here.
      */
     void Update(void);
+    /**
+     * @brief Keep a texture on the GPU whatever the budget, or let it be evicted again.
+     *
+     * @param t the texture, sub textures pin their atlas page
+     * @param pinned true to never evict it
+     */
+    void Pin(ORB_Texture* t, bool pinned);
+    /**
+     * @brief Mark a texture as drawn this frame.
+     *
+     * @param t the texture
+     */
+    void Touch(ORB_Texture* t);
+    /**
+     * @brief Set how many bytes of texture data may stay on the GPU.
+     *
+     * @param bytes the budget
+     */
+    void SetBudget(size_t bytes);
+    /**
+     * @brief Get the residency stats.
+     *
+     * @return the stats
+     */
+    TextureStats const& Stats();
     /**
      * @brief Delete a texture.
      *
+     * @details Deleting an atlas page deletes every sub texture on it too.
      * @param t the texture to delete
      */
     void DropTexture(ORB_Texture* t);
@@ -154,7 +327,54 @@ private:
    */
   ~TextureManager();
     void checkError();
+    void ReleaseTexture(ORB_Texture* t);
+    void CancelLoad(ORB_Texture* t);
+    void StartWorkers();
+    void DecodeWorker();
+
+    // An async load, owned by the render thread. Workers only touch filename, pixels, w and h
+    typedef struct LoadJob
+    {
+        ORB_Texture* target;
+        std::string filename;
+        unsigned char* pixels = nullptr;
+        int w = 0, h = 0;
+        int rowsUploaded = 0;
+        GLuint texture = 0;
+        // Filled instead of pixels for .ktx2 and .dds files
+        TextureContainer container;
+    }LoadJob;
+
+    void FinishLoad(LoadJob* job);
+    ORB_Texture* LoadContainer(std::string filename, bool KeepAlive);
+    static bool Decoded(LoadJob const* job);
+    void QueueLoad(ORB_Texture* t);
+    GLuint Placeholder();
+    void Track(ORB_Texture* t);
+    void Untrack(ORB_Texture* t);
+    void Evict(ORB_Texture* t);
+    static size_t Bytes(ORB_Texture const* t);
+
     std::vector<ORB_Texture*> _textures;
+    std::unordered_map<std::string, ORB_Texture*> _lookup;
     static inline TextureManager* _instance;
+
+    std::list<LoadJob> _jobs;
+    std::list<LoadJob*> _toDecode;
+    std::list<LoadJob*> _decoded;
+    std::list<LoadJob*> _uploading;
+    std::vector<std::thread> _workers;
+    std::mutex _jobLock;
+    std::condition_variable _jobReady;
+    bool _stopWorkers = false;
+    GLuint _placeholder = 0;
+    GLuint _uploadBuffer = 0;
+    size_t _uploadBudget = 4 << 20;
+
+    // Most recently used at the front
+    std::list<ORB_Texture*> _lru;
+    std::vector<VirtualTexture*> _virtualTextures;
+    unsigned long long _frame = 1;
+    TextureStats _stats = {.budget = size_t(512) << 20};
 };
 
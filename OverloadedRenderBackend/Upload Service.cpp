@@ -0,0 +1,154 @@
+#include "pch.h"
+#include "Upload Service.h"
+#include "ShaderLog.hpp"
+
+UploadService *UploadService::Instance()
+{
+  if (_instance == nullptr)
+    _instance = new UploadService();
+  return _instance;
+}
+
+bool UploadService::Available()
+{
+  if (_tried == false)
+  {
+    _tried = true;
+    if (Start() == false)
+      Log(Warning, "Could not make the upload context, uploads will run on the render thread");
+  }
+  return _context != nullptr;
+}
+
+bool UploadService::Start()
+{
+  SDL_Window *primary = SDL_GL_GetCurrentWindow();
+  SDL_GLContext primaryContext = SDL_GL_GetCurrentContext();
+  if (primary == nullptr || primaryContext == nullptr)
+    return false;
+
+  // The context needs a drawable of its own, a window can't be current on two threads
+  _window = SDL_CreateWindow("ORB Upload", 0, 0, 1, 1, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+  if (_window == nullptr)
+    return false;
+  SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+  _context = SDL_GL_CreateContext(_window);
+  SDL_GL_MakeCurrent(primary, primaryContext);
+  if (_context == nullptr)
+  {
+    SDL_DestroyWindow(_window);
+    _window = nullptr;
+    return false;
+  }
+  _thread = std::thread(&UploadService::Run, this);
+  return true;
+}
+
+void UploadService::Run()
+{
+  SDL_GL_MakeCurrent(_window, _context);
+  while (true)
+  {
+    _queued.wait(0);
+    if (_stop)
+      break;
+    UploadBatch *batch = new UploadBatch();
+    while (UploadJob **job = _jobs.Front())
+    {
+      UploadJob *j = *job;
+      _jobs.Pop();
+      j->upload();
+      batch->jobs.push_back(j);
+    }
+    _queued.fetch_sub(static_cast<unsigned>(batch->jobs.size()));
+    // A job counted but not pushed yet, wait for it rather than fencing nothing
+    if (batch->jobs.empty())
+    {
+      delete batch;
+      std::this_thread::yield();
+      continue;
+    }
+    batch->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Without a flush the fence may never reach the GPU and the render thread would wait forever
+    glFlush();
+    while (_batches.Push(batch) == false && _stop == false)
+      std::this_thread::yield();
+  }
+  SDL_GL_MakeCurrent(_window, nullptr);
+}
+
+unsigned long long UploadService::Submit(std::function<void()> upload, std::function<void()> ready)
+{
+  const unsigned long long ticket = ++_submitted;
+  if (Available() == false)
+  {
+    upload();
+    if (ready)
+      ready();
+    _completed = ticket;
+    return ticket;
+  }
+  // Objects the render thread just made have to reach the driver before the other context can use them
+  glFlush();
+  UploadJob *job = new UploadJob{std::move(upload), std::move(ready), ticket};
+  // Counted before the push so the upload thread never takes off a job it hasn't been told about
+  _queued.fetch_add(1);
+  while (_jobs.Push(job) == false)
+    std::this_thread::yield();
+  _queued.notify_one();
+  return ticket;
+}
+
+bool UploadService::Done(unsigned long long ticket) const
+{
+  return ticket <= _completed;
+}
+
+void UploadService::Poll()
+{
+  // Batches are fenced in order, stop at the first one the GPU has not finished
+  while (UploadBatch **front = _batches.Front())
+  {
+    UploadBatch *batch = *front;
+    if (glClientWaitSync(batch->fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+      break;
+    _batches.Pop();
+    glDeleteSync(batch->fence);
+    for (UploadJob *job : batch->jobs)
+    {
+      if (job->ready)
+        job->ready();
+      _completed = job->ticket;
+      delete job;
+    }
+    delete batch;
+  }
+}
+
+UploadService::~UploadService()
+{
+  if (_thread.joinable())
+  {
+    _stop = true;
+    _queued.fetch_add(1);
+    _queued.notify_one();
+    _thread.join();
+  }
+  while (UploadJob **job = _jobs.Front())
+  {
+    delete *job;
+    _jobs.Pop();
+  }
+  while (UploadBatch **batch = _batches.Front())
+  {
+    glDeleteSync((*batch)->fence);
+    for (UploadJob *job : (*batch)->jobs)
+      delete job;
+    delete *batch;
+    _batches.Pop();
+  }
+  if (_context != nullptr)
+    SDL_GL_DeleteContext(_context);
+  if (_window != nullptr)
+    SDL_DestroyWindow(_window);
+}
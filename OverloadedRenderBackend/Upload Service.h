@@ -0,0 +1,126 @@
+/*********************************************************************
+ * @file   Upload Service.h
+ * @brief  Background thread with its own shared GL context that runs
+ * uploads while the render thread keeps drawing
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#pragma once
+#include <glad.h>
+#include <SDL.h>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Single producer single consumer ring, push from one thread and pop from one other.
+ */
+template <typename T, size_t N>
+class SpscRing
+{
+  static_assert((N & (N - 1)) == 0, "SpscRing size must be a power of two");
+public:
+  bool Push(T const& v)
+  {
+    const size_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) == N)
+      return false;
+    _items[head & (N - 1)] = v;
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+  // The oldest item, nullptr when empty
+  T* Front()
+  {
+    const size_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire))
+      return nullptr;
+    return &_items[tail & (N - 1)];
+  }
+  void Pop() { _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+private:
+  std::array<T, N> _items = {};
+  alignas(64) std::atomic<size_t> _head = 0;
+  alignas(64) std::atomic<size_t> _tail = 0;
+};
+
+class UploadService
+{
+public:
+
+  ~UploadService();
+  static UploadService* Instance();
+
+  /**
+   * @brief Queue GL work for the upload thread.
+   *
+   * @details Anything the upload function reads must be owned by it, the caller may free its
+   * data as soon as this returns. Buffers and textures are shared with the render thread's
+   * context, vertex arrays and framebuffers are not and must not be made in the upload function.
+   * If the upload context could not be made the work runs right away on the calling thread.
+   * Must be called from the render thread.
+   * @param upload the GL work, runs on the upload thread
+   * @param ready called on the render thread once the GPU has finished the upload, can be empty
+   * @return a ticket to pass to Done
+   */
+  unsigned long long Submit(std::function<void()> upload, std::function<void()> ready = nullptr);
+  /**
+   * @brief Check if an upload has finished and its resources are safe to use.
+   *
+   * @param ticket the ticket from Submit
+   * @return if the upload has finished
+   */
+  bool Done(unsigned long long ticket) const;
+  /**
+   * @brief Retire finished batches and run their ready callbacks, call once a frame on the render thread.
+   *
+   */
+  void Poll();
+  /**
+   * @brief Check if uploads go through the upload thread, starting it if needed.
+   *
+   * @return false if the shared context could not be made
+   */
+  bool Available();
+
+private:
+  UploadService() = default;
+
+  UploadService(UploadService const&) = delete;
+  UploadService& operator=(UploadService const&) = delete;
+  UploadService(UploadService&&) = delete;
+
+  typedef struct UploadJob
+  {
+    std::function<void()> upload;
+    std::function<void()> ready;
+    unsigned long long ticket;
+  }UploadJob;
+
+  // Everything the upload thread ran between two fences
+  typedef struct UploadBatch
+  {
+    GLsync fence;
+    std::vector<UploadJob*> jobs;
+  }UploadBatch;
+
+  bool Start();
+  void Run();
+
+  static inline UploadService* _instance = nullptr;
+
+  SpscRing<UploadJob*, 1024> _jobs;
+  SpscRing<UploadBatch*, 256> _batches;
+  std::atomic<unsigned> _queued = 0;
+  std::atomic<bool> _stop = false;
+  std::thread _thread;
+  SDL_Window* _window = nullptr;
+  SDL_GLContext _context = nullptr;
+  bool _tried = false;
+  unsigned long long _submitted = 0;
+  unsigned long long _completed = 0;
+};
@@ -0,0 +1,359 @@
+#include "pch.h"
+#include "Virtual Texture.h"
+#include "ShaderLog.hpp"
+#include <cstring>
+
+// .vtex header, followed by every tile of every level, finest level first, rows top to bottom
+typedef struct VTexHeader
+{
+  char magic[4];
+  unsigned version;
+  unsigned width, height;
+  unsigned tileSize, border;
+  unsigned levels;
+  unsigned reserved;
+}VTexHeader;
+static_assert(sizeof(VTexHeader) == 32, "VTexHeader must match the VirtualTextureBuilder");
+
+VirtualTexture* VirtualTexture::Load(std::string const& filename, std::string& error)
+{
+  std::ifstream file(filename, std::ios::binary);
+  VTexHeader header = {};
+  if (file.read(reinterpret_cast<char*>(&header), sizeof(header)).good() == false)
+    return error = "could not read header", nullptr;
+  if (std::memcmp(header.magic, "ORBV", 4) != 0 || header.version != 1)
+    return error = "not a version 1 .vtex file", nullptr;
+
+  VirtualTexture* vt = new VirtualTexture();
+  vt->_path = filename;
+  vt->_width = header.width;
+  vt->_height = header.height;
+  vt->_tileSize = header.tileSize;
+  vt->_border = header.border;
+  vt->_pageSize = header.tileSize + header.border * 2;
+  vt->_headerSize = sizeof(header);
+  for (int l = 0;; ++l)
+  {
+    const int span = vt->_tileSize << l;
+    glm::ivec2 tiles = {(vt->_width + span - 1) / span, (vt->_height + span - 1) / span};
+    vt->_levelFirst.push_back(vt->_totalTiles);
+    vt->_levelTiles.push_back(tiles);
+    vt->_totalTiles += tiles.x * tiles.y;
+    if (tiles.x == 1 && tiles.y == 1)
+      break;
+  }
+  vt->_levels = static_cast<int>(vt->_levelTiles.size());
+  if (vt->_levels != static_cast<int>(header.levels))
+  {
+    delete vt;
+    return error = "level count does not match the size", nullptr;
+  }
+
+  const int cacheSize = vt->_pageSize * pagesPerSide;
+  glCreateTextures(GL_TEXTURE_2D, 1, &vt->_cache);
+  glTextureStorage2D(vt->_cache, 1, GL_RGBA8, cacheSize, cacheSize);
+  glTextureParameteri(vt->_cache, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTextureParameteri(vt->_cache, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTextureParameteri(vt->_cache, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTextureParameteri(vt->_cache, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  // One texel per level 0 tile, a power of two so every mip has exactly one texel per tile of that level
+  const int indirectionSize = std::bit_ceil(static_cast<unsigned>(std::max(vt->_levelTiles[0].x, vt->_levelTiles[0].y)));
+  glCreateTextures(GL_TEXTURE_2D, 1, &vt->_indirection);
+  glTextureStorage2D(vt->_indirection, vt->_levels, GL_RGBA8UI, indirectionSize, indirectionSize);
+  for (int l = 0; l < vt->_levels; ++l)
+  {
+    const int size = std::max(indirectionSize >> l, 1);
+    vt->_entries.emplace_back(static_cast<size_t>(size) * size, Entry{0, 0, static_cast<unsigned char>(vt->_levels - 1), 255});
+  }
+  vt->_dirty.assign(vt->_levels, true);
+
+  for (GLuint& buffer : vt->_feedback)
+  {
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, sizeof(unsigned) * vt->_totalTiles, nullptr, GL_DYNAMIC_STORAGE_BIT);
+    glClearNamedBufferData(buffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+  }
+
+  vt->_pages.resize(pagesPerSide * pagesPerSide);
+  vt->_pageOf.assign(vt->_totalTiles, -1);
+  vt->_requested.assign(vt->_totalTiles, false);
+
+  // The coarsest level is the fallback for everything and never leaves the cache
+  const int top = vt->_totalTiles - 1;
+  std::vector<unsigned char> pixels;
+  if (vt->ReadTile(file, top, pixels) == false)
+  {
+    delete vt;
+    return error = "file is truncated", nullptr;
+  }
+  vt->Map(top, 0, pixels.data());
+
+  const glm::ivec2 content = {std::max(vt->_width >> (vt->_levels - 1), 1), std::max(vt->_height >> (vt->_levels - 1), 1)};
+  glCreateTextures(GL_TEXTURE_2D, 1, &vt->_fallback);
+  glTextureStorage2D(vt->_fallback, 1, GL_RGBA8, content.x, content.y);
+  glTextureParameteri(vt->_fallback, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, vt->_pageSize);
+  glTextureSubImage2D(vt->_fallback, 0, 0, 0, content.x, content.y, GL_RGBA, GL_UNSIGNED_BYTE,
+                      pixels.data() + (static_cast<size_t>(vt->_border) * vt->_pageSize + vt->_border) * 4);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+  vt->_loader = std::thread(&VirtualTexture::LoaderWorker, vt);
+  return vt;
+}
+
+glm::ivec3 VirtualTexture::Tile(int tile) const
+{
+  int l = _levels - 1;
+  while (_levelFirst[l] > tile)
+    --l;
+  const int i = tile - _levelFirst[l];
+  return {i % _levelTiles[l].x, i / _levelTiles[l].x, l};
+}
+
+int VirtualTexture::TileIndex(int level, int x, int y) const
+{
+  return _levelFirst[level] + y * _levelTiles[level].x + x;
+}
+
+bool VirtualTexture::ReadTile(std::ifstream& file, int tile, std::vector<unsigned char>& out) const
+{
+  const size_t bytes = static_cast<size_t>(_pageSize) * _pageSize * 4;
+  out.resize(bytes);
+  file.seekg(_headerSize + bytes * tile);
+  return file.read(reinterpret_cast<char*>(out.data()), bytes).good();
+}
+
+void VirtualTexture::Map(int tile, int page, unsigned char const* pixels)
+{
+  glTextureSubImage2D(_cache, 0, (page % pagesPerSide) * _pageSize, (page / pagesPerSide) * _pageSize,
+                      _pageSize, _pageSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  _pages[page].tile = tile;
+  _pageOf[tile] = page;
+
+  // Point every finer texel under this tile that uses a coarser tile at this one
+  const glm::ivec3 t = Tile(tile);
+  const Entry e = {static_cast<unsigned char>(page % pagesPerSide), static_cast<unsigned char>(page / pagesPerSide),
+                   static_cast<unsigned char>(t.z), 255};
+  for (int k = t.z; k >= 0; --k)
+  {
+    const int size = static_cast<int>(std::sqrt(_entries[k].size()));
+    const int scale = 1 << (t.z - k);
+    for (int y = t.y * scale; y < std::min((t.y + 1) * scale, size); ++y)
+    {
+      for (int x = t.x * scale; x < std::min((t.x + 1) * scale, size); ++x)
+      {
+        Entry& entry = _entries[k][static_cast<size_t>(y) * size + x];
+        if (entry[2] >= t.z)
+          entry = e;
+      }
+    }
+    _dirty[k] = true;
+  }
+}
+
+void VirtualTexture::Unmap(int page)
+{
+  const int tile = _pages[page].tile;
+  const glm::ivec3 t = Tile(tile);
+  _pages[page].tile = -1;
+  _pageOf[tile] = -1;
+  _requested[tile] = false;
+
+  // Hand the area back to whatever the parent texel already falls back to
+  const int parentSize = static_cast<int>(std::sqrt(_entries[t.z + 1].size()));
+  const Entry parent = _entries[t.z + 1][static_cast<size_t>(t.y / 2) * parentSize + t.x / 2];
+  for (int k = t.z; k >= 0; --k)
+  {
+    const int size = static_cast<int>(std::sqrt(_entries[k].size()));
+    const int scale = 1 << (t.z - k);
+    for (int y = t.y * scale; y < std::min((t.y + 1) * scale, size); ++y)
+    {
+      for (int x = t.x * scale; x < std::min((t.x + 1) * scale, size); ++x)
+      {
+        Entry& entry = _entries[k][static_cast<size_t>(y) * size + x];
+        if (entry[2] == t.z)
+          entry = parent;
+      }
+    }
+    _dirty[k] = true;
+  }
+}
+
+int VirtualTexture::FindPage(unsigned long long frame) const
+{
+  int best = -1;
+  for (int i = 0; i < static_cast<int>(_pages.size()); ++i)
+  {
+    Page const& p = _pages[i];
+    if (p.tile == -1)
+      return i;
+    // Keep the coarsest level and anything drawn in the last frame
+    if (p.tile == _totalTiles - 1 || p.lastUsed + 1 >= frame)
+      continue;
+    if (best == -1 || p.lastUsed < _pages[best].lastUsed)
+      best = i;
+  }
+  return best;
+}
+
+void VirtualTexture::Update(unsigned long long frame)
+{
+  // The shader's writes to the feedback buffer are incoherent, make them visible to the read next
+  // frame before fencing so waiting on the fence covers the barrier too
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+  _fence[_current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  _current ^= 1;
+
+  // The other buffer was written a frame ago, only read it once the GPU is done with it
+  std::vector<unsigned> coverage;
+  if (_fence[_current] != nullptr && glClientWaitSync(_fence[_current], 0, 0) != GL_TIMEOUT_EXPIRED)
+  {
+    coverage.resize(_totalTiles);
+    glGetNamedBufferSubData(_feedback[_current], 0, sizeof(unsigned) * _totalTiles, coverage.data());
+  }
+  if (_fence[_current] != nullptr)
+    glDeleteSync(_fence[_current]);
+  _fence[_current] = nullptr;
+  glClearNamedBufferData(_feedback[_current], GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+  std::vector<std::pair<unsigned, int>> wanted;
+  for (int tile = 0; tile < static_cast<int>(coverage.size()); ++tile)
+  {
+    if (coverage[tile] == 0)
+      continue;
+    if (_pageOf[tile] == -1)
+    {
+      if (_requested[tile] == false)
+        wanted.push_back({coverage[tile], tile});
+    }
+    // Parents are what the tile falls back to, keep them around as well
+    for (glm::ivec3 t = Tile(tile); t.z < _levels; ++t.z, t.x /= 2, t.y /= 2)
+    {
+      const int page = _pageOf[TileIndex(t.z, t.x, t.y)];
+      if (page != -1)
+        _pages[page].lastUsed = frame;
+    }
+  }
+
+  // Tiles covering the most pixels go first
+  std::sort(wanted.begin(), wanted.end(), std::greater<>());
+  if (coverage.empty() == false)
+  {
+    std::lock_guard<std::mutex> lock(_lock);
+    for (int tile : _queue)
+      _requested[tile] = false;
+    _queue.clear();
+    for (size_t i = 0; i < std::min(wanted.size(), size_t(maxRequests)); ++i)
+    {
+      _queue.push_back(wanted[i].second);
+      _requested[wanted[i].second] = true;
+    }
+  }
+  _wake.notify_one();
+
+  std::deque<TileLoad> loaded;
+  {
+    std::lock_guard<std::mutex> lock(_lock);
+    for (int i = 0; i < maxUploadsPerFrame && _loaded.empty() == false; ++i)
+    {
+      loaded.push_back(std::move(_loaded.front()));
+      _loaded.pop_front();
+    }
+  }
+  for (TileLoad& l : loaded)
+  {
+    if (_pageOf[l.tile] != -1)
+      continue;
+    const int page = FindPage(frame);
+    // Everything in the cache is on screen, the tile will be asked for again
+    if (page == -1)
+    {
+      _requested[l.tile] = false;
+      continue;
+    }
+    if (_pages[page].tile != -1)
+      Unmap(page);
+    Map(l.tile, page, l.pixels.data());
+    _pages[page].lastUsed = frame;
+  }
+
+  for (int l = 0; l < _levels; ++l)
+  {
+    if (_dirty[l] == false)
+      continue;
+    const int size = static_cast<int>(std::sqrt(_entries[l].size()));
+    glTextureSubImage2D(_indirection, l, 0, 0, size, size, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, _entries[l].data());
+    _dirty[l] = false;
+  }
+}
+
+void VirtualTexture::LoaderWorker()
+{
+  std::ifstream file(_path, std::ios::binary);
+  while (true)
+  {
+    int tile = 0;
+    {
+      std::unique_lock<std::mutex> lock(_lock);
+      _wake.wait(lock, [this] { return _stop || _queue.empty() == false; });
+      if (_stop)
+        return;
+      tile = _queue.front();
+      _queue.pop_front();
+    }
+    TileLoad l = {tile, {}};
+    if (ReadTile(file, tile, l.pixels) == false)
+    {
+      Log(Error, "Could not read virtual texture tile", tile, "of", _path);
+      file.clear();
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(_lock);
+    _loaded.push_back(std::move(l));
+  }
+}
+
+void VirtualTexture::Bind(int cacheUnit, int indirectionUnit, int feedbackBase) const
+{
+  glBindTextureUnit(cacheUnit, _cache);
+  glBindTextureUnit(indirectionUnit, _indirection);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, feedbackBase, _feedback[_current]);
+}
+
+glm::vec4 VirtualTexture::Info() const
+{
+  return glm::vec4(_width, _height, _levels, 0);
+}
+
+glm::vec4 VirtualTexture::PageInfo() const
+{
+  return glm::vec4(_tileSize, _border, _pageSize, _pageSize * pagesPerSide);
+}
+
+int VirtualTexture::ResidentPages() const
+{
+  return static_cast<int>(std::ranges::count_if(_pages, [](Page const& p) { return p.tile != -1; }));
+}
+
+VirtualTexture::~VirtualTexture()
+{
+  if (_loader.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(_lock);
+      _stop = true;
+    }
+    _wake.notify_all();
+    _loader.join();
+  }
+  for (GLsync fence : _fence)
+  {
+    if (fence != nullptr)
+      glDeleteSync(fence);
+  }
+  glDeleteBuffers(2, _feedback);
+  glDeleteTextures(1, &_cache);
+  glDeleteTextures(1, &_indirection);
+  glDeleteTextures(1, &_fallback);
+}
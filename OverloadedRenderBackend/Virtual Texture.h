@@ -0,0 +1,130 @@
+/*********************************************************************
+ * @file   Virtual Texture.h
+ * @brief  Streams tiles of textures too big to load at once into a
+ * fixed size page cache, driven by what the last frames drew
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#pragma once
+#include <glad.h>
+#include <glm.hpp>
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A .vtex file made by the VirtualTextureBuilder.
+ *
+ * @details The file holds a mip pyramid cut into square tiles, each stored with a border of
+ * its neighbours' pixels so the page cache can be filtered. Tiles the frame needs are found
+ * by the fragment shader, which counts a sample of the pixels that want each tile into a
+ * feedback buffer. Every frame the busiest missing tiles are read on a loader thread and
+ * copied into free or least recently used pages of the cache, and the indirection texture
+ * is pointed at them. Until a tile arrives its pixels use the closest resident parent, the
+ * coarsest level is always resident.
+ */
+class VirtualTexture
+{
+public:
+
+  ~VirtualTexture();
+  /**
+   * @brief Open a .vtex file and make the coarsest level resident.
+   *
+   * @param filename the file
+   * @param error why the file could not be opened
+   * @return the virtual texture, nullptr on failure
+   */
+  static VirtualTexture* Load(std::string const& filename, std::string& error);
+  /**
+   * @brief Read back the feedback of the last frame and stream tiles, call once at the end of a frame.
+   *
+   * @param frame the current frame
+   */
+  void Update(unsigned long long frame);
+  /**
+   * @brief Bind the page cache, indirection texture and feedback buffer.
+   *
+   * @param cacheUnit texture unit for the page cache
+   * @param indirectionUnit texture unit for the indirection texture
+   * @param feedbackBase shader storage binding for the feedback buffer
+   */
+  void Bind(int cacheUnit, int indirectionUnit, int feedbackBase) const;
+
+  // The coarsest level on its own, for shaders that can't sample the cache
+  GLuint Fallback() const { return _fallback; }
+  int Width() const { return _width; }
+  int Height() const { return _height; }
+  // x, y - size in pixels, z - levels
+  glm::vec4 Info() const;
+  // x - tile size, y - border, z - page size, w - cache size
+  glm::vec4 PageInfo() const;
+  int ResidentPages() const;
+
+private:
+  VirtualTexture() = default;
+
+  VirtualTexture(VirtualTexture const&) = delete;
+  VirtualTexture& operator=(VirtualTexture const&) = delete;
+
+  typedef struct Page
+  {
+    int tile = -1;
+    unsigned long long lastUsed = 0;
+  }Page;
+
+  typedef struct TileLoad
+  {
+    int tile;
+    std::vector<unsigned char> pixels;
+  }TileLoad;
+
+  typedef std::array<unsigned char, 4> Entry;
+
+  glm::ivec3 Tile(int tile) const;
+  int TileIndex(int level, int x, int y) const;
+  void Map(int tile, int page, unsigned char const* pixels);
+  void Unmap(int page);
+  int FindPage(unsigned long long frame) const;
+  void LoaderWorker();
+  bool ReadTile(std::ifstream& file, int tile, std::vector<unsigned char>& out) const;
+
+  static constexpr int pagesPerSide = 16;
+  static constexpr int maxUploadsPerFrame = 8;
+  static constexpr int maxRequests = 32;
+
+  std::string _path;
+  int _width = 0, _height = 0;
+  int _tileSize = 0, _border = 0, _pageSize = 0;
+  int _levels = 0;
+  size_t _headerSize = 0;
+  std::vector<glm::ivec2> _levelTiles;
+  std::vector<int> _levelFirst;
+  int _totalTiles = 0;
+
+  GLuint _cache = 0;
+  GLuint _indirection = 0;
+  GLuint _fallback = 0;
+  GLuint _feedback[2] = {};
+  GLsync _fence[2] = {};
+  int _current = 0;
+
+  std::vector<Page> _pages;
+  std::vector<int> _pageOf;
+  std::vector<bool> _requested;
+  std::vector<std::vector<Entry>> _entries;
+  std::vector<bool> _dirty;
+
+  std::thread _loader;
+  std::mutex _lock;
+  std::condition_variable _wake;
+  std::deque<int> _queue;
+  std::deque<TileLoad> _loaded;
+  bool _stop = false;
+};
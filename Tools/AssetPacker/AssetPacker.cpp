@@ -0,0 +1,316 @@
+/*********************************************************************
+ * @file   AssetPacker.cpp
+ * @brief  Packs asset files into one .orbpack for orb::MountAssetPack
+ *
+ * @details Layout, all little endian:
+ *   PackHeader
+ *   entry data, each entry 16 byte aligned, stored or an LZ4 block
+ *   PackEntry index, sorted by the FNV-1a hash of the path
+ *   paths, null terminated
+ * Paths are stored relative to the root with '/' separators and in lower
+ * case, the same form AssetPack looks them up in.
+ *
+ * usage: AssetPacker [-c] [-r root] <output.orbpack> <files or folders...>
+ *        AssetPacker -l <pack.orbpack>
+ *        -c  LZ4 compress entries, kept only where it makes them smaller
+ *        -r  directory the stored paths are relative to, the working directory by default
+ *        -l  list what a pack holds
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Must match PackHeader and PackEntry in Asset Pack.cpp
+typedef struct PackHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t count;
+  uint32_t reserved;
+  uint64_t indexOffset;
+  uint64_t namesOffset;
+}PackHeader;
+
+typedef struct PackEntry
+{
+  uint64_t hash;
+  uint64_t offset;
+  uint64_t packedSize;
+  uint64_t size;
+  uint32_t nameOffset;
+  uint32_t flags;
+}PackEntry;
+
+static_assert(sizeof(PackHeader) == 32 && sizeof(PackEntry) == 40, "pack layout changed");
+
+constexpr uint32_t packVersion = 1;
+constexpr uint32_t entryLZ4 = 1 << 0;
+constexpr size_t dataAlignment = 16;
+
+typedef struct File
+{
+  std::filesystem::path source;
+  std::string name;
+  uint64_t hash;
+}File;
+
+static uint64_t HashPath(std::string const& name)
+{
+  uint64_t h = 14695981039346656037ull;
+  for (char c : name)
+    h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+  return h;
+}
+
+static std::string Normalize(std::string path)
+{
+  std::replace(path.begin(), path.end(), '\\', '/');
+  path = std::filesystem::path(path).lexically_normal().generic_string();
+  while (path.starts_with("./"))
+    path.erase(0, 2);
+  std::transform(path.begin(), path.end(), path.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  return path;
+}
+
+static void WriteLength(std::vector<unsigned char>& out, size_t length)
+{
+  for (; length >= 255; length -= 255)
+    out.push_back(255);
+  out.push_back(static_cast<unsigned char>(length));
+}
+
+static void WriteSequence(std::vector<unsigned char>& out, unsigned char const* literals, size_t literalCount, size_t offset, size_t match)
+{
+  const size_t matchCode = match != 0 ? match - 4 : 0;
+  out.push_back(static_cast<unsigned char>((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(matchCode, 15)));
+  if (literalCount >= 15)
+    WriteLength(out, literalCount - 15);
+  out.insert(out.end(), literals, literals + literalCount);
+  if (match == 0)
+    return;
+  out.push_back(static_cast<unsigned char>(offset & 0xFF));
+  out.push_back(static_cast<unsigned char>(offset >> 8));
+  if (matchCode >= 15)
+    WriteLength(out, matchCode - 15);
+}
+
+// Greedy LZ4 block compression, favours a small simple encoder over ratio
+static std::vector<unsigned char> CompressLZ4(std::vector<unsigned char> const& in)
+{
+  // The format wants the last 5 bytes as literals and no match starting in the last 12
+  constexpr size_t lastLiterals = 5;
+  constexpr size_t matchStartLimit = 12;
+  constexpr uint32_t none = UINT32_MAX;
+  const size_t n = in.size();
+  unsigned char const* src = in.data();
+  std::vector<unsigned char> out;
+  out.reserve(n + n / 255 + 16);
+  size_t anchor = 0;
+  if (n > matchStartLimit)
+  {
+    std::vector<uint32_t> table(1 << 16, none);
+    auto read32 = [src](size_t at)
+    {
+      uint32_t v;
+      std::memcpy(&v, src + at, 4);
+      return v;
+    };
+    const size_t matchEnd = n - lastLiterals;
+    for (size_t at = 0; at <= n - matchStartLimit;)
+    {
+      const uint32_t v = read32(at);
+      const uint32_t h = (v * 2654435761u) >> 16;
+      const uint32_t ref = table[h];
+      table[h] = static_cast<uint32_t>(at);
+      if (ref == none || at - ref > 0xFFFF || read32(ref) != v)
+      {
+        ++at;
+        continue;
+      }
+      size_t match = 4;
+      while (at + match < matchEnd && src[ref + match] == src[at + match])
+        ++match;
+      WriteSequence(out, src + anchor, at - anchor, at - ref, match);
+      at += match;
+      anchor = at;
+    }
+  }
+  WriteSequence(out, src + anchor, n - anchor, 0, 0);
+  return out;
+}
+
+static bool ReadFile(std::filesystem::path const& p, std::vector<unsigned char>& out)
+{
+  std::ifstream file(p, std::ios::binary | std::ios::ate);
+  if (file.is_open() == false)
+    return false;
+  out.resize(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(out.data()), out.size());
+  return file.good() || out.empty();
+}
+
+static void Pad(std::ofstream& out, uint64_t& at, size_t alignment)
+{
+  static const char zeros[dataAlignment] = {};
+  const size_t pad = (alignment - at % alignment) % alignment;
+  out.write(zeros, pad);
+  at += pad;
+}
+
+static int List(std::string const& path)
+{
+  std::vector<unsigned char> pack;
+  PackHeader header = {};
+  if (ReadFile(path, pack) == false || pack.size() < sizeof(PackHeader))
+    return std::cerr << path << ": error: could not read pack" << std::endl, 1;
+  std::memcpy(&header, pack.data(), sizeof(PackHeader));
+  if (std::memcmp(header.magic, "ORBA", 4) != 0 || header.version != packVersion ||
+      header.indexOffset + header.count * sizeof(PackEntry) > pack.size() || header.namesOffset > pack.size())
+    return std::cerr << path << ": error: not an asset pack or a different version" << std::endl, 1;
+  uint64_t size = 0, packed = 0;
+  for (uint32_t i = 0; i < header.count; ++i)
+  {
+    PackEntry e;
+    std::memcpy(&e, pack.data() + header.indexOffset + i * sizeof(PackEntry), sizeof(PackEntry));
+    const char* name = reinterpret_cast<const char*>(pack.data() + header.namesOffset + e.nameOffset);
+    std::cout << ((e.flags & entryLZ4) != 0 ? "lz4    " : "stored ") << e.size << " -> " << e.packedSize << "  " << name << std::endl;
+    size += e.size;
+    packed += e.packedSize;
+  }
+  std::cout << header.count << " files, " << size << " bytes in " << packed << std::endl;
+  return 0;
+}
+
+static void Usage()
+{
+  std::cout << "usage: AssetPacker [-c] [-r root] <output.orbpack> <files or folders...>" << std::endl;
+  std::cout << "       AssetPacker -l <pack.orbpack>" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  bool compress = false;
+  std::string root = ".", output;
+  std::vector<std::string> inputs;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+      return List(argv[i + 1]);
+    if (std::strcmp(argv[i], "-c") == 0)
+      compress = true;
+    else if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+      root = argv[++i];
+    else if (output.empty())
+      output = argv[i];
+    else
+      inputs.push_back(argv[i]);
+  }
+  if (output.empty() || inputs.empty())
+    return Usage(), 1;
+
+  namespace fs = std::filesystem;
+  const fs::path rootPath = fs::absolute(root).lexically_normal();
+  const fs::path outputPath = fs::absolute(output).lexically_normal();
+  std::vector<File> files;
+  auto add = [&](fs::path const& p)
+  {
+    // Don't pack an old copy of the pack into itself
+    const fs::path full = fs::absolute(p).lexically_normal();
+    if (full == outputPath)
+      return;
+    File f;
+    f.source = p;
+    f.name = Normalize(full.lexically_relative(rootPath).generic_string());
+    if (f.name.empty() || f.name.starts_with(".."))
+    {
+      std::cerr << p.string() << ": error: not inside the root " << rootPath.string() << std::endl;
+      std::exit(1);
+    }
+    f.hash = HashPath(f.name);
+    files.push_back(f);
+  };
+  for (std::string const& in : inputs)
+  {
+    std::error_code error;
+    if (fs::is_directory(in, error))
+    {
+      for (fs::directory_entry const& e : fs::recursive_directory_iterator(in))
+      {
+        if (e.is_regular_file())
+          add(e.path());
+      }
+    }
+    else if (fs::is_regular_file(in, error))
+      add(in);
+    else
+      return std::cerr << in << ": error: no such file or folder" << std::endl, 1;
+  }
+  std::sort(files.begin(), files.end(), [](File const& a, File const& b) { return a.hash != b.hash ? a.hash < b.hash : a.name < b.name; });
+  for (size_t i = 1; i < files.size(); ++i)
+  {
+    if (files[i].name == files[i - 1].name)
+    {
+      std::cerr << files[i].source.string() << ": error: packs to the same path as " << files[i - 1].source.string() << std::endl;
+      return 1;
+    }
+  }
+
+  std::ofstream out(output, std::ios::binary | std::ios::trunc);
+  if (out.is_open() == false)
+    return std::cerr << output << ": error: could not open output" << std::endl, 1;
+  PackHeader header = {{'O', 'R', 'B', 'A'}, packVersion, static_cast<uint32_t>(files.size()), 0, 0, 0};
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  uint64_t at = sizeof(header);
+
+  std::vector<PackEntry> index;
+  std::string names;
+  uint64_t size = 0;
+  std::vector<unsigned char> data;
+  for (File const& f : files)
+  {
+    if (ReadFile(f.source, data) == false)
+      return std::cerr << f.source.string() << ": error: could not read file" << std::endl, 1;
+    PackEntry e = {f.hash, 0, data.size(), data.size(), static_cast<uint32_t>(names.size()), 0};
+    names += f.name;
+    names += '\0';
+    Pad(out, at, dataAlignment);
+    e.offset = at;
+    std::vector<unsigned char> packed;
+    if (compress && data.empty() == false)
+      packed = CompressLZ4(data);
+    if (packed.empty() == false && packed.size() < data.size())
+    {
+      e.flags |= entryLZ4;
+      e.packedSize = packed.size();
+      out.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+    }
+    else
+      out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    at += e.packedSize;
+    size += e.size;
+    index.push_back(e);
+  }
+  Pad(out, at, alignof(PackEntry));
+  header.indexOffset = at;
+  out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(PackEntry));
+  at += index.size() * sizeof(PackEntry);
+  header.namesOffset = at;
+  out.write(names.data(), names.size());
+  at += names.size();
+  out.seekp(0);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  if (out.good() == false)
+    return std::cerr << output << ": error: could not write output" << std::endl, 1;
+
+  std::cout << "Packed " << files.size() << " files, " << size << " bytes into " << at << std::endl;
+  return 0;
+}
@@ -0,0 +1,226 @@
+/*********************************************************************
+ * @file   AtlasPacker.cpp
+ * @brief  Offline texture atlas packer
+ *
+ * @details Packs images into atlas pages using MaxRects (best short side fit)
+ * and writes a .atlas.meta manifest mapping each original file name to the page
+ * and pixel rect it was placed at. Load the manifest with orb::LoadAtlas and
+ * LoadTexture will hand out sub textures of the pages for the original names.
+ *
+ * usage: AtlasPacker [-s pageSize] [-p padding] <output> <images or folders...>
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image.h"
+#include "stb_image_write.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+typedef struct Rect
+{
+  int x, y, w, h;
+}Rect;
+
+typedef struct Image
+{
+  std::string name;
+  int w = 0, h = 0;
+  unsigned char* pixels = nullptr;
+  int page = -1;
+  Rect rect = {};
+}Image;
+
+// MaxRects bin, keeps a list of maximal free rectangles and places each new
+// rectangle where it leaves the shortest leftover side
+class MaxRects
+{
+public:
+  MaxRects(int w, int h) : _free{ {0, 0, w, h} } {}
+
+  bool Insert(int w, int h, Rect& out)
+  {
+    int bestShort = INT_MAX, bestLong = INT_MAX;
+    for (Rect const& f : _free)
+    {
+      if (f.w < w || f.h < h)
+        continue;
+      int leftW = f.w - w, leftH = f.h - h;
+      int shortSide = std::min(leftW, leftH), longSide = std::max(leftW, leftH);
+      if (shortSide < bestShort || (shortSide == bestShort && longSide < bestLong))
+      {
+        out = {f.x, f.y, w, h};
+        bestShort = shortSide;
+        bestLong = longSide;
+      }
+    }
+    if (bestShort == INT_MAX)
+      return false;
+    Place(out);
+    return true;
+  }
+
+private:
+  void Place(Rect const& used)
+  {
+    std::vector<Rect> next;
+    for (Rect const& f : _free)
+    {
+      if (used.x >= f.x + f.w || used.x + used.w <= f.x || used.y >= f.y + f.h || used.y + used.h <= f.y)
+      {
+        next.push_back(f);
+        continue;
+      }
+      // Split the free rect into up to four maximal rects around the used one
+      if (used.x > f.x)
+        next.push_back({f.x, f.y, used.x - f.x, f.h});
+      if (used.x + used.w < f.x + f.w)
+        next.push_back({used.x + used.w, f.y, f.x + f.w - (used.x + used.w), f.h});
+      if (used.y > f.y)
+        next.push_back({f.x, f.y, f.w, used.y - f.y});
+      if (used.y + used.h < f.y + f.h)
+        next.push_back({f.x, used.y + used.h, f.w, f.y + f.h - (used.y + used.h)});
+    }
+    // Drop any free rect fully contained in another
+    auto contains = [](Rect const& a, Rect const& b)
+    { return b.x >= a.x && b.y >= a.y && b.x + b.w <= a.x + a.w && b.y + b.h <= a.y + a.h; };
+    _free.clear();
+    for (size_t i = 0; i < next.size(); ++i)
+    {
+      bool contained = false;
+      for (size_t j = 0; j < next.size() && contained == false; ++j)
+      {
+        if (i == j)
+          continue;
+        contained = contains(next[j], next[i]) && (contains(next[i], next[j]) == false || j < i);
+      }
+      if (contained == false)
+        _free.push_back(next[i]);
+    }
+  }
+
+  std::vector<Rect> _free;
+};
+
+static void Usage()
+{
+  std::cout << "usage: AtlasPacker [-s pageSize] [-p padding] <output> <images or folders...>" << std::endl;
+}
+
+static void Gather(std::filesystem::path const& p, std::vector<std::string>& files)
+{
+  if (std::filesystem::is_directory(p))
+  {
+    for (auto const& entry : std::filesystem::recursive_directory_iterator(p))
+    {
+      if (entry.is_regular_file() && entry.path().extension() == ".png")
+        files.push_back(entry.path().generic_string());
+    }
+    return;
+  }
+  files.push_back(p.generic_string());
+}
+
+int main(int argc, char** argv)
+{
+  int pageSize = 2048;
+  int padding = 2;
+  std::string output;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+      pageSize = std::stoi(argv[++i]);
+    else if (std::strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+      padding = std::stoi(argv[++i]);
+    else if (output.empty())
+      output = argv[i];
+    else
+      Gather(argv[i], files);
+  }
+  if (output.empty() || files.empty())
+  {
+    Usage();
+    return 1;
+  }
+
+  std::vector<Image> images;
+  for (auto const& f : files)
+  {
+    Image im;
+    int channels = 0;
+    im.name = f;
+    im.pixels = stbi_load(f.c_str(), &im.w, &im.h, &channels, 4);
+    if (im.pixels == nullptr)
+    {
+      std::cerr << "ORB ERROR: Could not load " << f << std::endl;
+      return 1;
+    }
+    if (im.w + padding > pageSize || im.h + padding > pageSize)
+    {
+      std::cerr << "ORB ERROR: " << f << " does not fit in a " << pageSize << " page" << std::endl;
+      return 1;
+    }
+    images.push_back(im);
+  }
+
+  // Placing the biggest images first packs tighter
+  std::vector<Image*> order;
+  for (auto& im : images)
+    order.push_back(&im);
+  std::sort(order.begin(), order.end(), [](Image* a, Image* b)
+            { return std::max(a->w, a->h) > std::max(b->w, b->h); });
+
+  std::vector<MaxRects> pages;
+  for (Image* im : order)
+  {
+    for (int p = 0; im->page == -1; ++p)
+    {
+      if (p == static_cast<int>(pages.size()))
+        pages.emplace_back(pageSize, pageSize);
+      Rect r;
+      if (pages[p].Insert(im->w + padding, im->h + padding, r))
+      {
+        im->page = p;
+        im->rect = {r.x, r.y, im->w, im->h};
+      }
+    }
+  }
+
+  std::ofstream manifest(output + ".atlas.meta");
+  manifest << "<Atlas>\n  <Pages>\n";
+  for (size_t p = 0; p < pages.size(); ++p)
+  {
+    std::vector<unsigned char> pixels(static_cast<size_t>(pageSize) * pageSize * 4, 0);
+    for (auto const& im : images)
+    {
+      if (im.page != static_cast<int>(p))
+        continue;
+      for (int y = 0; y < im.h; ++y)
+        std::memcpy(&pixels[(static_cast<size_t>(im.rect.y + y) * pageSize + im.rect.x) * 4],
+                    &im.pixels[static_cast<size_t>(y) * im.w * 4], static_cast<size_t>(im.w) * 4);
+    }
+    std::string page = output + std::to_string(p) + ".png";
+    stbi_write_png(page.c_str(), pageSize, pageSize, 4, pixels.data(), pageSize * 4);
+    manifest << "    " << page << "\n";
+  }
+  manifest << "  </Pages>\n  <Textures>\n";
+  for (auto const& im : images)
+  {
+    manifest << "    " << im.name << "[" << im.page << "]=" << im.rect.x << "," << im.rect.y << ","
+             << im.rect.w << "," << im.rect.h << "\n";
+    stbi_image_free(im.pixels);
+  }
+  manifest << "  </Textures>\n</Atlas>\n";
+
+  std::cout << "Packed " << images.size() << " images into " << pages.size() << " pages" << std::endl;
+  return 0;
+}
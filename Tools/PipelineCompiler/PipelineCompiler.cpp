@@ -0,0 +1,601 @@
+/*********************************************************************
+ * @file   PipelineCompiler.cpp
+ * @brief  Compiles a .rpass.meta and the stage .meta files it names
+ * into constexpr descriptor tables
+ *
+ * @details Reads the files the same way RenderPass and ShaderStage do at
+ * runtime, but stricter: unknown sections, malformed entries, bad buffer
+ * types, unknown variants, duplicate names and missing shader files are
+ * errors here instead of surprises at startup. The output is a .inc of
+ * Compiled Pipeline.h tables with the shader sources embedded and the
+ * FNV-1a hash of every name, for orb::LoadCompiledRenderPass.
+ *
+ * usage: PipelineCompiler [-r root] [-d depfile] <pass.rpass.meta> <output.inc>
+ *        -r  directory the paths inside the .meta files are relative to, the working directory by default
+ *        -d  write a make style depfile listing every file read
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#include "../../OverloadedRenderBackend/Compiled Pipeline.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Must match shaderStages and shaderVariant in ShaderStage.h
+constexpr long stageVertex = 1 << 0;
+constexpr long stageFragment = 1 << 1;
+constexpr long stageCompute = 1 << 2;
+constexpr unsigned variantTextured = 1 << 0;
+constexpr unsigned variantLighting = 1 << 1;
+// Must match resourceAccess in RenderPass.h
+constexpr unsigned accessRead = 1 << 0;
+constexpr unsigned accessWrite = 1 << 1;
+// GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_COMPUTE_SHADER
+constexpr unsigned glVertexShader = 0x8B31;
+constexpr unsigned glFragmentShader = 0x8B30;
+constexpr unsigned glComputeShader = 0x91B9;
+// Number of entries in bufferTypes and renderStage
+constexpr int bufferTypeCount = 13;
+constexpr int renderStageCount = 6;
+
+static std::vector<std::string> inputs;
+
+static std::string Lower(std::string s)
+{
+  std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  return s;
+}
+
+// Whitespace separated tokens with the line they came from, like Stream::readString
+class Reader
+{
+public:
+  Reader(std::filesystem::path const& p) : _path(p.string())
+  {
+    std::ifstream file(p, std::ios::binary);
+    if (file.is_open() == false)
+    {
+      std::cerr << _path << ": error: could not open file" << std::endl;
+      std::exit(1);
+    }
+    inputs.push_back(_path);
+    std::stringstream s;
+    s << file.rdbuf();
+    _text = s.str();
+  }
+
+  bool Next(std::string& token)
+  {
+    while (_at < _text.size() && std::isspace(static_cast<unsigned char>(_text[_at])))
+    {
+      if (_text[_at] == '\n')
+        ++_line;
+      ++_at;
+    }
+    if (_at == _text.size())
+      return false;
+    const size_t start = _at;
+    while (_at < _text.size() && std::isspace(static_cast<unsigned char>(_text[_at])) == false)
+      ++_at;
+    token = _text.substr(start, _at - start);
+    _tokenLine = _line;
+    return true;
+  }
+
+  // The next token, a missing one is an error
+  std::string Expect(const char* what)
+  {
+    std::string token;
+    if (Next(token) == false)
+      Fail(std::string("expected ") + what + " before the end of the file");
+    return token;
+  }
+
+  [[noreturn]] void Fail(std::string const& message) const
+  {
+    Fail(message, _tokenLine);
+  }
+
+  [[noreturn]] void Fail(std::string const& message, int line) const
+  {
+    std::cerr << _path << "(" << line << "): error: " << message << std::endl;
+    std::exit(1);
+  }
+
+  std::string const& Path() const { return _path; }
+  // Line of the last token
+  int Line() const { return _tokenLine; }
+
+private:
+  std::string _path;
+  std::string _text;
+  size_t _at = 0;
+  int _line = 1, _tokenLine = 1;
+};
+
+typedef struct Attribute
+{
+  std::string name;
+  unsigned location;
+  unsigned long long size;
+}Attribute;
+
+typedef struct Buffer
+{
+  std::string name;
+  int type;
+}Buffer;
+
+typedef struct Source
+{
+  unsigned type;
+  std::string text;
+}Source;
+
+typedef struct Stage
+{
+  std::string name;
+  int stage;
+  unsigned id;
+  long activeShaders = 0;
+  unsigned variants = 0;
+  std::vector<Source> sources;
+  std::vector<Attribute> inputs, uniforms;
+  std::vector<Buffer> buffers;
+}Stage;
+
+typedef struct FBO
+{
+  std::string name;
+  // Everything but the name and hash, which are written from name
+  ORB_CompiledFBO desc;
+}FBO;
+
+typedef struct Resource
+{
+  std::string stage;
+  std::string resource;
+  unsigned access;
+  int line;
+}Resource;
+
+static int ParseInt(Reader const& r, std::string const& text, std::string const& entry)
+{
+  if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos)
+    r.Fail("'" + entry + "' needs a number where it has '" + text + "'");
+  return std::stoi(text);
+}
+
+// name[inside] followed by the rest
+static void SplitEntry(Reader const& r, std::string const& entry, std::string& name, std::string& inside, std::string& rest)
+{
+  const size_t open = entry.find('['), close = entry.find(']');
+  if (open == std::string::npos || close == std::string::npos || open == 0 || close < open)
+    r.Fail("'" + entry + "' should look like name[...]");
+  name = entry.substr(0, open);
+  inside = entry.substr(open + 1, close - open - 1);
+  rest = entry.substr(close + 1);
+}
+
+template <typename T>
+static void CheckUnique(Reader const& r, std::vector<T> const& list, std::string const& name, const char* what)
+{
+  for (T const& t : list)
+  {
+    if (t.name == name)
+      r.Fail(std::string(what) + " '" + name + "' is declared twice");
+    if (ORB_HashName(t.name) == ORB_HashName(name))
+      r.Fail(std::string(what) + " '" + name + "' has the same hash as '" + t.name + "'");
+  }
+}
+
+static std::string LoadSource(Reader const& r, std::filesystem::path const& root, std::string const& file)
+{
+  const std::filesystem::path p = (root / file).lexically_normal();
+  std::ifstream in(p, std::ios::binary);
+  if (in.is_open() == false)
+    r.Fail("could not open shader '" + p.string() + "'");
+  inputs.push_back(p.string());
+  std::stringstream s;
+  s << in.rdbuf();
+  return s.str();
+}
+
+static void ReadBuffers(Reader& r, std::vector<Buffer>& buffers)
+{
+  for (std::string token = r.Expect("</buffers>"); Lower(token) != "</buffers>"; token = r.Expect("</buffers>"))
+  {
+    std::string name, inside, rest;
+    SplitEntry(r, token, name, inside, rest);
+    const int type = ParseInt(r, inside, token);
+    if (type >= bufferTypeCount)
+      r.Fail("buffer '" + name + "' has type " + inside + ", types go from 0 to " + std::to_string(bufferTypeCount - 1));
+    CheckUnique(r, buffers, name, "buffer");
+    buffers.push_back({name, type});
+  }
+}
+
+static void ReadStage(std::filesystem::path const& root, std::filesystem::path const& meta, Stage& stage)
+{
+  Reader r((root / meta).lexically_normal());
+  std::string token;
+  while (r.Next(token))
+  {
+    const std::string section = Lower(token);
+    if (section == "<vertex>" || section == "<fragment>" || section == "<compute>")
+    {
+      const bool compute = section == "<compute>";
+      if (compute && (stage.activeShaders & (stageVertex | stageFragment)) != 0)
+        r.Fail("a compute shader can't be in a graphics stage");
+      if (compute == false && (stage.activeShaders & stageCompute) != 0)
+        r.Fail("a graphics shader can't be in a compute stage");
+      const long bit = compute ? stageCompute : section == "<vertex>" ? stageVertex : stageFragment;
+      if ((stage.activeShaders & bit) != 0)
+        r.Fail("the stage already has a " + section + " shader");
+      stage.activeShaders |= bit;
+      const unsigned type = compute ? glComputeShader : section == "<vertex>" ? glVertexShader : glFragmentShader;
+      stage.sources.push_back({type, LoadSource(r, root, r.Expect("a shader path"))});
+    }
+    else if (section == "<in>")
+    {
+      for (token = r.Expect("</in>"); Lower(token) != "</in>"; token = r.Expect("</in>"))
+      {
+        std::string name, inside, rest;
+        SplitEntry(r, token, name, inside, rest);
+        if (rest.empty() || rest[0] != '=')
+          r.Fail("input '" + token + "' should look like name[size]=location");
+        const int size = ParseInt(r, inside, token);
+        if (size < 1 || size > 4)
+          r.Fail("input '" + name + "' has " + inside + " components, inputs have 1 to 4");
+        CheckUnique(r, stage.inputs, name, "input");
+        stage.inputs.push_back({name, static_cast<unsigned>(ParseInt(r, rest.substr(1), token)), static_cast<unsigned long long>(size)});
+      }
+    }
+    else if (section == "<uniform>")
+    {
+      for (token = r.Expect("</uniform>"); Lower(token) != "</uniform>"; token = r.Expect("</uniform>"))
+      {
+        std::string name, inside, rest;
+        SplitEntry(r, token, name, inside, rest);
+        const unsigned long long size = Lower(inside) == "unique" ? ~0ull : static_cast<unsigned long long>(ParseInt(r, inside, token));
+        CheckUnique(r, stage.uniforms, name, "uniform");
+        stage.uniforms.push_back({name, 0, size});
+      }
+    }
+    else if (section == "<variants>")
+    {
+      for (token = Lower(r.Expect("</variants>")); token != "</variants>"; token = Lower(r.Expect("</variants>")))
+      {
+        if (token == "textured")
+          stage.variants |= variantTextured;
+        else if (token == "lighting")
+          stage.variants |= variantLighting;
+        else
+          r.Fail("unknown variant '" + token + "', variants are textured and lighting");
+      }
+    }
+    else if (section == "<buffers>")
+      ReadBuffers(r, stage.buffers);
+    else if (section != "<shaderstage>" && section != "</shaderstage>" && section != "</vertex>" &&
+             section != "</fragment>" && section != "</compute>")
+      r.Fail("unexpected '" + token + "'");
+  }
+  if (stage.sources.empty())
+    r.Fail("the stage has no shaders");
+}
+
+static void ReadPass(std::filesystem::path const& root, std::filesystem::path const& meta, std::vector<Stage>& stages,
+                     std::vector<FBO>& fbos, std::vector<Buffer>& buffers, std::vector<Resource>& resources)
+{
+  Reader r(meta);
+  std::string token;
+  while (r.Next(token))
+  {
+    const std::string section = Lower(token);
+    if (section == "<stages>")
+    {
+      for (token = r.Expect("</stages>"); Lower(token) != "</stages>"; token = r.Expect("</stages>"))
+      {
+        std::string path, inside, rest;
+        SplitEntry(r, token, path, inside, rest);
+        if (rest.empty() || rest[0] != '=')
+          r.Fail("stage '" + token + "' should look like path[renderStage]=id");
+        Stage stage;
+        // RenderPass names stages by the lower case file name
+        stage.name = Lower(path.substr(path.rfind('/') + 1));
+        stage.stage = ParseInt(r, inside, token);
+        stage.id = static_cast<unsigned>(ParseInt(r, rest.substr(1), token));
+        if (stage.stage >= renderStageCount)
+          r.Fail("stage '" + stage.name + "' runs in render stage " + inside + ", render stages go from 0 to " + std::to_string(renderStageCount - 1));
+        CheckUnique(r, stages, stage.name, "stage");
+        ReadStage(root, path + ".meta", stage);
+        stages.push_back(std::move(stage));
+      }
+    }
+    else if (section == "<fbos>")
+    {
+      for (token = r.Expect("</fbos>"); Lower(token) != "</fbos>"; token = r.Expect("</fbos>"))
+      {
+        const size_t eq = token.find('=');
+        if (eq == std::string::npos || eq == 0)
+          r.Fail("FBO '" + token + "' should look like name=renderStage[options]");
+        const std::string name = Lower(token.substr(0, eq));
+        std::string value = token.substr(eq + 1), options;
+        const size_t open = value.find('[');
+        if (open != std::string::npos)
+        {
+          if (value.back() != ']')
+            r.Fail("FBO '" + name + "' options should be in brackets after the render stage");
+          options = Lower(value.substr(open + 1, value.size() - open - 2));
+          value.erase(open);
+        }
+        FBO fbo = {name, {}};
+        fbo.desc.stage = ParseInt(r, value, token);
+        if (fbo.desc.stage >= renderStageCount)
+          r.Fail("FBO '" + name + "' is in render stage " + std::to_string(fbo.desc.stage) + ", render stages go from 0 to " + std::to_string(renderStageCount - 1));
+        std::stringstream list(options);
+        for (std::string option; std::getline(list, option, ',');)
+        {
+          if (ORB_ApplyFBOOption(fbo.desc, option) == false)
+            r.Fail("unknown FBO option '" + option + "', the options are rgba8, rgba16f, rgba32f, r11g11b10f, rg16f, r32f, "
+                   "depth, depth24, nodepth, a scale above 0 up to 4, transient and overwritten");
+        }
+        CheckUnique(r, fbos, name, "FBO");
+        fbos.push_back(fbo);
+      }
+    }
+    else if (section == "<buffers>")
+      ReadBuffers(r, buffers);
+    else if (section == "<resources>")
+    {
+      for (token = r.Expect("</resources>"); Lower(token) != "</resources>"; token = r.Expect("</resources>"))
+      {
+        std::string stage, inside, rest;
+        SplitEntry(r, token, stage, inside, rest);
+        if (rest.size() < 2 || rest[0] != '=')
+          r.Fail("resource use '" + token + "' should look like stage[rw]=resource");
+        Resource use = {Lower(stage), rest.substr(1), 0, r.Line()};
+        for (char c : Lower(inside))
+        {
+          if (c == 'r' || c == 'w')
+            use.access |= c == 'r' ? accessRead : accessWrite;
+          else
+            r.Fail("resource use '" + token + "' needs r, w or rw in the brackets");
+        }
+        if (use.access == 0)
+          r.Fail("resource use '" + token + "' needs r, w or rw in the brackets");
+        resources.push_back(use);
+      }
+    }
+    else if (section != "<renderpass>" && section != "</renderpass>")
+      r.Fail("unexpected '" + token + "'");
+  }
+
+  // Checked once the whole pass is read, <Resources> may come before <Stages>
+  for (Resource& use : resources)
+  {
+    auto stage = std::find_if(stages.begin(), stages.end(), [&](Stage const& s) { return s.name == use.stage; });
+    if (stage == stages.end())
+      r.Fail("resource use names stage '" + use.stage + "' which the pass doesn't have", use.line);
+    auto named = [&](auto const& list, std::string const& name)
+    { return std::any_of(list.begin(), list.end(), [&](auto const& b) { return b.name == name; }); };
+    if (named(fbos, Lower(use.resource)))
+      use.resource = Lower(use.resource);
+    else if (named(buffers, use.resource) == false &&
+             std::none_of(stages.begin(), stages.end(), [&](Stage const& s) { return named(s.buffers, use.resource); }))
+      r.Fail("resource use names '" + use.resource + "' which is neither an FBO nor a buffer of the pass", use.line);
+  }
+}
+
+// file.ext -> file_ext, the same names embeder gives
+static std::string Identifier(std::string const& s)
+{
+  std::string id = s;
+  for (char& c : id)
+  {
+    if (std::isalnum(static_cast<unsigned char>(c)) == false)
+      c = '_';
+  }
+  if (id.empty() || std::isdigit(static_cast<unsigned char>(id[0])))
+    id.insert(id.begin(), '_');
+  return id;
+}
+
+static std::string Quote(std::string const& s)
+{
+  std::string out = "\"";
+  for (unsigned char c : s)
+  {
+    if (c == '"' || c == '\\')
+      out += '\\', out += static_cast<char>(c);
+    else if (c == '\t')
+      out += "\\t";
+    else if (c == '\n')
+      out += "\\n";
+    else if (c < 0x20 || c >= 0x7F)
+    {
+      char escape[8];
+      std::snprintf(escape, sizeof(escape), "\\%03o", c);
+      out += escape;
+    }
+    else
+      out += static_cast<char>(c);
+  }
+  return out + "\"";
+}
+
+static std::string Hash(std::string const& name)
+{
+  char hex[32];
+  std::snprintf(hex, sizeof(hex), "0x%016llXull", ORB_HashName(name));
+  return hex;
+}
+
+// One literal per line so the output stays readable, \r is dropped
+static std::string SourceLiteral(std::string const& text)
+{
+  std::string out;
+  size_t start = 0;
+  while (start < text.size())
+  {
+    size_t end = text.find('\n', start);
+    end = end == std::string::npos ? text.size() : end + 1;
+    std::string line = text.substr(start, end - start);
+    line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+    out += "\n     " + Quote(line);
+    start = end;
+  }
+  return out.empty() ? "\"\"" : out;
+}
+
+static void WriteAttributes(std::ostream& out, std::string const& symbol, std::vector<Attribute> const& list)
+{
+  if (list.empty())
+    return;
+  out << "inline constexpr ORB_CompiledAttribute " << symbol << "[] = {\n";
+  for (Attribute const& a : list)
+    out << "  {" << Quote(a.name) << ", " << Hash(a.name) << ", " << a.location << ", " << (a.size == ~0ull ? "0xFFFFFFFFFFFFFFFFull" : std::to_string(a.size)) << "},\n";
+  out << "};\n";
+}
+
+static void WriteBuffers(std::ostream& out, std::string const& symbol, std::vector<Buffer> const& list)
+{
+  if (list.empty())
+    return;
+  out << "inline constexpr ORB_CompiledBuffer " << symbol << "[] = {\n";
+  for (Buffer const& b : list)
+    out << "  {" << Quote(b.name) << ", " << Hash(b.name) << ", " << b.type << "},\n";
+  out << "};\n";
+}
+
+// Empty lists have no array, C++ doesn't allow empty ones
+static std::string SpanOf(std::string const& symbol, bool empty)
+{
+  return empty ? "{}" : symbol;
+}
+
+static void Usage()
+{
+  std::cout << "usage: PipelineCompiler [-r root] [-d depfile] <pass.rpass.meta> <output.inc>" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  std::string root = ".", depfile, input, output;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+      root = argv[++i];
+    else if (std::strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+      depfile = argv[++i];
+    else if (input.empty())
+      input = argv[i];
+    else
+      output = argv[i];
+  }
+  if (input.empty() || output.empty())
+    return Usage(), 1;
+
+  std::vector<Stage> stages;
+  std::vector<FBO> fbos;
+  std::vector<Buffer> buffers;
+  std::vector<Resource> resources;
+  ReadPass(root, input, stages, fbos, buffers, resources);
+
+  const std::string fileName = std::filesystem::path(input).filename().string();
+  const std::string base = Identifier(fileName);
+  std::ostringstream out;
+  out << "// Generated by PipelineCompiler from " << fileName << ", do not edit\n";
+  out << "#pragma once\n#include \"Compiled Pipeline.h\"\n\n";
+  for (Stage const& s : stages)
+  {
+    const std::string prefix = base + "_" + Identifier(s.name);
+    out << "inline constexpr ORB_CompiledSource " << prefix << "_sources[] = {\n";
+    for (Source const& src : s.sources)
+      out << "  {0x" << std::hex << std::uppercase << src.type << std::dec << "," << SourceLiteral(src.text) << "},\n";
+    out << "};\n";
+    WriteAttributes(out, prefix + "_inputs", s.inputs);
+    WriteAttributes(out, prefix + "_uniforms", s.uniforms);
+    WriteBuffers(out, prefix + "_buffers", s.buffers);
+    out << "\n";
+  }
+  if (stages.empty() == false)
+  {
+    out << "inline constexpr ORB_CompiledStage " << base << "_stages[] = {\n";
+    for (Stage const& s : stages)
+    {
+      const std::string prefix = base + "_" + Identifier(s.name);
+      out << "  {" << Quote(s.name) << ", " << Hash(s.name) << ", " << s.stage << ", " << s.id << ", " << s.activeShaders << ", "
+          << s.variants << ", " << prefix << "_sources, " << SpanOf(prefix + "_inputs", s.inputs.empty()) << ", "
+          << SpanOf(prefix + "_uniforms", s.uniforms.empty()) << ", " << SpanOf(prefix + "_buffers", s.buffers.empty()) << "},\n";
+    }
+    out << "};\n";
+  }
+  if (fbos.empty() == false)
+  {
+    out << "inline constexpr ORB_CompiledFBO " << base << "_fbos[] = {\n";
+    for (FBO const& f : fbos)
+      out << "  {" << Quote(f.name) << ", " << Hash(f.name) << ", " << f.desc.stage << ", " << (f.desc.transient ? "true" : "false") << ", "
+          << f.desc.format << ", " << f.desc.depth << ", " << std::setprecision(9) << f.desc.scale << ", "
+          << (f.desc.overwritten ? "true" : "false") << "},\n";
+    out << "};\n";
+  }
+  WriteBuffers(out, base + "_buffers", buffers);
+  if (resources.empty() == false)
+  {
+    out << "inline constexpr ORB_CompiledResource " << base << "_resources[] = {\n";
+    for (Resource const& use : resources)
+      out << "  {" << Quote(use.stage) << ", " << Quote(use.resource) << ", " << use.access << "},\n";
+    out << "};\n";
+  }
+  out << "\ninline constexpr ORB_CompiledPass " << base << " = {" << Quote(fileName) << ", "
+      << SpanOf(base + "_stages", stages.empty()) << ", " << SpanOf(base + "_fbos", fbos.empty()) << ", "
+      << SpanOf(base + "_buffers", buffers.empty()) << ", " << SpanOf(base + "_resources", resources.empty()) << "};\n";
+
+  // Left alone when nothing changed, so whatever includes it isn't rebuilt
+  std::ifstream old(output, std::ios::binary);
+  std::stringstream previous;
+  previous << old.rdbuf();
+  if (old.is_open() == false || previous.str() != out.str())
+  {
+    old.close();
+    const std::filesystem::path folder = std::filesystem::path(output).parent_path();
+    if (folder.empty() == false)
+      std::filesystem::create_directories(folder);
+    std::ofstream file(output, std::ios::binary);
+    file << out.str();
+    if (file.good() == false)
+    {
+      std::cerr << "ORB ERROR: Could not write " << output << std::endl;
+      return 1;
+    }
+  }
+
+  if (depfile.empty() == false)
+  {
+    std::ofstream deps(depfile);
+    deps << output << ":";
+    for (std::string const& in : inputs)
+    {
+      std::string escaped;
+      for (char c : in)
+      {
+        if (c == ' ')
+          escaped += '\\';
+        escaped += c;
+      }
+      deps << " \\\n  " << escaped;
+    }
+    deps << "\n";
+  }
+  std::cout << "Compiled " << input << ": " << stages.size() << " stages, " << fbos.size() << " FBOs, " << buffers.size() << " buffers" << std::endl;
+  return 0;
+}
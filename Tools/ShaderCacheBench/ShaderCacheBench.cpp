@@ -0,0 +1,76 @@
+/*********************************************************************
+ * @file   ShaderCacheBench.cpp
+ * @brief  Measures how much the program binary cache saves when loading
+ * a render pass
+ *
+ * @details Loads the pass once with an empty cache, then again from the
+ * cache, then again with the cache off, and prints the time spent building
+ * programs for each. Run it from the Example folder so the paths in the
+ * pass resolve. The driver may keep its own shader cache, so the cache off
+ * numbers can be lower than a true first launch.
+ *
+ * usage: ShaderCacheBench [render pass] [runs]
+ *        render pass  ./Shaders/primary.rpass.meta by default
+ *        runs         loads to average for the warm and uncached cases, 5 by default
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#include "../../OverloadedRenderBackend/OverloadedRenderBackend.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+typedef struct Sample
+{
+  double total;
+  double build;
+}Sample;
+
+// Wall time of the whole load and the part of it spent building programs
+static Sample Load(std::string const& pass, int runs)
+{
+  Sample s = {0, 0};
+  for (int i = 0; i < runs; ++i)
+  {
+    const double before = orb::GetShaderCacheStats().buildSeconds;
+    const auto start = std::chrono::steady_clock::now();
+    orb::LoadCustomRenderPass(pass);
+    s.total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    s.build += orb::GetShaderCacheStats().buildSeconds - before;
+  }
+  return {s.total * 1000 / runs, s.build * 1000 / runs};
+}
+
+int main(int argc, char** argv)
+{
+  const std::string pass = argc > 1 ? argv[1] : "./Shaders/primary.rpass.meta";
+  const int runs = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 5;
+  const char* directory = "./ShaderCacheBench";
+
+  std::filesystem::remove_all(directory);
+  orb::SetShaderCacheDirectory(directory);
+  orb::Initialize();
+
+  const Sample cold = Load(pass, 1);
+  const ORB_ShaderCacheStats afterCold = orb::GetShaderCacheStats();
+  const Sample warm = Load(pass, runs);
+  const ORB_ShaderCacheStats afterWarm = orb::GetShaderCacheStats();
+  orb::SetShaderCacheDirectory("");
+  const Sample uncached = Load(pass, runs);
+
+  std::cout << pass << std::endl;
+  std::cout << "  cold cache: " << cold.total << " ms load, " << cold.build << " ms building programs ("
+            << afterCold.misses << " compiled)" << std::endl;
+  std::cout << "  warm cache: " << warm.total << " ms load, " << warm.build << " ms building programs ("
+            << (afterWarm.hits - afterCold.hits) / runs << " cached, " << afterWarm.rejected << " rejected)" << std::endl;
+  std::cout << "  cache off:  " << uncached.total << " ms load, " << uncached.build << " ms building programs" << std::endl;
+  std::cout << "  saved per load: " << uncached.build - warm.build << " ms" << std::endl;
+
+  orb::ShutDown();
+  std::filesystem::remove_all(directory);
+  return 0;
+}
@@ -0,0 +1,380 @@
+/*********************************************************************
+ * @file   TextureConverter.cpp
+ * @brief  Offline texture converter
+ *
+ * @details Generates the full mip chain of an image on the CPU, block
+ * compresses every level and writes it out as a KTX2 file that
+ * LoadTexture uploads as is with no decoding or mip generation at load.
+ *
+ * usage: TextureConverter [-f bc1|bc3|rgba8] [-n] <input image> <output.ktx2>
+ *        -f  output format, bc1 by default, bc3 keeps smooth alpha
+ *        -n  do not generate mips
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include "stb_image.h"
+#include "stb_image_resize.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+typedef struct Level
+{
+  int w, h;
+  std::vector<unsigned char> pixels;
+  std::vector<unsigned char> encoded;
+}Level;
+
+enum class Format
+{
+  BC1,
+  BC3,
+  RGBA8
+};
+
+// vkFormat values written to the KTX2 header
+constexpr uint32_t VK_FORMAT_R8G8B8A8_UNORM = 37;
+constexpr uint32_t VK_FORMAT_BC1_RGBA_UNORM_BLOCK = 133;
+constexpr uint32_t VK_FORMAT_BC3_UNORM_BLOCK = 137;
+
+static uint16_t To565(const float c[3])
+{
+  auto q = [](float v, int max) { return static_cast<uint16_t>(std::clamp(static_cast<int>(v / 255.f * max + .5f), 0, max)); };
+  return static_cast<uint16_t>((q(c[0], 31) << 11) | (q(c[1], 63) << 5) | q(c[2], 31));
+}
+
+static void From565(uint16_t c, int out[3])
+{
+  out[0] = ((c >> 11) & 31) * 255 / 31;
+  out[1] = ((c >> 5) & 63) * 255 / 63;
+  out[2] = (c & 31) * 255 / 31;
+}
+
+// Range fit, the endpoints are the block's bounding box pulled in a little
+static void EncodeColor(unsigned char const block[16][4], bool punchThrough, unsigned char out[8])
+{
+  float lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0};
+  for (int i = 0; i < 16; ++i)
+  {
+    if (punchThrough && block[i][3] < 128)
+      continue;
+    for (int c = 0; c < 3; ++c)
+    {
+      lo[c] = std::min(lo[c], static_cast<float>(block[i][c]));
+      hi[c] = std::max(hi[c], static_cast<float>(block[i][c]));
+    }
+  }
+  for (int c = 0; c < 3; ++c)
+  {
+    const float inset = (hi[c] - lo[c]) / 16.f;
+    lo[c] = std::min(lo[c] + inset, hi[c]);
+    hi[c] = std::max(hi[c] - inset, lo[c]);
+  }
+  uint16_t c0 = To565(hi), c1 = To565(lo);
+  // Four colour mode needs c0 > c1, three colour mode with transparent black needs c0 <= c1
+  if ((punchThrough && c0 > c1) || (punchThrough == false && c0 < c1))
+    std::swap(c0, c1);
+
+  int palette[4][3];
+  From565(c0, palette[0]);
+  From565(c1, palette[1]);
+  const bool four = c0 > c1;
+  for (int c = 0; c < 3; ++c)
+  {
+    if (four)
+    {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    else
+    {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    }
+  }
+
+  uint32_t indices = 0;
+  for (int i = 0; i < 16; ++i)
+  {
+    uint32_t best = 0;
+    if (punchThrough && block[i][3] < 128)
+      best = 3;
+    else
+    {
+      int bestDist = INT32_MAX;
+      for (uint32_t p = 0; p < (four ? 4u : 3u); ++p)
+      {
+        int dist = 0;
+        for (int c = 0; c < 3; ++c)
+          dist += (block[i][c] - palette[p][c]) * (block[i][c] - palette[p][c]);
+        if (dist < bestDist)
+          bestDist = dist, best = p;
+      }
+    }
+    indices |= best << (i * 2);
+  }
+  std::memcpy(out, &c0, 2);
+  std::memcpy(out + 2, &c1, 2);
+  std::memcpy(out + 4, &indices, 4);
+}
+
+static void EncodeAlpha(unsigned char const block[16][4], unsigned char out[8])
+{
+  int a0 = 0, a1 = 255;
+  for (int i = 0; i < 16; ++i)
+  {
+    a0 = std::max(a0, static_cast<int>(block[i][3]));
+    a1 = std::min(a1, static_cast<int>(block[i][3]));
+  }
+  int palette[8] = {a0, a1};
+  for (int i = 1; i < 7; ++i)
+    palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+
+  uint64_t indices = 0;
+  for (int i = 0; i < 16 && a0 != a1; ++i)
+  {
+    uint64_t best = 0;
+    int bestDist = INT32_MAX;
+    for (uint64_t p = 0; p < 8; ++p)
+    {
+      const int dist = std::abs(block[i][3] - palette[p]);
+      if (dist < bestDist)
+        bestDist = dist, best = p;
+    }
+    indices |= best << (i * 3);
+  }
+  out[0] = static_cast<unsigned char>(a0);
+  out[1] = static_cast<unsigned char>(a1);
+  std::memcpy(out + 2, &indices, 6);
+}
+
+static void Encode(Level& l, Format f)
+{
+  if (f == Format::RGBA8)
+  {
+    l.encoded = l.pixels;
+    return;
+  }
+  bool punchThrough = false;
+  if (f == Format::BC1)
+  {
+    for (size_t i = 3; i < l.pixels.size() && punchThrough == false; i += 4)
+      punchThrough = l.pixels[i] < 128;
+  }
+  const size_t blockBytes = f == Format::BC1 ? 8 : 16;
+  for (int by = 0; by < l.h; by += 4)
+  {
+    for (int bx = 0; bx < l.w; bx += 4)
+    {
+      // Edge blocks repeat the last row and column
+      unsigned char block[16][4];
+      for (int i = 0; i < 16; ++i)
+      {
+        const int x = std::min(bx + i % 4, l.w - 1), y = std::min(by + i / 4, l.h - 1);
+        std::memcpy(block[i], &l.pixels[(static_cast<size_t>(y) * l.w + x) * 4], 4);
+      }
+      unsigned char encoded[16];
+      if (f == Format::BC3)
+      {
+        EncodeAlpha(block, encoded);
+        EncodeColor(block, false, encoded + 8);
+      }
+      else
+        EncodeColor(block, punchThrough, encoded);
+      l.encoded.insert(l.encoded.end(), encoded, encoded + blockBytes);
+    }
+  }
+}
+
+template <typename T>
+static void Put(std::vector<unsigned char>& out, T v)
+{
+  const unsigned char* b = reinterpret_cast<const unsigned char*>(&v);
+  out.insert(out.end(), b, b + sizeof(T));
+}
+
+// A basic data format descriptor, see the Khronos Data Format Specification
+static std::vector<unsigned char> DataFormatDescriptor(Format f)
+{
+  typedef struct Sample
+  {
+    uint16_t offset;
+    uint8_t bitLength;
+    uint8_t channel;
+    uint32_t upper;
+  }Sample;
+  std::vector<Sample> samples;
+  uint8_t model = 0, blockDim = 0, bytesPlane = 0;
+  switch (f)
+  {
+  case Format::RGBA8:
+    model = 1; // RGBSDA
+    bytesPlane = 4;
+    samples = {{0, 7, 0, 255}, {8, 7, 1, 255}, {16, 7, 2, 255}, {24, 7, 15, 255}};
+    break;
+  case Format::BC1:
+    model = 128; // BC1A
+    blockDim = 3;
+    bytesPlane = 8;
+    samples = {{0, 63, 0, UINT32_MAX}};
+    break;
+  case Format::BC3:
+    model = 130; // BC3
+    blockDim = 3;
+    bytesPlane = 16;
+    samples = {{0, 63, 15, UINT32_MAX}, {64, 63, 0, UINT32_MAX}};
+    break;
+  }
+  const uint16_t blockSize = static_cast<uint16_t>(24 + 16 * samples.size());
+  std::vector<unsigned char> dfd;
+  Put<uint32_t>(dfd, 4 + blockSize);
+  Put<uint32_t>(dfd, 0); // Khronos vendor, basic descriptor type
+  Put<uint16_t>(dfd, 2); // version 1.3
+  Put<uint16_t>(dfd, blockSize);
+  const unsigned char header[12] = {model, 1 /* BT709 */, 1 /* linear */, 0, blockDim, blockDim, 0, 0, bytesPlane, 0, 0, 0};
+  dfd.insert(dfd.end(), header, header + 12);
+  Put<uint32_t>(dfd, 0); // bytesPlane4-7
+  for (Sample const& s : samples)
+  {
+    Put<uint16_t>(dfd, s.offset);
+    Put<uint8_t>(dfd, s.bitLength);
+    Put<uint8_t>(dfd, s.channel);
+    Put<uint32_t>(dfd, 0); // sample position
+    Put<uint32_t>(dfd, 0); // lower
+    Put<uint32_t>(dfd, s.upper);
+  }
+  return dfd;
+}
+
+static bool WriteKTX2(std::string const& path, std::vector<Level> const& levels, Format f)
+{
+  const uint32_t vkFormat = f == Format::BC1 ? VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+                          : f == Format::BC3 ? VK_FORMAT_BC3_UNORM_BLOCK
+                                             : VK_FORMAT_R8G8B8A8_UNORM;
+  const size_t alignment = f == Format::RGBA8 ? 4 : (f == Format::BC1 ? 8 : 16);
+  std::vector<unsigned char> dfd = DataFormatDescriptor(f);
+
+  const unsigned char identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+  std::vector<unsigned char> out(identifier, identifier + 12);
+  Put<uint32_t>(out, vkFormat);
+  Put<uint32_t>(out, 1); // typeSize
+  Put<uint32_t>(out, levels[0].w);
+  Put<uint32_t>(out, levels[0].h);
+  Put<uint32_t>(out, 0); // depth
+  Put<uint32_t>(out, 0); // layers
+  Put<uint32_t>(out, 1); // faces
+  Put<uint32_t>(out, static_cast<uint32_t>(levels.size()));
+  Put<uint32_t>(out, 0); // no supercompression
+
+  const size_t dfdOffset = 80 + levels.size() * 24;
+  Put<uint32_t>(out, static_cast<uint32_t>(dfdOffset));
+  Put<uint32_t>(out, static_cast<uint32_t>(dfd.size()));
+  Put<uint32_t>(out, 0); // no key/value data
+  Put<uint32_t>(out, 0);
+  Put<uint64_t>(out, 0); // no supercompression global data
+  Put<uint64_t>(out, 0);
+
+  // The spec stores the smallest level first
+  std::vector<uint64_t> offsets(levels.size());
+  size_t end = dfdOffset + dfd.size();
+  for (size_t i = levels.size(); i-- > 0;)
+  {
+    end = (end + alignment - 1) / alignment * alignment;
+    offsets[i] = end;
+    end += levels[i].encoded.size();
+  }
+  for (size_t i = 0; i < levels.size(); ++i)
+  {
+    Put<uint64_t>(out, offsets[i]);
+    Put<uint64_t>(out, levels[i].encoded.size());
+    Put<uint64_t>(out, levels[i].encoded.size());
+  }
+  out.insert(out.end(), dfd.begin(), dfd.end());
+  out.resize(end, 0);
+  for (size_t i = 0; i < levels.size(); ++i)
+    std::memcpy(&out[offsets[i]], levels[i].encoded.data(), levels[i].encoded.size());
+
+  std::ofstream file(path, std::ios::binary);
+  if (file.is_open() == false)
+    return false;
+  file.write(reinterpret_cast<const char*>(out.data()), out.size());
+  return true;
+}
+
+static void Usage()
+{
+  std::cout << "usage: TextureConverter [-f bc1|bc3|rgba8] [-n] <input image> <output.ktx2>" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  Format format = Format::BC1;
+  bool mips = true;
+  std::string input, output;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+    {
+      std::string f = argv[++i];
+      if (f == "bc1")
+        format = Format::BC1;
+      else if (f == "bc3")
+        format = Format::BC3;
+      else if (f == "rgba8")
+        format = Format::RGBA8;
+      else
+        return Usage(), 1;
+    }
+    else if (std::strcmp(argv[i], "-n") == 0)
+      mips = false;
+    else if (input.empty())
+      input = argv[i];
+    else
+      output = argv[i];
+  }
+  if (input.empty() || output.empty())
+    return Usage(), 1;
+
+  int w = 0, h = 0, channels = 0;
+  unsigned char* pixels = stbi_load(input.c_str(), &w, &h, &channels, 4);
+  if (pixels == nullptr)
+  {
+    std::cerr << "ORB ERROR: Could not load " << input << std::endl;
+    return 1;
+  }
+  std::vector<Level> levels(1);
+  levels[0] = {w, h, std::vector<unsigned char>(pixels, pixels + static_cast<size_t>(w) * h * 4), {}};
+  stbi_image_free(pixels);
+
+  // Each level is filtered down from the one above it
+  while (mips && (levels.back().w > 1 || levels.back().h > 1))
+  {
+    Level const& above = levels.back();
+    Level next = {std::max(above.w / 2, 1), std::max(above.h / 2, 1), {}, {}};
+    next.pixels.resize(static_cast<size_t>(next.w) * next.h * 4);
+    stbir_resize_uint8(above.pixels.data(), above.w, above.h, 0, next.pixels.data(), next.w, next.h, 0, 4);
+    levels.push_back(std::move(next));
+  }
+
+  size_t before = 0, after = 0;
+  for (Level& l : levels)
+  {
+    Encode(l, format);
+    before += l.pixels.size();
+    after += l.encoded.size();
+  }
+  if (WriteKTX2(output, levels, format) == false)
+  {
+    std::cerr << "ORB ERROR: Could not write " << output << std::endl;
+    return 1;
+  }
+  std::cout << "Wrote " << output << ": " << levels.size() << " levels, " << before << " -> " << after << " bytes" << std::endl;
+  return 0;
+}
@@ -0,0 +1,323 @@
+/*********************************************************************
+ * @file   VirtualTextureBuilder.cpp
+ * @brief  Offline virtual texture builder
+ *
+ * @details Cuts an image, or a folder of image chunks named <column>_<row>
+ * (e.g. 0_0.png, 1_0.png ...) that together form one huge image, into a mip
+ * pyramid of square tiles and writes them to a .vtex file for
+ * orb::LoadVirtualTexture. Every tile is stored with a border of its
+ * neighbours' pixels so the runtime page cache can be filtered. Chunks are
+ * loaded a few at a time and levels are built from tiles on disk, so the
+ * whole image never has to fit in memory.
+ *
+ * usage: VirtualTextureBuilder [-t tileSize] [-b border] <input image or chunk folder> <output.vtex>
+ *        -t  pixels of content per tile, 126 by default (128 with the border)
+ *        -b  border pixels on each side of a tile, 1 by default
+ *
+ * @author Lorenzo St. Luce(lorenzo.stluce)
+ * @date   October 2026
+ *********************************************************************/
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Must match VTexHeader in Virtual Texture.cpp
+typedef struct Header
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t width, height;
+  uint32_t tileSize, border;
+  uint32_t levels;
+  uint32_t reserved;
+}Header;
+static_assert(sizeof(Header) == 32, "Header must be 32 bytes");
+
+// The input image, either one file or a grid of equally sized chunks
+class Source
+{
+public:
+  bool Open(std::filesystem::path const& p)
+  {
+    if (std::filesystem::is_directory(p) == false)
+    {
+      _files[{0, 0}] = p.string();
+      return Measure();
+    }
+    for (auto const& entry : std::filesystem::directory_iterator(p))
+    {
+      std::string stem = entry.path().stem().string();
+      size_t split = stem.find('_');
+      if (split == std::string::npos)
+        continue;
+      try
+      {
+        _files[{std::stoi(stem.substr(0, split)), std::stoi(stem.substr(split + 1))}] = entry.path().string();
+      }
+      catch (std::exception const&)
+      {
+      }
+    }
+    return _files.empty() == false && Measure();
+  }
+
+  int Width() const { return _w; }
+  int Height() const { return _h; }
+
+  // Clamped to the edges of the image
+  unsigned char const* Pixel(int x, int y)
+  {
+    x = std::clamp(x, 0, _w - 1);
+    y = std::clamp(y, 0, _h - 1);
+    Chunk const& c = Get(x / _chunkW, y / _chunkH);
+    return c.pixels.data() + (static_cast<size_t>(y % _chunkH) * c.w + x % _chunkW) * 4;
+  }
+
+private:
+  typedef struct Chunk
+  {
+    int col, row;
+    int w, h;
+    std::vector<unsigned char> pixels;
+  }Chunk;
+
+  bool Measure()
+  {
+    int cols = 0, rows = 0;
+    for (auto const& [key, file] : _files)
+    {
+      cols = std::max(cols, key.first + 1);
+      rows = std::max(rows, key.second + 1);
+    }
+    int comp = 0, lastW = 0, lastH = 0;
+    if (stbi_info(_files.begin()->second.c_str(), &_chunkW, &_chunkH, &comp) == 0)
+      return false;
+    // Only the last column and row may be narrower
+    auto last = _files.find({cols - 1, rows - 1});
+    if (last == _files.end() || stbi_info(last->second.c_str(), &lastW, &lastH, &comp) == 0)
+      return false;
+    if (static_cast<int>(_files.size()) != cols * rows)
+      return false;
+    _w = (cols - 1) * _chunkW + lastW;
+    _h = (rows - 1) * _chunkH + lastH;
+    _cacheSize = static_cast<size_t>(cols) * 2 + 2;
+    return true;
+  }
+
+  Chunk const& Get(int col, int row)
+  {
+    if (_cache.empty() == false && _cache.back().col == col && _cache.back().row == row)
+      return _cache.back();
+    for (Chunk const& c : _cache)
+    {
+      if (c.col == col && c.row == row)
+        return c;
+    }
+    if (_cache.size() >= _cacheSize)
+      _cache.pop_front();
+    Chunk c = {col, row, 0, 0, {}};
+    int comp = 0;
+    unsigned char* pixels = stbi_load(_files[{col, row}].c_str(), &c.w, &c.h, &comp, 4);
+    if (pixels == nullptr)
+    {
+      std::cerr << "ORB ERROR: Could not load " << _files[{col, row}] << std::endl;
+      std::exit(1);
+    }
+    c.pixels.assign(pixels, pixels + static_cast<size_t>(c.w) * c.h * 4);
+    stbi_image_free(pixels);
+    _cache.push_back(std::move(c));
+    return _cache.back();
+  }
+
+  std::map<std::pair<int, int>, std::string> _files;
+  std::deque<Chunk> _cache;
+  size_t _cacheSize = 1;
+  int _w = 0, _h = 0;
+  int _chunkW = 0, _chunkH = 0;
+};
+
+// Tiles of every level in the order they are written, the same layout VirtualTexture expects
+class Layout
+{
+public:
+  Layout(int w, int h, int tileSize) : w(w), h(h), tileSize(tileSize)
+  {
+    for (int l = 0;; ++l)
+    {
+      const int span = tileSize << l;
+      const int x = (w + span - 1) / span, y = (h + span - 1) / span;
+      first.push_back(total);
+      tilesX.push_back(x);
+      tilesY.push_back(y);
+      total += x * y;
+      if (x == 1 && y == 1)
+        break;
+    }
+  }
+
+  int Levels() const { return static_cast<int>(first.size()); }
+  int Index(int level, int x, int y) const { return first[level] + y * tilesX[level] + x; }
+
+  int w, h, tileSize;
+  int total = 0;
+  std::vector<int> first, tilesX, tilesY;
+};
+
+static void Usage()
+{
+  std::cout << "usage: VirtualTextureBuilder [-t tileSize] [-b border] <input image or chunk folder> <output.vtex>" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  int tileSize = 126, border = 1;
+  std::string input, output;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+      tileSize = std::atoi(argv[++i]);
+    else if (std::strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+      border = std::atoi(argv[++i]);
+    else if (input.empty())
+      input = argv[i];
+    else
+      output = argv[i];
+  }
+  // Page coordinates are stored in 8 bits and the page must fit the cache
+  if (input.empty() || output.empty() || tileSize < 1 || border < 0 || tileSize + border * 2 > 1024)
+    return Usage(), 1;
+
+  Source source;
+  if (source.Open(input) == false)
+  {
+    std::cerr << "ORB ERROR: Could not load " << input << std::endl;
+    return 1;
+  }
+  const Layout layout(source.Width(), source.Height(), tileSize);
+  const size_t tileBytes = static_cast<size_t>(tileSize) * tileSize * 4;
+
+  // Pass one, the content of every tile without borders, each level filtered down from the one before
+  const std::string scratchName = output + ".tmp";
+  std::fstream scratch(scratchName, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+  if (scratch.is_open() == false)
+  {
+    std::cerr << "ORB ERROR: Could not write " << scratchName << std::endl;
+    return 1;
+  }
+  auto readTile = [&](int index, std::vector<unsigned char>& out)
+  {
+    out.resize(tileBytes);
+    scratch.seekg(tileBytes * index);
+    scratch.read(reinterpret_cast<char*>(out.data()), tileBytes);
+  };
+
+  std::vector<unsigned char> tile(tileBytes);
+  for (int y = 0; y < layout.tilesY[0]; ++y)
+  {
+    for (int x = 0; x < layout.tilesX[0]; ++x)
+    {
+      for (int py = 0; py < tileSize; ++py)
+      {
+        for (int px = 0; px < tileSize; ++px)
+          std::memcpy(&tile[(static_cast<size_t>(py) * tileSize + px) * 4], source.Pixel(x * tileSize + px, y * tileSize + py), 4);
+      }
+      scratch.seekp(tileBytes * layout.Index(0, x, y));
+      scratch.write(reinterpret_cast<char const*>(tile.data()), tileBytes);
+    }
+  }
+
+  std::vector<unsigned char> children[4];
+  for (int l = 1; l < layout.Levels(); ++l)
+  {
+    for (int y = 0; y < layout.tilesY[l]; ++y)
+    {
+      for (int x = 0; x < layout.tilesX[l]; ++x)
+      {
+        // Children past the edge repeat the last one, they only hold clamped pixels anyway
+        for (int c = 0; c < 4; ++c)
+          readTile(layout.Index(l - 1, std::min(x * 2 + c % 2, layout.tilesX[l - 1] - 1), std::min(y * 2 + c / 2, layout.tilesY[l - 1] - 1)), children[c]);
+        for (int py = 0; py < tileSize; ++py)
+        {
+          for (int px = 0; px < tileSize; ++px)
+          {
+            const int cx = px * 2, cy = py * 2;
+            for (int ch = 0; ch < 4; ++ch)
+            {
+              int sum = 0;
+              for (int s = 0; s < 4; ++s)
+              {
+                const int sx = cx + s % 2, sy = cy + s / 2;
+                std::vector<unsigned char> const& child = children[(sy / tileSize) * 2 + sx / tileSize];
+                sum += child[(static_cast<size_t>(sy % tileSize) * tileSize + sx % tileSize) * 4 + ch];
+              }
+              tile[(static_cast<size_t>(py) * tileSize + px) * 4 + ch] = static_cast<unsigned char>((sum + 2) / 4);
+            }
+          }
+        }
+        scratch.seekp(tileBytes * layout.Index(l, x, y));
+        scratch.write(reinterpret_cast<char const*>(tile.data()), tileBytes);
+      }
+    }
+  }
+
+  // Pass two, add the borders from the neighbouring tiles and write the pages
+  std::ofstream file(output, std::ios::binary);
+  if (file.is_open() == false)
+  {
+    std::cerr << "ORB ERROR: Could not write " << output << std::endl;
+    return 1;
+  }
+  Header header = {{'O', 'R', 'B', 'V'}, 1, uint32_t(layout.w), uint32_t(layout.h), uint32_t(tileSize), uint32_t(border), uint32_t(layout.Levels()), 0};
+  file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+  const int pageSize = tileSize + border * 2;
+  std::vector<unsigned char> page(static_cast<size_t>(pageSize) * pageSize * 4);
+  std::map<int, std::vector<unsigned char>> neighbours;
+  for (int l = 0; l < layout.Levels(); ++l)
+  {
+    const int levelW = layout.tilesX[l] * tileSize, levelH = layout.tilesY[l] * tileSize;
+    for (int y = 0; y < layout.tilesY[l]; ++y)
+    {
+      for (int x = 0; x < layout.tilesX[l]; ++x)
+      {
+        neighbours.clear();
+        for (int py = 0; py < pageSize; ++py)
+        {
+          for (int px = 0; px < pageSize; ++px)
+          {
+            const int lx = std::clamp(x * tileSize + px - border, 0, levelW - 1);
+            const int ly = std::clamp(y * tileSize + py - border, 0, levelH - 1);
+            const int index = layout.Index(l, lx / tileSize, ly / tileSize);
+            auto n = neighbours.find(index);
+            if (n == neighbours.end())
+            {
+              n = neighbours.emplace(index, std::vector<unsigned char>()).first;
+              readTile(index, n->second);
+            }
+            std::memcpy(&page[(static_cast<size_t>(py) * pageSize + px) * 4], &n->second[(static_cast<size_t>(ly % tileSize) * tileSize + lx % tileSize) * 4], 4);
+          }
+        }
+        file.write(reinterpret_cast<char const*>(page.data()), page.size());
+      }
+    }
+  }
+  scratch.close();
+  std::filesystem::remove(scratchName);
+  if (file.good() == false)
+  {
+    std::cerr << "ORB ERROR: Could not write " << output << std::endl;
+    return 1;
+  }
+  std::cout << "Wrote " << output << ": " << layout.w << "x" << layout.h << ", " << layout.Levels() << " levels, " << layout.total
+            << " tiles of " << pageSize << "x" << pageSize << std::endl;
+  return 0;
+}